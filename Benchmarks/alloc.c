@@ -0,0 +1,144 @@
+/* alloc.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+/* Compares kCFAllocatorSlab with the system malloc for the small blocks
+ * that CF objects are made of, at 1, 8 and 32 threads.  Each thread
+ * keeps a window of live blocks and replaces them in a shuffled order,
+ * and a second test creates and releases CFNumbers.
+ *
+ * Usage: alloc [operations per thread]
+ */
+
+#include "CoreFoundation/CFBase.h"
+#include "CoreFoundation/CFNumber.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define MAX_THREADS 32
+#define WINDOW 1024
+
+static long operations;
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1.0e6;
+}
+
+static void *
+blocks (void *arg)
+{
+  CFAllocatorRef allocator = arg;
+  void *live[WINDOW] = { NULL };
+  unsigned int seed = 1;
+  long idx;
+
+  for (idx = 0 ; idx < operations ; ++idx)
+    {
+      unsigned int slot;
+
+      seed = seed * 1103515245 + 12345;
+      slot = (seed >> 8) % WINDOW;
+      if (live[slot])
+        CFAllocatorDeallocate (allocator, live[slot]);
+      /* Mostly object headers, with some string and data buffers. */
+      live[slot] = CFAllocatorAllocate (allocator,
+        16 + (seed >> 20) % ((seed & 7) ? 64 : 256), 0);
+    }
+  for (idx = 0 ; idx < WINDOW ; ++idx)
+    if (live[idx])
+      CFAllocatorDeallocate (allocator, live[idx]);
+  return NULL;
+}
+
+static void *
+numbers (void *arg)
+{
+  CFAllocatorRef allocator = arg;
+  long idx;
+
+  for (idx = 0 ; idx < operations ; ++idx)
+    {
+      CFNumberRef num;
+      double d = (double)idx;
+
+      num = CFNumberCreate (allocator, kCFNumberDoubleType, &d);
+      CFRelease (num);
+    }
+  return NULL;
+}
+
+static void
+benchmark (const char *what, void *(*func) (void *))
+{
+  static const int counts[] = { 1, 8, 32 };
+  static const char *names[] = { "malloc", "slab" };
+  CFAllocatorRef allocators[2];
+  pthread_t threads[MAX_THREADS];
+  int a;
+  int c;
+
+  allocators[0] = kCFAllocatorMalloc;
+  allocators[1] = kCFAllocatorSlab;
+  printf ("%s\n", what);
+  for (c = 0 ; c < 3 ; ++c)
+    {
+      for (a = 0 ; a < 2 ; ++a)
+        {
+          double start;
+          double seconds;
+          int idx;
+
+          start = now ();
+          for (idx = 0 ; idx < counts[c] ; ++idx)
+            pthread_create (&threads[idx], NULL, func,
+                            (void *)allocators[a]);
+          for (idx = 0 ; idx < counts[c] ; ++idx)
+            pthread_join (threads[idx], NULL);
+          seconds = now () - start;
+
+          printf ("  %-6s %2d thread%s %10.2f Mops/s  (%.3fs)\n",
+                  names[a], counts[c], counts[c] > 1 ? "s" : " ",
+                  seconds > 0.0
+                    ? (double)operations * counts[c] / seconds / 1.0e6
+                    : 0.0, seconds);
+        }
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  operations = argc > 1 ? atol (argv[1]) : 1000000;
+
+  benchmark ("Small blocks", blocks);
+  benchmark ("CFNumberCreate/CFRelease", numbers);
+
+  return 0;
+}
@@ -0,0 +1,101 @@
+/* array.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+/* Measures appending to a CFMutableArray, with and without reserving
+ * the final capacity first, inserting at the front, and using an array as
+ * a FIFO queue (append at the end, remove at the front).
+ *
+ * Usage: array [count]
+ *
+ * Without arguments 10000000 pointers are appended.
+ */
+
+#include "CoreFoundation/CFArray.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static double
+elapsed (clock_t start)
+{
+  return (double)(clock () - start) / CLOCKS_PER_SEC;
+}
+
+static void
+report (const char *what, CFIndex count, double seconds)
+{
+  printf ("  %-8s %10.2f Mops/s  (%.3fs)\n", what,
+          seconds > 0.0 ? (double)count / seconds / 1.0e6 : 0.0, seconds);
+}
+
+int
+main (int argc, char *argv[])
+{
+  CFMutableArrayRef array;
+  CFIndex count;
+  CFIndex idx;
+  clock_t start;
+
+  count = argc > 1 ? atol (argv[1]) : 10000000;
+  printf ("%ld values\n", (long)count);
+
+  array = CFArrayCreateMutable (NULL, 0, NULL);
+  start = clock ();
+  for (idx = 0 ; idx < count ; ++idx)
+    CFArrayAppendValue (array, (const void *)(uintptr_t)(idx + 1));
+  report ("append", count, elapsed (start));
+
+  start = clock ();
+  CFArrayReplaceValues (array, CFRangeMake (count / 2, count - count / 2),
+                        NULL, 0);
+  CFArrayShrinkToFit (array);
+  report ("shrink", count / 2, elapsed (start));
+  CFRelease (array);
+
+  array = CFArrayCreateMutable (NULL, 0, NULL);
+  start = clock ();
+  CFArrayReserveCapacity (array, count);
+  for (idx = 0 ; idx < count ; ++idx)
+    CFArrayAppendValue (array, (const void *)(uintptr_t)(idx + 1));
+  report ("reserved", count, elapsed (start));
+
+  start = clock ();
+  for (idx = 0 ; idx < count ; ++idx)
+    {
+      CFArrayAppendValue (array, (const void *)(uintptr_t)(idx + 1));
+      CFArrayRemoveValueAtIndex (array, 0);
+    }
+  report ("queue", count, elapsed (start));
+  CFRelease (array);
+
+  array = CFArrayCreateMutable (NULL, 0, NULL);
+  start = clock ();
+  for (idx = 0 ; idx < count ; ++idx)
+    CFArrayInsertValueAtIndex (array, 0, (const void *)(uintptr_t)(idx + 1));
+  report ("prepend", count, elapsed (start));
+  CFRelease (array);
+
+  return 0;
+}
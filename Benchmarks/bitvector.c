@@ -0,0 +1,227 @@
+/* bitvector.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+/* Measures CFBitVector operations over a large membership bitmap: counting
+ * bits, setting and flipping ranges, searching a sparse bitmap for the
+ * first and last set bits and combining two bitmaps.  It then builds two
+ * bitmaps with one bit in a thousand set, both flat and compressed, and
+ * compares the memory they use and the time taken to fill, count, walk
+ * and combine them.
+ *
+ * Usage: bitvector [count [sparse-count]]
+ *
+ * Without arguments the bitmaps hold 100000000 bits and the sparse bitmaps
+ * hold 2^28 bits.
+ */
+
+#include "CoreFoundation/CFBitVector.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define REPEAT 10
+
+static clock_t start;
+static CFIndex allocated = 0;
+
+/* An allocator that counts the bytes in use. */
+static void *
+countingAllocate (CFIndex size, CFOptionFlags hint, void *info)
+{
+  CFIndex *block = malloc (size + sizeof(CFIndex) * 2);
+
+  allocated += size;
+  block[0] = size;
+  return block + 2;
+}
+
+static void *
+countingReallocate (void *ptr, CFIndex size, CFOptionFlags hint, void *info)
+{
+  CFIndex *block = (CFIndex *)ptr - 2;
+
+  allocated += size - block[0];
+  block = realloc (block, size + sizeof(CFIndex) * 2);
+  block[0] = size;
+  return block + 2;
+}
+
+static void
+countingDeallocate (void *ptr, void *info)
+{
+  CFIndex *block = (CFIndex *)ptr - 2;
+
+  allocated -= block[0];
+  free (block);
+}
+
+static void
+report (const char *what, CFIndex bits)
+{
+  double seconds = (double)(clock () - start) / CLOCKS_PER_SEC;
+
+  printf ("  %-10s %8.3fs  %8.2f Gbit/s\n", what, seconds,
+          seconds > 0.0 ? (double)bits * REPEAT / seconds / 1e9 : 0.0);
+}
+
+static void
+lap (const char *what)
+{
+  printf ("  %-10s %8.3fs\n", what,
+          (double)(clock () - start) / CLOCKS_PER_SEC);
+}
+
+int
+main (int argc, char *argv[])
+{
+  CFMutableBitVectorRef bv;
+  CFMutableBitVectorRef other;
+  CFRange all;
+  CFIndex count;
+  CFIndex idx;
+  CFIndex sum = 0;
+  int rep;
+
+  count = argc > 1 ? atol (argv[1]) : 100000000;
+  all = CFRangeMake (0, count);
+  printf ("%ld bits\n", (long)count);
+
+  bv = CFBitVectorCreateMutable (NULL, count);
+  other = CFBitVectorCreateMutable (NULL, count);
+  CFBitVectorSetCount (bv, count);
+  CFBitVectorSetCount (other, count);
+  srand (1);
+  for (idx = 0 ; idx < count / 64 ; ++idx)
+    CFBitVectorSetBitAtIndex (other, rand () % count, 1);
+
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    CFBitVectorSetBits (bv, CFRangeMake (rep + 1, count - 2 * rep - 2), 1);
+  report ("set", count);
+
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    sum += CFBitVectorGetCountOfBit (other, CFRangeMake (rep, count - rep), 1);
+  report ("count", count);
+
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    CFBitVectorFlipBits (bv, CFRangeMake (rep + 3, count - 2 * rep - 6));
+  report ("flip", count);
+
+  /* Only the last bit is set, so both searches cross the whole bitmap. */
+  CFBitVectorSetAllBits (bv, 0);
+  CFBitVectorSetBitAtIndex (bv, count - 1, 1);
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    sum += CFBitVectorGetFirstIndexOfBit (bv, CFRangeMake (rep, count - rep),
+                                          1);
+  report ("first", count);
+  CFBitVectorSetBitAtIndex (bv, count - 1, 0);
+  CFBitVectorSetBitAtIndex (bv, 0, 1);
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    sum += CFBitVectorGetLastIndexOfBit (bv, CFRangeMake (0, count - rep), 1);
+  report ("last", count);
+
+  CFBitVectorSetAllBits (bv, 1);
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    CFBitVectorAndBits (bv, all, other);
+  report ("and", count);
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    CFBitVectorOrBits (bv, all, other);
+  report ("or", count);
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    CFBitVectorXorBits (bv, all, other);
+  report ("xor", count);
+  start = clock ();
+  for (rep = 0 ; rep < REPEAT ; ++rep)
+    CFBitVectorAndNotBits (bv, all, other);
+  report ("andnot", count);
+
+  CFRelease (other);
+  CFRelease (bv);
+
+  count = argc > 2 ? atol (argv[2]) : (CFIndex)1 << 28;
+  all = CFRangeMake (0, count);
+  printf ("%ld bits, 0.1%% set\n", (long)count);
+  for (rep = 0 ; rep < 2 ; ++rep)
+    {
+      CFAllocatorContext context = { 0, NULL, NULL, NULL, NULL,
+        countingAllocate, countingReallocate, countingDeallocate, NULL };
+      CFAllocatorRef alloc = CFAllocatorCreate (NULL, &context);
+      CFBitVectorOptions options = rep ? kCFBitVectorCompressed : 0;
+      const char *name = rep ? "compressed" : "flat";
+
+      allocated = 0;
+      bv = CFBitVectorCreateMutableWithOptions (alloc, count, options);
+      other = CFBitVectorCreateMutableWithOptions (alloc, count, options);
+      CFBitVectorSetCount (bv, count);
+      CFBitVectorSetCount (other, count);
+
+      printf (" %s\n", name);
+      srand (2);
+      start = clock ();
+      for (idx = 0 ; idx < count / 1000 ; ++idx)
+        {
+          CFBitVectorSetBitAtIndex (bv,
+            ((CFIndex)rand () << 31 ^ rand ()) % count, 1);
+          CFBitVectorSetBitAtIndex (other,
+            ((CFIndex)rand () << 31 ^ rand ()) % count, 1);
+        }
+      lap ("fill");
+      printf ("  %-10s %8.1f MB\n", "memory", (double)allocated / 2 / 1e6);
+
+      start = clock ();
+      sum += CFBitVectorGetCountOfBit (bv, all, 1);
+      lap ("count");
+
+      /* Visit each set bit in turn. */
+      start = clock ();
+      for (idx = 0 ; idx < count ; ++idx)
+        {
+          idx = CFBitVectorGetFirstIndexOfBit (bv,
+            CFRangeMake (idx, count - idx), 1);
+          if (idx == kCFNotFound)
+            break;
+          ++sum;
+        }
+      lap ("walk");
+
+      start = clock ();
+      CFBitVectorOrBits (bv, all, other);
+      CFBitVectorAndBits (bv, all, other);
+      lap ("or+and");
+
+      CFRelease (other);
+      CFRelease (bv);
+      CFRelease (alloc);
+    }
+
+  printf ("  (%ld)\n", (long)(sum % 10));
+  return 0;
+}
@@ -0,0 +1,153 @@
+/* bsearch.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+/* Measures CFArrayBSearchValues() on plain sorted arrays and on copies made
+ * with CFArrayCreateCopyWithSearchIndex(), for arrays from 1024 values up
+ * to the given count.
+ *
+ * Usage: bsearch [count]
+ *
+ * Without arguments arrays of up to 4194304 values are searched.  On Linux
+ * the cache misses per lookup are counted too, when the kernel allows
+ * reading the hardware counters.
+ */
+
+#include "CoreFoundation/CFArray.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define LOOKUPS 1000000
+
+static CFComparisonResult
+compare (const void *v1, const void *v2, void *context)
+{
+  return (intptr_t)v1 < (intptr_t)v2 ? kCFCompareLessThan
+    : ((intptr_t)v1 > (intptr_t)v2 ? kCFCompareGreaterThan
+       : kCFCompareEqualTo);
+}
+
+static int
+openCounter (void)
+{
+#if defined(__linux__)
+  struct perf_event_attr attr;
+
+  memset (&attr, 0, sizeof (attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof (attr);
+  attr.config = PERF_COUNT_HW_CACHE_MISSES;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return syscall (SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+  return -1;
+#endif
+}
+
+static long long
+readCounter (int fd)
+{
+  long long count = 0;
+
+  if (fd < 0 || read (fd, &count, sizeof (count)) != sizeof (count))
+    return -1;
+  return count;
+}
+
+static void
+measure (const char *what, CFArrayRef array, CFIndex count,
+         const intptr_t *keys, int counter)
+{
+  struct timeval start;
+  struct timeval end;
+  long long misses;
+  double seconds;
+  CFIndex sum = 0;
+  CFIndex idx;
+
+  misses = readCounter (counter);
+  gettimeofday (&start, NULL);
+  for (idx = 0 ; idx < LOOKUPS ; ++idx)
+    sum += CFArrayBSearchValues (array, CFRangeMake (0, count),
+                                 (const void *)keys[idx], compare, NULL);
+  gettimeofday (&end, NULL);
+  if (misses >= 0)
+    misses = readCounter (counter) - misses;
+
+  seconds = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+  printf ("  %-8s %8ld  %7.1f ns/lookup", what, (long)count,
+          seconds * 1e9 / LOOKUPS);
+  if (misses >= 0)
+    printf ("  %6.2f cache misses/lookup", (double)misses / LOOKUPS);
+  else
+    printf ("  cache misses n/a");
+  printf ("  (%ld)\n", (long)(sum % 10));
+}
+
+int
+main (int argc, char *argv[])
+{
+  CFIndex max;
+  CFIndex count;
+  intptr_t *keys;
+  int counter;
+
+  max = argc > 1 ? atol (argv[1]) : 4194304;
+  counter = openCounter ();
+  keys = malloc (LOOKUPS * sizeof (intptr_t));
+
+  srand (1);
+  for (count = 1024 ; count <= max ; count *= 4)
+    {
+      CFMutableArrayRef array;
+      CFArrayRef indexed;
+      CFIndex idx;
+
+      /* Even values, looked up with keys that are half hits. */
+      array = CFArrayCreateMutable (NULL, count, NULL);
+      for (idx = 0 ; idx < count ; ++idx)
+        CFArrayAppendValue (array, (const void *)(2 * idx));
+      for (idx = 0 ; idx < LOOKUPS ; ++idx)
+        keys[idx] = rand () % (2 * count);
+      indexed = CFArrayCreateCopyWithSearchIndex (NULL, array, compare, NULL);
+
+      measure ("plain", array, count, keys, counter);
+      measure ("indexed", indexed, count, keys, counter);
+
+      CFRelease (indexed);
+      CFRelease (array);
+    }
+
+  free (keys);
+  return 0;
+}
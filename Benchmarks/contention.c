@@ -0,0 +1,136 @@
+/* contention.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+/* Measures how lookups in the library's process-wide caches scale with
+ * the number of threads: constant strings (CFSTR), predefined character
+ * sets and time zones created by name.  Every thread does the same number
+ * of lookups, so ideally the throughput grows with the number of cores.
+ *
+ * Usage: contention [lookups per thread]
+ */
+
+#include "CoreFoundation/CFCharacterSet.h"
+#include "CoreFoundation/CFString.h"
+#include "CoreFoundation/CFTimeZone.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#define MAX_THREADS 8
+
+/* CFSTR() is declared pure, so call it through a pointer to keep the
+   compiler from hoisting it out of the loop. */
+static CFStringRef (*volatile makeConstantString) (const char *) =
+  __CFStringMakeConstantString;
+
+static const char *strings[] = { "alpha", "beta", "gamma", "delta",
+  "epsilon", "zeta", "eta", "theta" };
+
+static long lookups;
+
+static double
+now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+  return (double)tv.tv_sec + (double)tv.tv_usec / 1.0e6;
+}
+
+static void *
+constantStrings (void *arg)
+{
+  long idx;
+
+  for (idx = 0 ; idx < lookups ; ++idx)
+    makeConstantString (strings[idx & 7]);
+  return NULL;
+}
+
+static void *
+characterSets (void *arg)
+{
+  long idx;
+
+  for (idx = 0 ; idx < lookups ; ++idx)
+    CFCharacterSetGetPredefined (kCFCharacterSetControl + (idx & 7));
+  return NULL;
+}
+
+static void *
+timeZones (void *arg)
+{
+  long idx;
+
+  for (idx = 0 ; idx < lookups / 1000 ; ++idx)
+    {
+      CFTimeZoneRef tz;
+
+      tz = CFTimeZoneCreateWithName (NULL, CFSTR("Europe/London"), true);
+      if (tz != NULL)
+        CFRelease (tz);
+    }
+  return NULL;
+}
+
+static void
+benchmark (const char *what, void *(*func) (void *), long perThread)
+{
+  pthread_t threads[MAX_THREADS];
+  int count;
+
+  printf ("%s\n", what);
+  func (NULL); /* Fill the cache. */
+  for (count = 1 ; count <= MAX_THREADS ; count *= 2)
+    {
+      double start;
+      double seconds;
+      int idx;
+
+      start = now ();
+      for (idx = 0 ; idx < count ; ++idx)
+        pthread_create (&threads[idx], NULL, func, NULL);
+      for (idx = 0 ; idx < count ; ++idx)
+        pthread_join (threads[idx], NULL);
+      seconds = now () - start;
+
+      printf ("  %d thread%s %10.2f Mops/s  (%.3fs)\n", count,
+              count > 1 ? "s" : " ",
+              seconds > 0.0 ? (double)perThread * count / seconds / 1.0e6
+                            : 0.0, seconds);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  lookups = argc > 1 ? atol (argv[1]) : 1000000;
+
+  benchmark ("CFSTR", constantStrings, lookups);
+  benchmark ("CFCharacterSetGetPredefined", characterSets, lookups);
+  benchmark ("CFTimeZoneCreateWithName", timeZones, lookups / 1000);
+
+  return 0;
+}
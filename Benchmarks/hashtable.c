@@ -0,0 +1,181 @@
+/* hashtable.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+/* Measures insert, lookup, batch lookup and delete throughput of
+ * CFDictionary, which is backed by GSHashTable.  It also measures making
+ * an immutable copy ("freeze") and looking keys up in it ("frozen").
+ *
+ * Usage: hashtable [count ...]
+ *
+ * Without arguments 1000 and 1000000 entries are measured.  Pass 50000000
+ * to measure a large table (this needs a few gigabytes of memory).  Keys
+ * are plain pointers; CFString keys are measured too for tables of up to
+ * one million entries.
+ */
+
+#include "CoreFoundation/CFDictionary.h"
+#include "CoreFoundation/CFString.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Keys per CFDictionaryGetValuesForKeys() call. */
+#define BATCH_SIZE 32
+
+static double
+elapsed (clock_t start)
+{
+  return (double)(clock () - start) / CLOCKS_PER_SEC;
+}
+
+static void
+report (const char *what, CFIndex count, double seconds)
+{
+  printf ("  %-8s %10.2f Mops/s  (%.3fs)\n", what,
+          seconds > 0.0 ? (double)count / seconds / 1.0e6 : 0.0, seconds);
+}
+
+static void
+benchmark (const void **keys, CFIndex count,
+           const CFDictionaryKeyCallBacks *keyCallBacks)
+{
+  CFMutableDictionaryRef dict;
+  CFDictionaryRef frozen;
+  const void *values[BATCH_SIZE];
+  clock_t start;
+  CFIndex idx;
+  CFIndex found;
+
+  dict = CFDictionaryCreateMutable (NULL, 0, keyCallBacks, NULL);
+
+  start = clock ();
+  for (idx = 0 ; idx < count ; ++idx)
+    CFDictionarySetValue (dict, keys[idx], keys[idx]);
+  report ("insert", count, elapsed (start));
+
+  found = 0;
+  start = clock ();
+  for (idx = 0 ; idx < count ; ++idx)
+    found += CFDictionaryGetValue (dict, keys[idx]) != NULL;
+  report ("lookup", count, elapsed (start));
+  if (found != count)
+    printf ("  error: found %ld of %ld keys\n", (long)found, (long)count);
+
+  found = 0;
+  start = clock ();
+  for (idx = 0 ; idx < count ; idx += BATCH_SIZE)
+    {
+      CFIndex n = count - idx < BATCH_SIZE ? count - idx : BATCH_SIZE;
+      found += CFDictionaryGetValuesForKeys (dict, keys + idx, n, values);
+    }
+  report ("batch", count, elapsed (start));
+  if (found != count)
+    printf ("  error: found %ld of %ld keys\n", (long)found, (long)count);
+
+  start = clock ();
+  frozen = CFDictionaryCreateCopy (NULL, dict);
+  report ("freeze", count, elapsed (start));
+
+  found = 0;
+  start = clock ();
+  for (idx = 0 ; idx < count ; ++idx)
+    found += CFDictionaryGetValue (frozen, keys[idx]) != NULL;
+  report ("frozen", count, elapsed (start));
+  if (found != count)
+    printf ("  error: found %ld of %ld keys\n", (long)found, (long)count);
+  CFRelease (frozen);
+
+  start = clock ();
+  for (idx = 0 ; idx < count ; ++idx)
+    CFDictionaryRemoveValue (dict, keys[idx]);
+  report ("delete", count, elapsed (start));
+  if (CFDictionaryGetCount (dict) != 0)
+    printf ("  error: %ld keys left\n", (long)CFDictionaryGetCount (dict));
+
+  CFRelease (dict);
+}
+
+static void
+shuffle (const void **keys, CFIndex count)
+{
+  CFIndex idx;
+
+  for (idx = count - 1 ; idx > 0 ; --idx)
+    {
+      CFIndex other = (CFIndex)(((unsigned long)rand () << 16
+                                 ^ (unsigned long)rand ()) % (idx + 1));
+      const void *tmp = keys[idx];
+      keys[idx] = keys[other];
+      keys[other] = tmp;
+    }
+}
+
+static void
+run (CFIndex count)
+{
+  const void **keys;
+  CFIndex idx;
+
+  keys = malloc (count * sizeof (const void *));
+  if (keys == NULL)
+    {
+      printf ("%ld entries: out of memory\n", (long)count);
+      return;
+    }
+
+  printf ("%ld pointer keys\n", (long)count);
+  for (idx = 0 ; idx < count ; ++idx)
+    keys[idx] = (const void *)((idx + 1) * sizeof (void *));
+  benchmark (keys, count, NULL);
+
+  if (count <= 1000000)
+    {
+      printf ("%ld string keys\n", (long)count);
+      for (idx = 0 ; idx < count ; ++idx)
+        keys[idx] = CFStringCreateWithFormat (NULL, NULL, CFSTR("key-%ld"),
+                                              (long)idx);
+      shuffle (keys, count);
+      benchmark (keys, count, &kCFTypeDictionaryKeyCallBacks);
+      for (idx = 0 ; idx < count ; ++idx)
+        CFRelease (keys[idx]);
+    }
+
+  free (keys);
+}
+
+int
+main (int argc, char **argv)
+{
+  int i;
+
+  if (argc < 2)
+    {
+      run (1000);
+      run (1000000);
+    }
+  for (i = 1 ; i < argc ; ++i)
+    run (atol (argv[i]));
+
+  return 0;
+}
@@ -0,0 +1,107 @@
+/* heap.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+/* Measures CFBinaryHeap used as a timer queue: timers are added with
+ * handles, then the earliest one is repeatedly fired and rescheduled, and
+ * other timers are moved to new fire times by handle.  Heaps with two and
+ * with four children per node are compared.
+ *
+ * Usage: heap [count]
+ *
+ * Without arguments the queue holds 1000000 timers.
+ */
+
+#include "CoreFoundation/CFBinaryHeap.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OPERATIONS 2000000
+
+static CFComparisonResult
+compare (const void *v1, const void *v2, void *info)
+{
+  return (intptr_t)v1 < (intptr_t)v2 ? kCFCompareLessThan
+    : ((intptr_t)v1 > (intptr_t)v2 ? kCFCompareGreaterThan
+       : kCFCompareEqualTo);
+}
+
+int
+main (int argc, char *argv[])
+{
+  CFBinaryHeapCallBacks callBacks = { 0, NULL, NULL, NULL, compare };
+  CFIndex count;
+  CFIndex arity;
+  CFIndex *handles;
+
+  count = argc > 1 ? atol (argv[1]) : 1000000;
+  handles = malloc (count * sizeof (CFIndex));
+  printf ("%ld timers\n", (long)count);
+
+  for (arity = 2 ; arity <= 4 ; arity *= 2)
+    {
+      CFBinaryHeapRef heap;
+      intptr_t now = 0;
+      CFIndex idx;
+      clock_t start;
+      double seconds;
+
+      srand (1);
+      heap = CFBinaryHeapCreateWithArity (NULL, count, arity, &callBacks,
+                                          NULL);
+      start = clock ();
+      for (idx = 0 ; idx < count ; ++idx)
+        handles[idx] = CFBinaryHeapAddValueAndGetHandle (heap,
+          (const void *)(intptr_t)(rand () % count));
+      seconds = (double)(clock () - start) / CLOCKS_PER_SEC;
+      printf ("  %ld children  add %8.3fs", (long)arity, seconds);
+
+      start = clock ();
+      for (idx = 0 ; idx < OPERATIONS ; ++idx)
+        {
+          if (idx & 1)
+            {
+              /* Fire the earliest timer and schedule it again. */
+              now = (intptr_t)CFBinaryHeapGetMinimum (heap);
+              CFBinaryHeapRemoveMinimumValue (heap);
+              CFBinaryHeapAddValue (heap,
+                (const void *)(now + rand () % count));
+            }
+          else
+            {
+              /* Reschedule some other timer. */
+              CFBinaryHeapReplaceValueForHandle (heap,
+                handles[rand () % count],
+                (const void *)(now + rand () % count));
+            }
+        }
+      seconds = (double)(clock () - start) / CLOCKS_PER_SEC;
+      printf ("  fire/reschedule %8.3fs\n", seconds);
+      CFRelease (heap);
+    }
+
+  free (handles);
+  return 0;
+}
@@ -0,0 +1,181 @@
+/* sort.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+/* Measures CFArraySortValues() and CFArraySortValuesStable() on inputs
+ * with different patterns, and CFArraySortValuesConcurrently(),
+ * CFArrayGetTopValues() and CFArraySelectValue() on random input.
+ *
+ * Usage: sort [count]
+ *
+ * Without arguments 1000000 values are sorted.  The concurrent sort uses
+ * as many threads as GNUSTEP_COREBASE_THREADS says, so to see how it
+ * scales run for example
+ *
+ *   for t in 1 2 4 8 16; do GNUSTEP_COREBASE_THREADS=$t ./obj/sort; done
+ */
+
+#include "CoreFoundation/CFArray.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+
+static CFIndex comparisons;
+
+static CFComparisonResult
+compare (const void *v1, const void *v2, void *context)
+{
+  ++comparisons;
+  return (intptr_t)v1 < (intptr_t)v2 ? kCFCompareLessThan
+    : ((intptr_t)v1 > (intptr_t)v2 ? kCFCompareGreaterThan
+       : kCFCompareEqualTo);
+}
+
+/* Like compare(), but without counting, so it is thread-safe. */
+static CFComparisonResult
+compareConcurrently (const void *v1, const void *v2, void *context)
+{
+  return (intptr_t)v1 < (intptr_t)v2 ? kCFCompareLessThan
+    : ((intptr_t)v1 > (intptr_t)v2 ? kCFCompareGreaterThan
+       : kCFCompareEqualTo);
+}
+
+static intptr_t
+value (int pattern, CFIndex idx, CFIndex count)
+{
+  switch (pattern)
+    {
+      case 0:  return rand ();
+      case 1:  return idx;
+      case 2:  return count - idx;
+      case 3:  return 42;
+      case 4:  return rand () % 16;
+      case 5:  return idx < count / 2 ? idx : count - idx;
+      default: return idx % 1000 == 0 ? rand () : idx;
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *names[] = { "random", "sorted", "reverse", "equal",
+    "few keys", "pipe", "near sorted" };
+  CFIndex count;
+  int pattern;
+
+  count = argc > 1 ? atol (argv[1]) : 1000000;
+  printf ("%ld values\n", (long)count);
+
+  srand (1);
+  for (pattern = 0 ; pattern < 7 ; ++pattern)
+    {
+      CFMutableArrayRef array;
+      CFMutableArrayRef copy;
+      CFIndex idx;
+      clock_t start;
+      double seconds;
+
+      array = CFArrayCreateMutable (NULL, count, NULL);
+      for (idx = 0 ; idx < count ; ++idx)
+        CFArrayAppendValue (array,
+                            (const void *)value (pattern, idx, count));
+      copy = CFArrayCreateMutableCopy (NULL, count, array);
+
+      comparisons = 0;
+      start = clock ();
+      CFArraySortValues (array, CFRangeMake (0, count), compare, NULL);
+      seconds = (double)(clock () - start) / CLOCKS_PER_SEC;
+      printf ("  %-12s %8.3fs  %6.2f comparisons per value\n",
+              names[pattern], seconds, (double)comparisons / count);
+
+      comparisons = 0;
+      start = clock ();
+      CFArraySortValuesStable (copy, CFRangeMake (0, count), compare, NULL);
+      seconds = (double)(clock () - start) / CLOCKS_PER_SEC;
+      printf ("  %-12s %8.3fs  %6.2f comparisons per value (stable)\n",
+              "", seconds, (double)comparisons / count);
+      CFRelease (copy);
+      CFRelease (array);
+    }
+
+  {
+    CFMutableArrayRef array;
+    CFIndex idx;
+    struct timeval start;
+    struct timeval end;
+    const char *threads = getenv ("GNUSTEP_COREBASE_THREADS");
+
+    array = CFArrayCreateMutable (NULL, count, NULL);
+    for (idx = 0 ; idx < count ; ++idx)
+      CFArrayAppendValue (array, (const void *)value (0, idx, count));
+
+    /* Measure wall-clock time, as several threads are working. */
+    gettimeofday (&start, NULL);
+    CFArraySortValuesConcurrently (array, CFRangeMake (0, count),
+                                   compareConcurrently, NULL);
+    gettimeofday (&end, NULL);
+    printf ("  %-12s %8.3fs  (concurrent, %s threads)\n", "random",
+            (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6,
+            threads ? threads : "default");
+    CFRelease (array);
+  }
+
+  {
+    CFMutableArrayRef array;
+    CFIndex idx;
+    CFIndex k;
+    const void **top;
+    clock_t start;
+    double seconds;
+
+    array = CFArrayCreateMutable (NULL, count, NULL);
+    for (idx = 0 ; idx < count ; ++idx)
+      CFArrayAppendValue (array, (const void *)value (0, idx, count));
+    top = malloc (100 * sizeof (const void *));
+
+    for (k = 10 ; k <= 100 ; k *= 10)
+      {
+        comparisons = 0;
+        start = clock ();
+        CFArrayGetTopValues (array, CFRangeMake (0, count), k, compare, NULL,
+                             top);
+        seconds = (double)(clock () - start) / CLOCKS_PER_SEC;
+        printf ("  %-12s %8.3fs  %6.2f comparisons per value (top %ld)\n",
+                "random", seconds, (double)comparisons / count, (long)k);
+      }
+
+    comparisons = 0;
+    start = clock ();
+    CFArraySelectValue (array, CFRangeMake (0, count), count / 2, compare,
+                        NULL);
+    seconds = (double)(clock () - start) / CLOCKS_PER_SEC;
+    printf ("  %-12s %8.3fs  %6.2f comparisons per value (median)\n",
+            "random", seconds, (double)comparisons / count);
+    free (top);
+    CFRelease (array);
+  }
+
+  return 0;
+}
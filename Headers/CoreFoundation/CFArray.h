@@ -41,6 +41,9 @@ typedef const struct __CFArray *CFArrayRef;
  */
 typedef struct __CFArray *CFMutableArrayRef;
 
+/* CFLocale.h includes this header, so CFLocaleRef cannot be used here. */
+struct __CFLocale;
+
 /** \defgroup CFArrayRef CFArray Reference
     \brief A CFArray and its mutable type, \ref CFMutableArrayRef
       "CFMutableArray", are simple, low overhead, ordered containers for
@@ -94,6 +97,28 @@ CFArrayCreate (CFAllocatorRef allocator, const void **values,
 
 CF_EXPORT CFArrayRef
 CFArrayCreateCopy (CFAllocatorRef allocator, CFArrayRef theArray);
+
+/** \brief Creates an immutable copy of a sorted array that is quicker to
+    search (GNUstep extension).
+    \details Besides the values, the copy holds them in the order of a
+    breadth-first walk of a binary search tree (the Eytzinger layout).
+    CFArrayBSearchValues() called on the copy with the same comparator and
+    context reads this layout from front to back, fetching the cache lines
+    it needs ahead of time, which makes searching arrays much larger than
+    the processor caches up to twice as fast.  The copy needs about twice
+    the memory of a plain array, so it is worth it for large arrays that
+    are searched very often.
+    \param allocator The allocator to use.
+    \param theArray The array to copy.  It must be sorted with comparator.
+    \param comparator The function used to sort theArray.
+    \param context The pointer passed to comparator.
+    \return The copy, or NULL if it could not be created.
+ */
+CF_EXPORT CFArrayRef
+CFArrayCreateCopyWithSearchIndex (CFAllocatorRef allocator,
+                                  CFArrayRef theArray,
+                                  CFComparatorFunction comparator,
+                                  void *context);
 /** \} */
 
 /** \name Examining an Array
@@ -122,6 +147,27 @@ CFArrayGetLastIndexOfValue (CFArrayRef theArray, CFRange range,
 CF_EXPORT void
 CFArrayGetValues (CFArrayRef theArray, CFRange range, const void **values);
 
+/** \brief Gets the smallest values of a range in ascending order (GNUstep
+    extension).
+    \details The array is not modified.  The values are found with a heap
+    of count values, which takes O(n log count) time for a range of n
+    values, so this is much faster than sorting a copy of a large range
+    when only a few values are needed.  As with CFArrayGetValues(), the
+    values are not retained.
+    \param theArray The array to search.
+    \param range The range of values to consider.
+    \param count The number of values to get.
+    \param comparator The function used to compare values.
+    \param context A pointer passed to comparator.
+    \param values A C array with room for count values.
+    \return The number of values stored in values, which is the smaller of
+      count and range.length.
+ */
+CF_EXPORT CFIndex
+CFArrayGetTopValues (CFArrayRef theArray, CFRange range, CFIndex count,
+                     CFComparatorFunction comparator, void *context,
+                     const void **values);
+
 CF_EXPORT const void *CFArrayGetValueAtIndex (CFArrayRef theArray, CFIndex idx);
 /** \} */
 
@@ -177,14 +223,102 @@ CF_EXPORT void
 CFArrayReplaceValues (CFMutableArrayRef theArray, CFRange range,
                       const void **newValues, CFIndex newCount);
 
+/** \brief Makes room for at least capacity values (GNUstep extension).
+    \details The array grows by half its capacity whenever it runs out of
+    space, so appending is cheap on average.  Callers that know how many
+    values they will add can avoid the intermediate reallocations by
+    reserving the space up front.
+    \param theArray The array.
+    \param capacity The number of values the array must be able to hold
+      without reallocating.
+ */
+CF_EXPORT void
+CFArrayReserveCapacity (CFMutableArrayRef theArray, CFIndex capacity);
+
+/** \brief Releases storage the array is not using (GNUstep extension).
+    \details Use this after removing many values from an array that will
+    be kept for a long time.
+    \param theArray The array.
+ */
+CF_EXPORT void CFArrayShrinkToFit (CFMutableArrayRef theArray);
+
 CF_EXPORT void
 CFArraySetValueAtIndex (CFMutableArrayRef theArray, CFIndex idx,
                         const void *value);
 
+/** \brief Puts the value that sorting would place at an index there,
+    without sorting the rest of the range (GNUstep extension).
+    \details Afterwards no value in range before idx is greater than the
+    value at idx, and no value after it is less.  The values on either side
+    are otherwise in no particular order.  This takes linear time on
+    average and O(n log n) at worst.
+    \param theArray The array to reorder.
+    \param range The range of values to reorder.
+    \param idx The index of the value to select.  It must be in range.
+    \param comparator The function used to compare values.
+    \param context A pointer passed to comparator.
+ */
+CF_EXPORT void
+CFArraySelectValue (CFMutableArrayRef theArray, CFRange range, CFIndex idx,
+                    CFComparatorFunction comparator, void *context);
+
 CF_EXPORT void
 CFArraySortValues (CFMutableArrayRef theArray, CFRange range,
                    CFComparatorFunction comparator, void *context);
 
+/** \brief Sorts values using several threads (GNUstep extension).
+    \details Ranges of at least 65536 values (or the number given by the
+    GNUSTEP_COREBASE_SORT_THRESHOLD environment variable) are split into
+    slices that are sorted and then merged on a pool of worker threads.
+    The pool has one thread per processor, up to 16, unless the
+    GNUSTEP_COREBASE_THREADS environment variable says otherwise.
+    Smaller ranges are sorted like CFArraySortValues() does.  The sort is
+    not stable.
+    \param theArray The array to sort.
+    \param range The range of values to sort.
+    \param comparator The function used to compare values.  It is called
+      from several threads at once, so it must be thread-safe.
+    \param context A pointer passed to comparator.
+ */
+CF_EXPORT void
+CFArraySortValuesConcurrently (CFMutableArrayRef theArray, CFRange range,
+                               CFComparatorFunction comparator,
+                               void *context);
+
+/** \brief Sorts values, keeping equal values in their order (GNUstep
+    extension).
+    \details Unlike CFArraySortValues(), values that compare equal keep
+    their relative order, so sorting by one key and then by another gives
+    an array ordered by the second key and then by the first.  This is a
+    merge sort that takes advantage of runs of values that are already in
+    order, so an array that is mostly sorted is sorted quickly.  It needs
+    temporary storage for half of the values, which is allocated with the
+    array's allocator.
+    \param theArray The array to sort.
+    \param range The range of values to sort.
+    \param comparator The function used to compare values.
+    \param context A pointer passed to comparator.
+ */
+CF_EXPORT void
+CFArraySortValuesStable (CFMutableArrayRef theArray, CFRange range,
+                         CFComparatorFunction comparator, void *context);
+
+/** \brief Sorts a range of an array of CFStrings (GNUstep extension).
+    \details The result is the same as sorting with
+    CFStringCompareWithOptionsAndLocale(), but the collation key of each
+    string is computed only once, so sorting costs one collation per
+    element instead of one per comparison.  If the keys cannot be
+    allocated the array is left unchanged.
+    \param theArray The array of CFStrings to sort.
+    \param range The range of values to sort.
+    \param compareOptions The CFStringCompareFlags to compare with.
+    \param locale The CFLocaleRef to compare with, or NULL.
+ */
+CF_EXPORT void
+CFArraySortValuesUsingCollation (CFMutableArrayRef theArray, CFRange range,
+                                 CFOptionFlags compareOptions,
+                                 const struct __CFLocale *locale);
+
 /** \} */
 
 CF_EXTERN_C_END
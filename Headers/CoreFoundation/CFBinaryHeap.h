@@ -79,9 +79,47 @@ CF_EXPORT CFBinaryHeapRef
 CFBinaryHeapCreateCopy (CFAllocatorRef allocator, CFIndex capacity,
   CFBinaryHeapRef heap);
 
+/** \brief Creates a heap whose nodes have more than two children (GNUstep
+    extension).
+    \details With four children per node the heap is half as deep as a
+    binary heap and the children of a node share a cache line, so adding
+    and removing values touches less memory.  Removing the minimum compares
+    more children per level, so this pays off for large heaps and for
+    values that are cheap to compare.
+    \param allocator The allocator to use.
+    \param capacity A hint for the number of values the heap will hold.
+    \param arity The number of children of each node, 2, 4 or 8.  Other
+      numbers are rounded up to one of these, and numbers above 8 are
+      treated as 8.
+    \param callBacks The callbacks for the values, or NULL.
+    \param compareContext The context passed to the compare callback, or
+      NULL.
+    \return The new heap.
+ */
+CF_EXPORT CFBinaryHeapRef
+CFBinaryHeapCreateWithArity (CFAllocatorRef allocator, CFIndex capacity,
+  CFIndex arity, const CFBinaryHeapCallBacks *callBacks,
+  const CFBinaryHeapCompareContext *compareContext);
+
 CF_EXPORT void
 CFBinaryHeapAddValue (CFBinaryHeapRef heap, const void *value);
 
+/** \brief Adds a value and returns a handle to it (GNUstep extension).
+    \details The handle identifies the value while it is in the heap, so
+    it can be removed or given a new priority with
+    CFBinaryHeapRemoveValueForHandle() and
+    CFBinaryHeapReplaceValueForHandle() in O(log n) time, without searching
+    for it.  Once the value leaves the heap its handle may be given to a
+    value added later.  Handles are small non-negative numbers.  Values
+    added with CFBinaryHeapAddValue() get handles too, but they are not
+    returned.  Copies of the heap do not keep the handles.
+    \param heap The heap.
+    \param value The value to add.
+    \return The handle of the value.
+ */
+CF_EXPORT CFIndex
+CFBinaryHeapAddValueAndGetHandle (CFBinaryHeapRef heap, const void *value);
+
 CF_EXPORT void
 CFBinaryHeapApplyFunction (CFBinaryHeapRef heap,
   CFBinaryHeapApplierFunction applier, void *context);
@@ -101,6 +139,12 @@ CFBinaryHeapGetMinimum (CFBinaryHeapRef heap);
 CF_EXPORT Boolean
 CFBinaryHeapGetMinimumIfPresent (CFBinaryHeapRef heap, const void **value);
 
+/** \brief Returns the value with a handle, or NULL if the handle is not in
+    use (GNUstep extension).
+ */
+CF_EXPORT const void *
+CFBinaryHeapGetValueForHandle (CFBinaryHeapRef heap, CFIndex handle);
+
 CF_EXPORT void
 CFBinaryHeapGetValues (CFBinaryHeapRef heap, const void **values);
 
@@ -110,6 +154,22 @@ CFBinaryHeapRemoveAllValues (CFBinaryHeapRef heap);
 CF_EXPORT void
 CFBinaryHeapRemoveMinimumValue (CFBinaryHeapRef heap);
 
+/** \brief Removes the value with a handle (GNUstep extension).
+    \details Nothing happens if the handle is not in use.
+ */
+CF_EXPORT void
+CFBinaryHeapRemoveValueForHandle (CFBinaryHeapRef heap, CFIndex handle);
+
+/** \brief Replaces the value with a handle and moves it to its new place
+    (GNUstep extension).
+    \details The handle keeps referring to the new value.  If the value is
+    an object whose priority has changed, passing the same value moves it
+    to its new place.  Nothing happens if the handle is not in use.
+ */
+CF_EXPORT void
+CFBinaryHeapReplaceValueForHandle (CFBinaryHeapRef heap, CFIndex handle,
+  const void *value);
+
 CF_EXPORT CFTypeID
 CFBinaryHeapGetTypeID (void);
 
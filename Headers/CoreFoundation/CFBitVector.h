@@ -41,6 +41,18 @@ typedef struct __CFBitVector *CFMutableBitVectorRef;
  */
 typedef UInt32 CFBit;
 
+/** \brief Options for CFBitVectorCreateMutableWithOptions() (GNUstep
+    extension).
+ */
+typedef enum
+{
+  /** Store the bits in chunks of 2^16, each kept as a sorted array of the
+      bits set, a plain bitmap or a list of runs, whichever is smallest.
+      Chunks with no bits set take no space, which suits large, sparse
+      bit vectors. */
+  kCFBitVectorCompressed = (1 << 0)
+} CFBitVectorOptions;
+
 /** \name Creating a Bit Vector
     \{
  */
@@ -93,6 +105,23 @@ CFBitVectorGetTypeID (void);
 CF_EXPORT CFMutableBitVectorRef
 CFBitVectorCreateMutable (CFAllocatorRef allocator, CFIndex capacity);
 
+/** \brief Creates an empty mutable bit vector (GNUstep extension).
+    \details With kCFBitVectorCompressed the bit vector uses memory in
+    proportion to the bits that are set, or to the runs of set bits, rather
+    than to its count.  Counting, searching and combining with another
+    compressed bit vector work on whole chunks at a time.  The other
+    functions work as they do on any bit vector, and copies of the bit
+    vector are also compressed.
+    \param allocator The allocator to use.
+    \param capacity The number of bits to make room for.  It is ignored
+    for a compressed bit vector.
+    \param options A combination of CFBitVectorOptions.
+    \return A new mutable bit vector with a count of 0.
+ */
+CF_EXPORT CFMutableBitVectorRef
+CFBitVectorCreateMutableWithOptions (CFAllocatorRef allocator,
+  CFIndex capacity, CFBitVectorOptions options);
+
 CF_EXPORT CFMutableBitVectorRef
 CFBitVectorCreateMutableCopy (CFAllocatorRef allocator, CFIndex capacity,
   CFBitVectorRef bv);
@@ -118,6 +147,44 @@ CFBitVectorSetBits (CFMutableBitVectorRef bv, CFRange range, CFBit value);
 
 CF_EXPORT void
 CFBitVectorSetCount (CFMutableBitVectorRef bv, CFIndex count);
+
+/** \brief Sets the bits in range to the AND of their values in bv and in
+    other (GNUstep extension).
+    \details The bits are combined a word at a time.  The range must be
+    within both bit vectors, and the bits in other are taken from the same
+    positions as those in bv.
+    \param bv The bit vector to change.
+    \param range The range of bits to combine.
+    \param other The other bit vector.  It may be bv itself.  Combining
+    two compressed bit vectors is fastest.
+ */
+CF_EXPORT void
+CFBitVectorAndBits (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other);
+
+/** \brief Sets the bits in range to the OR of their values in bv and in
+    other (GNUstep extension).
+    \see CFBitVectorAndBits()
+ */
+CF_EXPORT void
+CFBitVectorOrBits (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other);
+
+/** \brief Sets the bits in range to the exclusive OR of their values in bv
+    and in other (GNUstep extension).
+    \see CFBitVectorAndBits()
+ */
+CF_EXPORT void
+CFBitVectorXorBits (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other);
+
+/** \brief Clears the bits in range that are set in other (GNUstep
+    extension).
+    \see CFBitVectorAndBits()
+ */
+CF_EXPORT void
+CFBitVectorAndNotBits (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other);
 /** \} */
 /** \} */
 
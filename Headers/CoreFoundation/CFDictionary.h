@@ -115,6 +115,23 @@ CF_EXPORT const void *CFDictionaryGetValue (CFDictionaryRef theDict,
 CF_EXPORT Boolean
 CFDictionaryGetValueIfPresent (CFDictionaryRef theDict, const void *key,
                                const void **value);
+
+/** \brief Looks up many keys at once (GNUstep extension).
+    \details All keys are hashed before any is looked up, so the memory
+    accesses for different keys overlap.  This is faster than calling
+    CFDictionaryGetValue() in a loop when looking up many keys in a large
+    dictionary.
+    \param theDict The dictionary to search.
+    \param keys An array of numKeys keys.
+    \param numKeys The number of keys.
+    \param values An array of numKeys pointers that receives the value of
+      each key, or NULL for keys that are not in the dictionary.
+    \return The number of keys found.
+    \see CFSetContainsValues()
+ */
+CF_EXPORT CFIndex
+CFDictionaryGetValuesForKeys (CFDictionaryRef theDict, const void **keys,
+                              CFIndex numKeys, const void **values);
 /** \} */
 
 /** \name Applying a funcation to a dictionary
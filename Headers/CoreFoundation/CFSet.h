@@ -86,6 +86,21 @@ CF_EXPORT const void *CFSetGetValue (CFSetRef set, const void *value);
 CF_EXPORT Boolean
 CFSetGetValueIfPresent (CFSetRef set, const void *candidate,
                         const void **value);
+
+/** \brief Tests many values for membership at once (GNUstep extension).
+    \details All values are hashed before any is looked up, so the memory
+    accesses for different values overlap.
+    \param set The set to search.
+    \param values An array of numValues values.
+    \param numValues The number of values.
+    \param contained An array of numValues Booleans that receives whether
+      each value is in the set, or NULL.
+    \return The number of values in the set.
+    \see CFDictionaryGetValuesForKeys()
+ */
+CF_EXPORT CFIndex
+CFSetContainsValues (CFSetRef set, const void **values, CFIndex numValues,
+                     Boolean *contained);
 /** \} */
 
 /** \name Applying a funcation to a set
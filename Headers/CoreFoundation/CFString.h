@@ -231,6 +231,17 @@ CFStringCompareWithOptionsAndLocale (CFStringRef theString1,
   CFStringRef theString2, CFRange rangeToCOmpare,
   CFStringCompareFlags compareOptions, CFLocaleRef locale);
 #endif
+
+/** \brief Creates a binary collation key for a string (GNUstep extension).
+    \details Comparing the bytes of two keys created with the same options
+      and locale, with the shorter key first when one is a prefix of the
+      other, gives the same order as CFStringCompareWithOptionsAndLocale().
+      Creating the keys once is much cheaper than collating the strings
+      repeatedly, for example while sorting.
+ */
+CF_EXPORT CFDataRef
+CFStringCreateCollationKey (CFAllocatorRef alloc, CFStringRef theString,
+  CFStringCompareFlags compareOptions, CFLocaleRef locale);
 /** \} */
 
 /** \name Accessing Characters
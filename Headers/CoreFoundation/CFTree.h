@@ -57,6 +57,37 @@ struct _CFTreeContext
  */
 CF_EXPORT CFTreeRef
 CFTreeCreate (CFAllocatorRef allocator, const CFTreeContext *context);
+
+/** \brief Creates the root of a tree whose nodes share one memory
+    region (GNUstep extension).
+    \details Nodes made with CFTreeCreateInArena() are carved out of
+    blocks owned by the root.  When the root is deallocated the blocks are
+    freed in one step instead of node by node.  The context release
+    callback is still called for every node still in the tree, and trees
+    made by other means that were added to it are released as usual.
+
+    Nodes in the arena must not be used after the root is deallocated,
+    even if they were retained or removed from the tree.  Creating nodes in
+    an arena is not thread safe.
+    \param allocator The allocator used for the root and the arena blocks.
+    \param context The context for the root.
+    \return A new tree, or NULL on failure.
+ */
+CF_EXPORT CFTreeRef
+CFTreeCreateWithArena (CFAllocatorRef allocator, const CFTreeContext *context);
+
+/** \brief Creates a tree in the same arena as another tree (GNUstep
+    extension).
+    \details If tree was not created in an arena this behaves like
+    CFTreeCreate() with the allocator of tree.
+    \param tree A tree created with CFTreeCreateWithArena() or
+    CFTreeCreateInArena().
+    \param context The context for the new tree.
+    \return A new tree, or NULL on failure.
+    \see CFTreeCreateWithArena()
+ */
+CF_EXPORT CFTreeRef
+CFTreeCreateInArena (CFTreeRef tree, const CFTreeContext *context);
 /** \} */
 
 /** \name Modifying a Tree
@@ -84,6 +115,10 @@ CFTreeSetContext (CFTreeRef tree, const CFTreeContext *context);
 /** \name Sorting a Tree
     \{
  */
+/** \brief Sorts the children of tree.
+    \details The comparator is passed two of the children (not their
+    info pointers).  The sort is not stable.
+ */
 CF_EXPORT void
 CFTreeSortChildren (CFTreeRef tree, CFComparatorFunction comp, void *context);
 /** \} */
@@ -122,6 +157,20 @@ CFTreeGetParent (CFTreeRef tree);
 CF_EXPORT void
 CFTreeApplyFunctionToChildren (CFTreeRef tree, CFTreeApplierFunction applier,
   void *context);
+
+/** \brief Calls a function for every descendant of a tree (GNUstep
+    extension).
+    \details The descendants are visited depth first, each one before its
+    children.  The tree itself is not visited.  The walk uses no stack, so
+    it works for trees of any depth.  The applier must not add or remove
+    trees.
+    \param tree The tree whose descendants are visited.
+    \param applier The function to call for each descendant.
+    \param context A pointer passed to the applier.
+ */
+CF_EXPORT void
+CFTreeApplyFunctionToDescendants (CFTreeRef tree,
+  CFTreeApplierFunction applier, void *context);
 /** \} */
 
 /** \name Getting the Tree Type ID
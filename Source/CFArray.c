@@ -32,6 +32,7 @@
 #include "GSCArray.h"
 #include "GSObjCRuntime.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 struct __CFArray
@@ -49,13 +50,33 @@ struct __CFMutableArray
   const void **_contents;
   CFIndex _count;
   CFIndex _capacity;
+  CFIndex _head;
+};
+
+/* An immutable array created by CFArrayCreateCopyWithSearchIndex().  Its
+ * values are followed by the Eytzinger layout used by
+ * GSCArrayEytzingerSearch().
+ */
+struct __CFIndexedArray
+{
+  CFRuntimeBase _parent;
+  const CFArrayCallBacks *_callBacks;
+  const void **_contents;
+  CFIndex _count;
+  CFComparatorFunction _comparator;
+  void *_context;
+  const void **_layout;
 };
 
 static CFTypeID _kCFArrayTypeID = 0;
 
+/* Smaller ranges are sorted on the calling thread only. */
+static CFIndex _kCFArrayConcurrentSortThreshold = 65536;
+
 enum
 {
-  _kCFArrayIsMutable = (1 << 0)
+  _kCFArrayIsMutable = (1 << 0),
+  _kCFArrayHasSearchIndex = (1 << 1)
 };
 
 CF_INLINE Boolean
@@ -71,6 +92,13 @@ CFArraySetMutable (CFArrayRef array)
   ((CFRuntimeBase *) array)->_flags.info |= _kCFArrayIsMutable;
 }
 
+CF_INLINE Boolean
+CFArrayHasSearchIndex (CFArrayRef array)
+{
+  return ((CFRuntimeBase *) array)->_flags.info & _kCFArrayHasSearchIndex ?
+    true : false;
+}
+
 const CFArrayCallBacks kCFTypeArrayCallBacks = {
   0,
   CFTypeRetainCallBack,
@@ -103,7 +131,11 @@ CFArrayFinalize (CFTypeRef cf)
     }
 
   if (CFArrayIsMutable (array))
-    CFAllocatorDeallocate (alloc, array->_contents);
+    {
+      struct __CFMutableArray *mArray = (struct __CFMutableArray *) array;
+
+      CFAllocatorDeallocate (alloc, mArray->_contents - mArray->_head);
+    }
 }
 
 static Boolean
@@ -191,7 +223,13 @@ static CFRuntimeClass CFArrayClass = {
 void
 CFArrayInitialize (void)
 {
+  const char *threshold;
+
   _kCFArrayTypeID = _CFRuntimeRegisterClass (&CFArrayClass);
+
+  threshold = getenv ("GNUSTEP_COREBASE_SORT_THRESHOLD");
+  if (threshold != NULL)
+    _kCFArrayConcurrentSortThreshold = strtol (threshold, NULL, 10);
 }
 
 
@@ -258,6 +296,55 @@ CFArrayCreateCopy (CFAllocatorRef allocator, CFArrayRef array)
                         array->_callBacks);
 }
 
+CFArrayRef
+CFArrayCreateCopyWithSearchIndex (CFAllocatorRef allocator, CFArrayRef array,
+                                  CFComparatorFunction comparator,
+                                  void *context)
+{
+  struct __CFIndexedArray *new;
+  const CFArrayCallBacks *callBacks;
+  CFIndex count;
+  CFIndex size;
+  CFIndex idx;
+  uintptr_t layout;
+
+  if (CF_IS_OBJC (_kCFArrayTypeID, array))
+    callBacks = &kCFTypeArrayCallBacks;
+  else
+    callBacks = array->_callBacks;
+  count = CFArrayGetCount (array);
+
+  /* The values, then the layout, which starts at 1, and room to align the
+     layout to a cache line. */
+  size = sizeof (struct __CFIndexedArray) - sizeof (CFRuntimeBase)
+    + (2 * count + 1) * sizeof (void *) + GSCARRAY_EYTZINGER_ALIGNMENT;
+  new = (struct __CFIndexedArray *) _CFRuntimeCreateInstance (allocator,
+                                                              _kCFArrayTypeID,
+                                                              size, 0);
+  if (new)
+    {
+      new->_callBacks = callBacks;
+      new->_contents = (const void **) &new[1];
+      new->_count = count;
+      new->_comparator = comparator;
+      new->_context = context;
+      layout = (uintptr_t) (new->_contents + count);
+      layout = (layout + GSCARRAY_EYTZINGER_ALIGNMENT - 1)
+        & ~(uintptr_t) (GSCARRAY_EYTZINGER_ALIGNMENT - 1);
+      new->_layout = (const void **) layout;
+
+      CFArrayGetValues (array, CFRangeMake (0, count), new->_contents);
+      if (callBacks->retain)
+        for (idx = 0; idx < count; ++idx)
+          callBacks->retain (allocator, new->_contents[idx]);
+
+      GSCArrayEytzingerLayout (new->_contents, count, new->_layout);
+      ((CFRuntimeBase *) new)->_flags.info |= _kCFArrayHasSearchIndex;
+    }
+
+  return (CFArrayRef) new;
+}
+
 void
 CFArrayApplyFunction (CFArrayRef array, CFRange range,
                       CFArrayApplierFunction applier, void *context)
@@ -272,34 +359,47 @@ CFIndex
 CFArrayBSearchValues (CFArrayRef array, CFRange range, const void *value,
                       CFComparatorFunction comparator, void *context)
 {
-  CFIndex min, max, mid;
-
-  min = range.location;
-  max = range.location + range.length - 1;
+  CFIndex idx;
 
-  while (min <= max)
+  if (CF_IS_OBJC (_kCFArrayTypeID, array))
     {
-      const void *midValue;
-      CFComparisonResult res;
+      CFIndex min = range.location;
+      CFIndex max = range.location + range.length;
 
-      mid = (min + max) / 2;
-      midValue = CFArrayGetValueAtIndex (array, mid);
-      res = comparator (midValue, value, context);
-      if (res == kCFCompareEqualTo)
+      while (min < max)
         {
-          max = mid - 1;
-          break;
-        }
-      else if (res == kCFCompareGreaterThan)
-        {
-          max = mid - 1;
+          CFIndex mid = min + (max - min) / 2;
+
+          if (comparator (CFArrayGetValueAtIndex (array, mid), value, context)
+              == kCFCompareLessThan)
+            min = mid + 1;
+          else
+            max = mid;
         }
-      else
+      return min;
+    }
+
+  if (CFArrayHasSearchIndex (array))
+    {
+      struct __CFIndexedArray *iArray = (struct __CFIndexedArray *) array;
+
+      /* The whole array is sorted, so the position in the range follows
+         from the position in the array. */
+      if (iArray->_comparator == comparator && iArray->_context == context)
         {
-          min = mid + 1;
+          idx = GSCArrayEytzingerSearch (iArray->_layout, iArray->_count,
+                                         value, comparator, context);
+          if (idx < range.location)
+            return range.location;
+          if (idx > range.location + range.length)
+            return range.location + range.length;
+          return idx;
         }
     }
-  return max + 1;
+
+  idx = GSCArrayBSearch (array->_contents + range.location, value,
+                         range.length, comparator, context);
+  return range.location + idx;
 }
 
 Boolean
@@ -434,28 +534,150 @@ CFArrayGetValues (CFArrayRef array, CFRange range, const void **values)
           range.length * sizeof (const void *));
 }
 
+CFIndex
+CFArrayGetTopValues (CFArrayRef array, CFRange range, CFIndex count,
+                     CFComparatorFunction comparator, void *context,
+                     const void **values)
+{
+  if (count > range.length)
+    count = range.length;
+  if (count <= 0)
+    return 0;
+
+  if (CF_IS_OBJC (_kCFArrayTypeID, array))
+    {
+      const void **contents;
+
+      contents = CFAllocatorAllocate (NULL, range.length * sizeof (void *), 0);
+      CFArrayGetValues (array, range, contents);
+      GSCArrayTopValues (contents, range.length, values, count, comparator,
+                         context);
+      CFAllocatorDeallocate (NULL, contents);
+      return count;
+    }
+
+  GSCArrayTopValues (array->_contents + range.location, range.length, values,
+                     count, comparator, context);
+  return count;
+}
+
 
 
 #define DEFAULT_ARRAY_CAPACITY 16
 #define CFMUTABLEARRAY_SIZE sizeof(struct __CFMutableArray) - sizeof(CFRuntimeBase)
 
-CF_INLINE void
-CFArrayCheckCapacityAndGrow (CFMutableArrayRef array, CFIndex newCapacity)
+/* The values of a mutable array are contiguous, but need not start at the
+ * beginning of its storage: _head slots are free in front of them and
+ * _capacity - _head - _count behind them.  Values are inserted and removed
+ * by moving whichever side of the affected range is shorter, so working at
+ * either end of the array is amortized O(1), as with a deque, and working
+ * in the middle moves at most half of the values.
+ */
+
+/* Moves the values into storage for newCapacity values, with newHead slots
+   free in front of them.  The oldGap slots after the first split values
+   become newGap slots; their contents are not preserved. */
+static void
+CFArrayRelocate (struct __CFMutableArray *mArray, CFIndex newCapacity,
+                 CFIndex newHead, CFIndex split, CFIndex oldGap,
+                 CFIndex newGap)
 {
-  struct __CFMutableArray *mArray = (struct __CFMutableArray *) array;
+  CFAllocatorRef alloc = CFGetAllocator (mArray);
+  const void **storage = mArray->_contents - mArray->_head;
+  const void **front = mArray->_contents;
+  const void **tail = front + split + oldGap;
+  CFIndex tailCount = mArray->_count - split - oldGap;
 
-  if (mArray->_capacity < newCapacity)
+  if (newCapacity == mArray->_capacity)
     {
-      /* Grow by at least DEFAULT_ARRAY_CAPACITY, but never to less than the
-         requested capacity (a single operation may need more than that). */
-      if (newCapacity < mArray->_capacity + DEFAULT_ARRAY_CAPACITY)
-        newCapacity = mArray->_capacity + DEFAULT_ARRAY_CAPACITY;
+      const void **newFront = storage + newHead;
+      const void **newTail = newFront + split + newGap;
 
-      mArray->_contents = CFAllocatorReallocate (CFGetAllocator (mArray),
-                                                 mArray->_contents,
-                                                 (newCapacity *
-                                                  sizeof (const void *)), 0);
-      mArray->_capacity = newCapacity;
+      /* The gap only grows, so the tail moves further right (or less far
+         left) than the front.  Move it first if it moves right. */
+      if (newTail > tail)
+        {
+          memmove (newTail, tail, tailCount * sizeof (void *));
+          memmove (newFront, front, split * sizeof (void *));
+        }
+      else
+        {
+          memmove (newFront, front, split * sizeof (void *));
+          memmove (newTail, tail, tailCount * sizeof (void *));
+        }
+    }
+  else if (mArray->_head == 0 && newHead == 0)
+    {
+      storage = CFAllocatorReallocate (alloc, storage,
+                                       newCapacity * sizeof (void *), 0);
+      memmove (storage + split + newGap, storage + split + oldGap,
+               tailCount * sizeof (void *));
+    }
+  else
+    {
+      const void **newStorage;
+
+      newStorage = CFAllocatorAllocate (alloc, newCapacity * sizeof (void *),
+                                        0);
+      memcpy (newStorage + newHead, front, split * sizeof (void *));
+      memcpy (newStorage + newHead + split + newGap, tail,
+              tailCount * sizeof (void *));
+      CFAllocatorDeallocate (alloc, storage);
+      storage = newStorage;
+    }
+
+  mArray->_contents = storage + newHead;
+  mArray->_head = newHead;
+  mArray->_capacity = newCapacity;
+}
+
+/* Makes room for newLength values in place of the length values at
+   location.  The values in the new range are left uninitialized, and
+   _count is not updated. */
+static void
+CFArrayResizeRange (struct __CFMutableArray *mArray, CFIndex location,
+                    CFIndex length, CFIndex newLength)
+{
+  const void **contents = mArray->_contents;
+  CFIndex before = location;
+  CFIndex after = mArray->_count - location - length;
+  CFIndex delta = newLength - length;
+  CFIndex back = mArray->_capacity - mArray->_head - mArray->_count;
+
+  if (delta == 0)
+    return;
+
+  if (before < after && (delta < 0 || mArray->_head >= delta))
+    {
+      memmove (contents - delta, contents, before * sizeof (void *));
+      mArray->_contents -= delta;
+      mArray->_head -= delta;
+    }
+  else if (before >= after && (delta < 0 || back >= delta))
+    {
+      memmove (contents + location + newLength,
+               contents + location + length, after * sizeof (void *));
+    }
+  else
+    {
+      CFIndex count = mArray->_count + delta;
+      CFIndex capacity = mArray->_capacity;
+      CFIndex free;
+      CFIndex newHead;
+
+      /* Grow by half the current count so that the next relocation is at
+         least as far away as this one is expensive.  Most of the free
+         space goes to the side that ran out. */
+      if (capacity < count + count / 2)
+        capacity = count + count / 2;
+      free = capacity - count;
+      if (before < after)
+        newHead = free - (back < free / 2 ? back : free / 2);
+      else
+        newHead = mArray->_head < free / 2 ? mArray->_head : free / 2;
+
+      CFArrayRelocate (mArray, capacity, newHead, location, length,
+                       newLength);
     }
 }
 
@@ -627,6 +849,37 @@ CFArrayRemoveValueAtIndex (CFMutableArrayRef array, CFIndex idx)
   CFArrayReplaceValues (array, CFRangeMake (idx, 1), NULL, 0);
 }
 
+void
+CFArrayReserveCapacity (CFMutableArrayRef array, CFIndex capacity)
+{
+  struct __CFMutableArray *mArray;
+
+  if (CF_IS_OBJC (_kCFArrayTypeID, array))
+    return;
+
+  mArray = (struct __CFMutableArray *) array;
+  if (mArray->_capacity - mArray->_head < capacity)
+    CFArrayRelocate (mArray, capacity > mArray->_capacity ?
+                     capacity : mArray->_capacity, 0, mArray->_count, 0, 0);
+}
+
+void
+CFArrayShrinkToFit (CFMutableArrayRef array)
+{
+  struct __CFMutableArray *mArray;
+  CFIndex capacity;
+
+  if (CF_IS_OBJC (_kCFArrayTypeID, array))
+    return;
+
+  capacity = array->_count;
+  if (capacity < DEFAULT_ARRAY_CAPACITY)
+    capacity = DEFAULT_ARRAY_CAPACITY;
+  mArray = (struct __CFMutableArray *) array;
+  if (mArray->_capacity > capacity)
+    CFArrayRelocate (mArray, capacity, 0, mArray->_count, 0, 0);
+}
+
 void
 CFArrayReplaceValues (CFMutableArrayRef array, CFRange range,
                       const void **newValues, CFIndex newCount)
@@ -667,17 +920,13 @@ CFArrayReplaceValues (CFMutableArrayRef array, CFRange range,
         }
     }
 
-  /* Move the values after the replaced range into their new position. */
+  /* Move the values around the replaced range into their new position. */
   if (range.length != newCount)
     {
-      CFIndex tail = oldCount - (range.location + range.length);
-
-      CFArrayCheckCapacityAndGrow (array, oldCount - range.length + newCount);
-      /* The grow above may have reallocated _contents, so recompute. */
+      CFArrayResizeRange ((struct __CFMutableArray *) array, range.location,
+                          range.length, newCount);
+      /* The values may have moved, so recompute. */
       start = array->_contents + range.location;
-
-      memmove (start + newCount, start + range.length,
-               tail * sizeof (void *));
     }
 
   /* Insert new values */
@@ -710,6 +959,27 @@ CFArraySetValueAtIndex (CFMutableArrayRef array, CFIndex idx, const void *value)
   CFArrayReplaceValues (array, CFRangeMake (idx, 1), &value, 1);
 }
 
+void
+CFArraySelectValue (CFMutableArrayRef array, CFRange range, CFIndex idx,
+                    CFComparatorFunction comparator, void *context)
+{
+  if (CF_IS_OBJC (_kCFArrayTypeID, array))
+    {
+      const void **values;
+
+      values = CFAllocatorAllocate (NULL, range.length * sizeof (void *), 0);
+      CFArrayGetValues (array, range, values);
+      GSCArraySelect (values, range.length, idx - range.location, comparator,
+                      context);
+      CFArrayReplaceValues (array, range, values, range.length);
+      CFAllocatorDeallocate (NULL, values);
+      return;
+    }
+
+  GSCArraySelect (array->_contents + range.location, range.length,
+                  idx - range.location, comparator, context);
+}
+
 void
 CFArraySortValues (CFMutableArrayRef array, CFRange range,
                    CFComparatorFunction comparator, void *context)
@@ -720,3 +990,132 @@ CFArraySortValues (CFMutableArrayRef array, CFRange range,
   GSCArrayQuickSort (array->_contents + range.location, range.length,
                      comparator, context);
 }
+
+void
+CFArraySortValuesConcurrently (CFMutableArrayRef array, CFRange range,
+                               CFComparatorFunction comparator,
+                               void *context)
+{
+  CF_OBJC_FUNCDISPATCHV (_kCFArrayTypeID, void, array,
+                         "sortUsingFunction:context:", comparator, context);
+
+  if (range.length < _kCFArrayConcurrentSortThreshold)
+    GSCArrayQuickSort (array->_contents + range.location, range.length,
+                       comparator, context);
+  else
+    GSCArrayParallelSort (array->_contents + range.location, range.length,
+                          comparator, context, CFGetAllocator (array));
+}
+
+void
+CFArraySortValuesStable (CFMutableArrayRef array, CFRange range,
+                         CFComparatorFunction comparator, void *context)
+{
+  if (CF_IS_OBJC (_kCFArrayTypeID, array))
+    {
+      const void **values;
+
+      /* Sort a copy of the values, as the ObjC sorting methods are not
+         guaranteed to be stable. */
+      values = CFAllocatorAllocate (NULL, range.length * sizeof (void *), 0);
+      CFArrayGetValues (array, range, values);
+      GSCArrayMergeSort (values, range.length, comparator, context, NULL);
+      CFArrayReplaceValues (array, range, values, range.length);
+      CFAllocatorDeallocate (NULL, values);
+      return;
+    }
+
+  GSCArrayMergeSort (array->_contents + range.location, range.length,
+                     comparator, context, CFGetAllocator (array));
+}
+
+struct GSCollationRecord
+{
+  const UInt8 *key;
+  CFIndex length;
+  const void *value;
+};
+
+static CFComparisonResult
+GSCollationRecordCompare (const void *v1, const void *v2, void *context)
+{
+  const struct GSCollationRecord *r1 = v1;
+  const struct GSCollationRecord *r2 = v2;
+  int res;
+
+  res = memcmp (r1->key, r2->key, GS_MIN (r1->length, r2->length));
+  if (res == 0)
+    res = r1->length < r2->length ? -1 : (r1->length > r2->length ? 1 : 0);
+
+  return res < 0 ? kCFCompareLessThan :
+    (res > 0 ? kCFCompareGreaterThan : kCFCompareEqualTo);
+}
+
+void
+CFArraySortValuesUsingCollation (CFMutableArrayRef array, CFRange range,
+                                 CFOptionFlags compareOptions,
+                                 CFLocaleRef locale)
+{
+  struct GSCollationRecord *records;
+  const void **sorted;
+  const void **values;
+  CFIndex *offsets;
+  UInt8 *keys;
+  CFIndex idx;
+  Boolean isObjC;
+
+  if (range.length < 2)
+    return;
+
+  isObjC = CF_IS_OBJC (_kCFArrayTypeID, array);
+  if (isObjC)
+    {
+      values = CFAllocatorAllocate (NULL, range.length * sizeof (void *), 0);
+      CFArrayGetValues (array, range, values);
+    }
+  else
+    {
+      values = array->_contents + range.location;
+    }
+
+  /* Compute every key once, then only compare bytes while sorting. */
+  offsets = CFAllocatorAllocate (NULL, (range.length + 1) * sizeof (CFIndex),
+                                 0);
+  keys = GSStringCreateCollationKeys (NULL, values, range.length,
+                                      compareOptions, locale, offsets);
+  if (keys == NULL)
+    {
+      /* Out of memory; leave the array as it is. */
+      CFAllocatorDeallocate (NULL, offsets);
+      if (isObjC)
+        CFAllocatorDeallocate (NULL, values);
+      return;
+    }
+  records = CFAllocatorAllocate (NULL,
+                                 range.length *
+                                 sizeof (struct GSCollationRecord), 0);
+  sorted = CFAllocatorAllocate (NULL, range.length * sizeof (void *), 0);
+  for (idx = 0; idx < range.length; ++idx)
+    {
+      records[idx].key = keys + offsets[idx];
+      records[idx].length = offsets[idx + 1] - offsets[idx];
+      records[idx].value = values[idx];
+      sorted[idx] = &records[idx];
+    }
+
+  GSCArrayQuickSort (sorted, range.length, GSCollationRecordCompare, NULL);
+
+  for (idx = 0; idx < range.length; ++idx)
+    values[idx] = ((const struct GSCollationRecord *) sorted[idx])->value;
+
+  if (isObjC)
+    {
+      CFArrayReplaceValues (array, range, values, range.length);
+      CFAllocatorDeallocate (NULL, values);
+    }
+
+  CFAllocatorDeallocate (NULL, sorted);
+  CFAllocatorDeallocate (NULL, records);
+  CFAllocatorDeallocate (NULL, keys);
+  CFAllocatorDeallocate (NULL, offsets);
+}
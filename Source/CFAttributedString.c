@@ -120,7 +120,7 @@ CFAttributedStringCacheAttribute (CFDictionaryRef attribs)
     {
       CFDictionaryRef insert;
 
-      insert = CFDictionaryCreateCopy (NULL, attribs);
+      insert = CFDictionaryCreateCopy (kCFAllocatorSystemDefault, attribs);
       CFBagAddValue (_kCFAttributedStringCache, insert);
       cachedAttr = insert;
       CFRelease (insert);
@@ -27,6 +27,7 @@
 #include "CoreFoundation/CFBase.h"
 #include "CoreFoundation/CFRuntime.h"
 #include "GSPrivate.h"
+#include "GSSlab.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -41,9 +42,39 @@ struct __CFAllocator
   CFAllocatorContext _context;
 };
 
-/* this will hold the default zone if set with CFAllocatorSetDefault () */
 static CFTypeID _kCFAllocatorTypeID = 0;
+/* The default for threads that have not set their own with
+   CFAllocatorSetDefault (). */
 static CFAllocatorRef _kCFDefaultAllocator = NULL;
+static GSThreadKey _kCFDefaultAllocatorKey;
+static Boolean _kCFDefaultAllocatorKeyValid = false;
+/* Set once any thread has its own default, so that until then looking up
+   the default costs no thread key access. */
+static Boolean _kCFDefaultAllocatorPerThread = false;
+
+static void
+CFAllocatorFinalize (CFTypeRef cf)
+{
+  struct __CFAllocator *allocator = (struct __CFAllocator*)cf;
+  
+  if (allocator->_context.release)
+    allocator->_context.release (allocator->_context.info);
+}
+
+CF_INLINE CFAllocatorRef
+GSAllocatorGetDefault (void)
+{
+  CFAllocatorRef allocator;
+  
+  if (_kCFDefaultAllocatorPerThread)
+    {
+      allocator = GSThreadKeyGetValue (_kCFDefaultAllocatorKey);
+      if (allocator != NULL)
+        return allocator;
+    }
+  
+  return GSAtomicLoadPointer (&_kCFDefaultAllocator);
+}
 
 static CFRuntimeClass CFAllocatorClass =
 {
@@ -51,7 +82,7 @@ static CFRuntimeClass CFAllocatorClass =
   "CFAllocator",
   NULL,
   NULL,
-  NULL,
+  CFAllocatorFinalize,
   NULL,
   NULL,
   NULL,
@@ -62,12 +93,17 @@ void CFAllocatorInitialize (void)
 {
   _kCFAllocatorTypeID = _CFRuntimeRegisterClass (&CFAllocatorClass);
   _kCFDefaultAllocator = kCFAllocatorSystemDefault;
+  if (GSThreadKeyCreate (&_kCFDefaultAllocatorKey,
+                         (void(*)(void*))CFRelease) == 0)
+    _kCFDefaultAllocatorKeyValid = true;
   
   /* These are already semi-initialized by INIT_CFRUNTIME_BASE() */
   GSRuntimeConstantInit (kCFAllocatorSystemDefault, _kCFAllocatorTypeID);
   GSRuntimeConstantInit (kCFAllocatorMalloc, _kCFAllocatorTypeID);
   GSRuntimeConstantInit (kCFAllocatorMallocZone, _kCFAllocatorTypeID);
   GSRuntimeConstantInit (kCFAllocatorNull, _kCFAllocatorTypeID);
+  GSRuntimeConstantInit (kCFAllocatorSlab, _kCFAllocatorTypeID);
+  GSSlabInitialize ();
 }
 
 static void *
@@ -112,6 +148,13 @@ static struct __CFAllocator _kCFAllocatorSystemDefault =
   { 0, NULL, NULL, NULL, NULL, malloc_alloc, malloc_realloc, malloc_dealloc, NULL }
 };
 
+static struct __CFAllocator _kCFAllocatorSlab =
+{
+  INIT_CFRUNTIME_BASE(),
+  { 0, NULL, NULL, NULL, NULL, GSSlabAllocate, GSSlabReallocate,
+    GSSlabDeallocate, GSSlabPreferredSize }
+};
+
 static struct __CFAllocator _kCFAllocatorNull =
 {
   INIT_CFRUNTIME_BASE(),
@@ -124,6 +167,7 @@ CFAllocatorRef kCFAllocatorSystemDefault = &_kCFAllocatorSystemDefault;
 CFAllocatorRef kCFAllocatorMalloc = &_kCFAllocatorSystemDefault;
 CFAllocatorRef kCFAllocatorMallocZone = &_kCFAllocatorSystemDefault;
 CFAllocatorRef kCFAllocatorNull = &_kCFAllocatorNull;
+CFAllocatorRef kCFAllocatorSlab = &_kCFAllocatorSlab;
 CFAllocatorRef kCFAllocatorUseContext = (CFAllocatorRef)0x01;
 
 
@@ -144,7 +188,11 @@ CFAllocatorCreate(CFAllocatorRef allocator, CFAllocatorContext *context)
         _kCFAllocatorTypeID,
         sizeof(struct __CFAllocator) - sizeof(CFRuntimeBase),
         0);
+      if (new == NULL)
+        return NULL;
       memcpy (&(new->_context), context, sizeof(CFAllocatorContext));
+      if (new->_context.retain)
+        new->_context.info = (void *)new->_context.retain (context->info);
     }
   
   return (CFAllocatorRef)new;
@@ -154,7 +202,7 @@ void *
 CFAllocatorAllocate(CFAllocatorRef allocator, CFIndex size, CFOptionFlags hint)
 {
   if (NULL == allocator)
-    allocator = _kCFDefaultAllocator;
+    allocator = GSAllocatorGetDefault ();
   
   return allocator->_context.allocate(size, hint, allocator->_context.info);
 }
@@ -163,7 +211,7 @@ void
 CFAllocatorDeallocate(CFAllocatorRef allocator, void *ptr)
 {
   if (NULL == allocator)
-    allocator = _kCFDefaultAllocator;
+    allocator = GSAllocatorGetDefault ();
   
   allocator->_context.deallocate(ptr, allocator->_context.info);
 }
@@ -173,7 +221,7 @@ CFAllocatorGetPreferredSizeForSize(CFAllocatorRef allocator, CFIndex size,
   CFOptionFlags hint)
 {
   if (allocator == NULL)
-    allocator = _kCFDefaultAllocator;
+    allocator = GSAllocatorGetDefault ();
   
   if (allocator->_context.preferredSize)
     return allocator->_context.preferredSize (size, hint,
@@ -186,7 +234,7 @@ void *
 CFAllocatorReallocate(CFAllocatorRef allocator, void *ptr, CFIndex newsize, CFOptionFlags hint)
 {
   if (NULL == allocator)
-    allocator = _kCFDefaultAllocator;
+    allocator = GSAllocatorGetDefault ();
   
   return allocator->_context.reallocate(ptr, newsize, hint,
     allocator->_context.info);
@@ -195,20 +243,44 @@ CFAllocatorReallocate(CFAllocatorRef allocator, void *ptr, CFIndex newsize, CFOp
 CFAllocatorRef
 CFAllocatorGetDefault(void)
 {
-  return _kCFDefaultAllocator;
+  return GSAllocatorGetDefault ();
 }
 
 void
 CFAllocatorSetDefault(CFAllocatorRef allocator)
 {
-  CFAllocatorRef current = _kCFDefaultAllocator;
+  CFAllocatorRef current;
+  
+  if (allocator == NULL)
+    return;
   
+  /* Without a thread key, fall back to changing the default for every
+     thread. */
+  if (!_kCFDefaultAllocatorKeyValid)
+    {
+      CFAllocatorSetProcessDefault (allocator);
+      return;
+    }
+  
+  current = GSThreadKeyGetValue (_kCFDefaultAllocatorKey);
+  if (current == allocator)
+    return;
+  _kCFDefaultAllocatorPerThread = true;
+  GSThreadKeySetValue (_kCFDefaultAllocatorKey, CFRetain (allocator));
+  if (current != NULL)
+    CFRelease (current);
+}
+
+void
+CFAllocatorSetProcessDefault(CFAllocatorRef allocator)
+{
   if (allocator == NULL)
     return;
   
+  /* Other threads may be using the current default without holding a
+     reference, so it is never released. */
   CFRetain (allocator);
-  _kCFDefaultAllocator = allocator;
-  CFRelease (current);
+  GSAtomicStorePointer (&_kCFDefaultAllocator, allocator);
 }
 
 void
@@ -225,6 +297,231 @@ CFAllocatorGetTypeID(void)
 
 
 
+/* An arena hands out memory from a list of blocks by bumping a pointer.
+   Each allocation is preceded by its size so that it can be reallocated;
+   nothing is freed until the arena is reset or deallocated. */
+typedef struct GSArenaBlock GSArenaBlock;
+struct GSArenaBlock
+{
+  GSArenaBlock *next;
+  CFIndex       size;
+};
+
+typedef struct GSArena GSArena;
+struct GSArena
+{
+  CFAllocatorRef allocator;     /* Allocates the blocks and this struct */
+  GSArenaBlock  *blocks;        /* Newest first */
+  char          *next;
+  char          *end;
+  char          *last;          /* Most recent allocation */
+  CFIndex        blockSize;
+  Boolean        dying;
+};
+
+#define GS_ARENA_ALIGN 16
+#define GS_ARENA_HEADER GS_ARENA_ALIGN
+#define GS_ARENA_MAX_BLOCK (1024 * 1024)
+#define GS_ARENA_ROUND(s) \
+  (((s) + GS_ARENA_ALIGN - 1) & ~(CFIndex)(GS_ARENA_ALIGN - 1))
+#define GS_ARENA_SIZE(p) (*(CFIndex *)((char *)(p) - sizeof(CFIndex)))
+
+static void *
+arena_alloc (CFIndex allocSize, CFOptionFlags hint, void *info)
+{
+  GSArena *arena = info;
+  GSArenaBlock *block;
+  CFIndex need;
+  CFIndex blockSize;
+  char *ptr;
+  
+  if (allocSize < 0)
+    return NULL;
+  need = GS_ARENA_HEADER + GS_ARENA_ROUND(allocSize);
+  if (need > arena->end - arena->next)
+    {
+      /* Blocks double in size up to a limit, so that small arenas stay
+         small and large ones need few blocks. */
+      blockSize = arena->blockSize;
+      if (blockSize < GS_ARENA_MAX_BLOCK)
+        arena->blockSize = blockSize * 2;
+      if (blockSize < need + GS_ARENA_ALIGN)
+        blockSize = need + GS_ARENA_ALIGN;
+      
+      block = CFAllocatorAllocate (arena->allocator, blockSize, 0);
+      if (block == NULL)
+        return NULL;
+      block->next = arena->blocks;
+      block->size = blockSize;
+      arena->blocks = block;
+      arena->next = (char *)block + GS_ARENA_ALIGN;
+      arena->end = (char *)block + blockSize;
+    }
+  
+  ptr = arena->next + GS_ARENA_HEADER;
+  arena->next += need;
+  arena->last = ptr;
+  GS_ARENA_SIZE(ptr) = allocSize;
+  
+  return ptr;
+}
+
+static void *
+arena_realloc (void *ptr, CFIndex newsize, CFOptionFlags hint, void *info)
+{
+  GSArena *arena = info;
+  CFIndex oldsize;
+  void *new;
+  
+  if (ptr == NULL)
+    return arena_alloc (newsize, hint, info);
+  if (newsize < 0)
+    return NULL;
+  
+  oldsize = GS_ARENA_SIZE(ptr);
+  /* The most recent allocation can grow in place. */
+  if (ptr == arena->last
+      && (char *)ptr + GS_ARENA_ROUND(newsize) <= arena->end)
+    {
+      arena->next = (char *)ptr + GS_ARENA_ROUND(newsize);
+      GS_ARENA_SIZE(ptr) = newsize;
+      return ptr;
+    }
+  if (newsize <= oldsize)
+    return ptr;
+  
+  new = arena_alloc (newsize, hint, info);
+  if (new)
+    memcpy (new, ptr, oldsize);
+  
+  return new;
+}
+
+static void
+arena_dealloc (void *ptr, void *info)
+{
+  /* Memory is only given back when the arena is reset or deallocated. */
+}
+
+static void
+GSArenaFreeBlocks (GSArena *arena, GSArenaBlock *block)
+{
+  GSArenaBlock *next;
+  
+  for ( ; block ; block = next)
+    {
+      next = block->next;
+      CFAllocatorDeallocate (arena->allocator, block);
+    }
+}
+
+static void
+arena_release (const void *info)
+{
+  GSArena *arena = (GSArena *)info;
+  CFAllocatorRef allocator = arena->allocator;
+  
+  GSArenaFreeBlocks (arena, arena->blocks);
+  CFAllocatorDeallocate (allocator, arena);
+  CFRelease (allocator);
+}
+
+CF_INLINE GSArena *
+GSAllocatorGetArena (CFAllocatorRef allocator)
+{
+  if (allocator == NULL || allocator->_context.allocate != arena_alloc)
+    return NULL;
+  return allocator->_context.info;
+}
+
+Boolean
+GSAllocatorIsDying (CFAllocatorRef allocator)
+{
+  GSArena *arena = GSAllocatorGetArena (allocator);
+  
+  return arena != NULL && arena->dying;
+}
+
+CFAllocatorRef
+CFAllocatorCreateArena (CFAllocatorRef allocator, CFIndex blockSize)
+{
+  CFAllocatorContext context;
+  CFAllocatorRef new;
+  GSArena *arena;
+  
+  if (allocator == NULL)
+    allocator = GSAllocatorGetDefault ();
+  if (blockSize <= 0)
+    blockSize = 4096;
+  
+  arena = CFAllocatorAllocate (allocator, sizeof(GSArena), 0);
+  if (arena == NULL)
+    return NULL;
+  memset (arena, 0, sizeof(GSArena));
+  arena->allocator = CFRetain (allocator);
+  arena->blockSize = blockSize;
+  
+  memset (&context, 0, sizeof(CFAllocatorContext));
+  context.info = arena;
+  context.release = arena_release;
+  context.allocate = arena_alloc;
+  context.reallocate = arena_realloc;
+  context.deallocate = arena_dealloc;
+  new = CFAllocatorCreate (allocator, &context);
+  if (new == NULL)
+    arena_release (arena);
+  
+  return new;
+}
+
+void
+CFAllocatorArenaReset (CFAllocatorRef allocator)
+{
+  GSArena *arena = GSAllocatorGetArena (allocator);
+  GSArenaBlock *largest;
+  GSArenaBlock *block;
+  GSArenaBlock *next;
+  
+  if (arena == NULL)
+    return;
+  
+  /* Keep the largest block for reuse.  It is not always the newest: an
+     oversized request can be followed by a smaller standard block. */
+  largest = arena->blocks;
+  for (block = arena->blocks ; block ; block = block->next)
+    {
+      if (block->size > largest->size)
+        largest = block;
+    }
+  if (largest)
+    {
+      for (block = arena->blocks ; block ; block = next)
+        {
+          next = block->next;
+          if (block != largest)
+            CFAllocatorDeallocate (arena->allocator, block);
+        }
+      largest->next = NULL;
+      arena->blocks = largest;
+      arena->next = (char *)largest + GS_ARENA_ALIGN;
+      arena->end = (char *)largest + largest->size;
+    }
+  arena->last = NULL;
+  arena->dying = false;
+}
+
+void
+CFAllocatorArenaRelease (CFAllocatorRef allocator)
+{
+  GSArena *arena = GSAllocatorGetArena (allocator);
+  
+  if (arena != NULL)
+    arena->dying = true;
+  CFRelease (allocator);
+}
+
+
+
 static CFTypeID _kCFNullTypeID;
 
 static const CFRuntimeClass CFNullClass =
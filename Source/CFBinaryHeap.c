@@ -41,6 +41,16 @@ static const CFBinaryHeapCallBacks _kCFNullBinaryHeapCallBacks =
   NULL
 };
 
+/* Each node has 1 << _shift children: the children of _values[idx] are
+ * _values[(idx << _shift) + 1] onwards.  Four children per node halve the
+ * depth of the heap, and all four share a cache line.
+ *
+ * Handles are only tracked once CFBinaryHeapAddValueAndGetHandle() has
+ * been called.  _handles is then a permutation of 0 ... _capacity - 1: the
+ * first _count entries are the handles of the values in the same
+ * positions, the others are the handles not in use.  _positions is its
+ * inverse, so a handle is in use if its position is less than _count.
+ */
 struct __CFBinaryHeap
 {
   CFRuntimeBase _parent;
@@ -49,6 +59,9 @@ struct __CFBinaryHeap
   CFIndex _count;
   CFIndex _capacity;
   const void **_values;
+  CFIndex _shift;
+  CFIndex *_handles;
+  CFIndex *_positions;
 };
 
 static void
@@ -65,9 +78,14 @@ CFBinaryHeapFinalize (CFTypeRef cf)
       const void **cur = heap->_values;
       const void **end = cur + heap->_count;
       while (cur < end)
-        heap->_callBacks->release (allocator, cur++);
+        heap->_callBacks->release (allocator, *cur++);
     }
   CFAllocatorDeallocate (allocator, (void*)heap->_values);
+  if (heap->_handles)
+    {
+      CFAllocatorDeallocate (allocator, heap->_handles);
+      CFAllocatorDeallocate (allocator, heap->_positions);
+    }
 }
 
 static Boolean
@@ -151,12 +169,13 @@ CFBinaryHeapApplyFunction (CFBinaryHeapRef heap,
     applier(heap->_values[i], context);
 }
 
+
 #define CFBINARYHEAP_SIZE sizeof(struct __CFBinaryHeap) - sizeof(CFRuntimeBase)
 #define DEFAULT_HEAP_CAPACITY 15 /* Equivalent to 3 levels */
 
 CFBinaryHeapRef
-CFBinaryHeapCreate (CFAllocatorRef alloc, CFIndex capacity,
-  const CFBinaryHeapCallBacks *callBacks,
+CFBinaryHeapCreateWithArity (CFAllocatorRef alloc, CFIndex capacity,
+  CFIndex arity, const CFBinaryHeapCallBacks *callBacks,
   const CFBinaryHeapCompareContext *compareContext)
 {
   CFBinaryHeapRef new;
@@ -182,6 +201,13 @@ CFBinaryHeapCreate (CFAllocatorRef alloc, CFIndex capacity,
       memset (new->_values, 0, sizeof(void*) * capacity);
       new->_capacity = capacity;
       
+      if (arity <= 2)
+        new->_shift = 1;
+      else if (arity <= 4)
+        new->_shift = 2;
+      else
+        new->_shift = 3;
+      
       if (callBacks == NULL)
         callBacks = &_kCFNullBinaryHeapCallBacks;
       new->_callBacks = callBacks;
@@ -201,119 +227,358 @@ CFBinaryHeapCreate (CFAllocatorRef alloc, CFIndex capacity,
   return new;
 }
 
+CFBinaryHeapRef
+CFBinaryHeapCreate (CFAllocatorRef alloc, CFIndex capacity,
+  const CFBinaryHeapCallBacks *callBacks,
+  const CFBinaryHeapCompareContext *compareContext)
+{
+  return CFBinaryHeapCreateWithArity (alloc, capacity, 2, callBacks,
+    compareContext);
+}
+
 CFBinaryHeapRef
 CFBinaryHeapCreateCopy (CFAllocatorRef alloc, CFIndex capacity,
   CFBinaryHeapRef heap)
 {
   CFBinaryHeapRef ret;
+  CFBinaryHeapRetainCallBack retain;
 
   /* The copy must be able to hold every value regardless of the requested
      capacity. */
   if (capacity < heap->_count)
     capacity = heap->_count;
-  ret = CFBinaryHeapCreate (alloc, capacity, heap->_callBacks,
-    &heap->_context);
+  ret = CFBinaryHeapCreateWithArity (alloc, capacity, 1 << heap->_shift,
+    heap->_callBacks, &heap->_context);
   memcpy (ret->_values, heap->_values, sizeof(void*) * heap->_count);
   ret->_count = heap->_count;
   
+  retain = heap->_callBacks->retain;
+  if (retain)
+    {
+      CFIndex idx;
+      
+      for (idx = 0 ; idx < ret->_count ; ++idx)
+        retain (alloc, ret->_values[idx]);
+    }
+  
   return ret;
 }
 
+CF_INLINE Boolean
+CFBinaryHeapLess (CFBinaryHeapRef heap, const void *v1, const void *v2)
+{
+  CFBinaryHeapCompareCallBack compare = heap->_callBacks->compare;
+  
+  return compare ? compare (v1, v2, heap->_context.info) == kCFCompareLessThan
+    : v1 < v2;
+}
+
+/* Puts value, whose handle is handle, at position idx. */
+CF_INLINE void
+CFBinaryHeapStore (CFBinaryHeapRef heap, CFIndex idx, const void *value,
+  CFIndex handle)
+{
+  heap->_values[idx] = value;
+  if (heap->_handles)
+    {
+      heap->_handles[idx] = handle;
+      heap->_positions[handle] = idx;
+    }
+}
+
+CF_INLINE void
+CFBinaryHeapMove (CFBinaryHeapRef heap, CFIndex to, CFIndex from)
+{
+  CFBinaryHeapStore (heap, to, heap->_values[from],
+    heap->_handles ? heap->_handles[from] : -1);
+}
+
+/* Moves the parents of the free position idx down until value can be
+   stored there. */
+static void
+CFBinaryHeapSiftUp (CFBinaryHeapRef heap, CFIndex idx, const void *value,
+  CFIndex handle)
+{
+  while (idx > 0)
+    {
+      CFIndex parent = (idx - 1) >> heap->_shift;
+      
+      if (!CFBinaryHeapLess (heap, value, heap->_values[parent]))
+        break;
+      CFBinaryHeapMove (heap, idx, parent);
+      idx = parent;
+    }
+  CFBinaryHeapStore (heap, idx, value, handle);
+}
+
+/* Moves the least children of the free position idx up until value can be
+   stored there. */
+static void
+CFBinaryHeapSiftDown (CFBinaryHeapRef heap, CFIndex idx, const void *value,
+  CFIndex handle)
+{
+  CFIndex count = heap->_count;
+  CFIndex arity = (CFIndex)1 << heap->_shift;
+  
+  while (true)
+    {
+      CFIndex child = (idx << heap->_shift) + 1;
+      CFIndex end = child + arity;
+      CFIndex least;
+      
+      if (child >= count)
+        break;
+      if (end > count)
+        end = count;
+      for (least = child++ ; child < end ; ++child)
+        if (CFBinaryHeapLess (heap, heap->_values[child],
+            heap->_values[least]))
+          least = child;
+      if (!CFBinaryHeapLess (heap, heap->_values[least], value))
+        break;
+      CFBinaryHeapMove (heap, idx, least);
+      idx = least;
+    }
+  CFBinaryHeapStore (heap, idx, value, handle);
+}
+
+/* Stores value, which replaces the value at idx, where it belongs. */
+static void
+CFBinaryHeapRestore (CFBinaryHeapRef heap, CFIndex idx, const void *value,
+  CFIndex handle)
+{
+  if (idx > 0 && CFBinaryHeapLess (heap, value,
+      heap->_values[(idx - 1) >> heap->_shift]))
+    CFBinaryHeapSiftUp (heap, idx, value, handle);
+  else
+    CFBinaryHeapSiftDown (heap, idx, value, handle);
+}
+
+static void
+CFBinaryHeapRemoveValueAtIndex (CFBinaryHeapRef heap, CFIndex idx)
+{
+  CFBinaryHeapReleaseCallBack release;
+  CFIndex handle;
+  CFIndex last;
+  
+  release = heap->_callBacks->release;
+  if (release)
+    release (CFGetAllocator(heap), heap->_values[idx]);
+  
+  handle = heap->_handles ? heap->_handles[idx] : -1;
+  heap->_count -= 1;
+  last = heap->_count;
+  if (idx < last)
+    CFBinaryHeapRestore (heap, idx, heap->_values[last],
+      heap->_handles ? heap->_handles[last] : -1);
+  
+  /* The handle is no longer in use. */
+  if (heap->_handles)
+    {
+      heap->_handles[last] = handle;
+      heap->_positions[handle] = last;
+    }
+}
+
+static void
+CFBinaryHeapTrackHandles (CFBinaryHeapRef heap)
+{
+  CFAllocatorRef alloc = CFGetAllocator(heap);
+  CFIndex idx;
+  
+  heap->_handles = CFAllocatorAllocate (alloc,
+    heap->_capacity * sizeof(CFIndex), 0);
+  heap->_positions = CFAllocatorAllocate (alloc,
+    heap->_capacity * sizeof(CFIndex), 0);
+  for (idx = 0 ; idx < heap->_capacity ; ++idx)
+    {
+      heap->_handles[idx] = idx;
+      heap->_positions[idx] = idx;
+    }
+}
+
 CF_INLINE void
 CFBinaryHeapCheckCapacityAndGrow (CFBinaryHeapRef heap)
 {
   if (heap->_count == heap->_capacity)
     {
+      CFAllocatorRef alloc = CFGetAllocator(heap);
       CFIndex newCapacity = (heap->_capacity << 1) + 1;
       
-      heap->_values = CFAllocatorReallocate (CFGetAllocator(heap),
+      heap->_values = CFAllocatorReallocate (alloc,
         heap->_values, (newCapacity * sizeof(const void *)), 0);
+      if (heap->_handles)
+        {
+          CFIndex idx;
+          
+          heap->_handles = CFAllocatorReallocate (alloc, heap->_handles,
+            newCapacity * sizeof(CFIndex), 0);
+          heap->_positions = CFAllocatorReallocate (alloc, heap->_positions,
+            newCapacity * sizeof(CFIndex), 0);
+          for (idx = heap->_capacity ; idx < newCapacity ; ++idx)
+            {
+              heap->_handles[idx] = idx;
+              heap->_positions[idx] = idx;
+            }
+        }
       heap->_capacity = newCapacity;
     }
 }
 
+CFIndex
+CFBinaryHeapAddValueAndGetHandle (CFBinaryHeapRef heap, const void *value)
+{
+  CFBinaryHeapRetainCallBack retain;
+  CFIndex handle;
+  
+  if (heap->_handles == NULL)
+    CFBinaryHeapTrackHandles (heap);
+  CFBinaryHeapCheckCapacityAndGrow (heap);
+  
+  retain = heap->_callBacks->retain;
+  if (retain)
+    value = retain (CFGetAllocator(heap), value);
+  
+  /* The first handle not in use is the one after the last value. */
+  handle = heap->_handles[heap->_count];
+  heap->_count += 1;
+  CFBinaryHeapSiftUp (heap, heap->_count - 1, value, handle);
+  
+  return handle;
+}
+
 void
 CFBinaryHeapAddValue (CFBinaryHeapRef heap, const void *value)
 {
-  CFIndex cur;
-  void *info;
-  CFBinaryHeapCompareCallBack compare;
   CFBinaryHeapRetainCallBack retain;
+  CFIndex handle;
   
   CFBinaryHeapCheckCapacityAndGrow (heap);
   
-  compare = heap->_callBacks->compare;
-  info = heap->_context.info;
-  cur = heap->_count;
-  while (cur > 0)
-    {
-      /* Shift down */
-      CFIndex parent;
-      const void *p;
-      
-      parent = (cur - 1) >> 1;
-      p = heap->_values[parent];
-      if (compare ? compare(p, value, info) != kCFCompareGreaterThan
-          : p <= value)
-        break;
-      
-      heap->_values[cur] = heap->_values[parent];
-      cur = parent;
-    }
-  
   retain = heap->_callBacks->retain;
-  heap->_values[cur] = retain ? retain(CFGetAllocator(heap), value) : value;
+  if (retain)
+    value = retain (CFGetAllocator(heap), value);
+  
+  handle = heap->_handles ? heap->_handles[heap->_count] : -1;
   heap->_count += 1;
+  CFBinaryHeapSiftUp (heap, heap->_count - 1, value, handle);
 }
 
-Boolean
-CFBinaryHeapContainsValue (CFBinaryHeapRef heap, const void *value)
+CF_INLINE Boolean
+CFBinaryHeapHandleIsValid (CFBinaryHeapRef heap, CFIndex handle)
 {
+  return heap->_handles && handle >= 0 && handle < heap->_capacity
+    && heap->_positions[handle] < heap->_count;
+}
+
+const void *
+CFBinaryHeapGetValueForHandle (CFBinaryHeapRef heap, CFIndex handle)
+{
+  if (!CFBinaryHeapHandleIsValid (heap, handle))
+    return NULL;
+  
+  return heap->_values[heap->_positions[handle]];
+}
+
+void
+CFBinaryHeapRemoveValueForHandle (CFBinaryHeapRef heap, CFIndex handle)
+{
+  if (!CFBinaryHeapHandleIsValid (heap, handle))
+    return;
+  
+  CFBinaryHeapRemoveValueAtIndex (heap, heap->_positions[handle]);
+}
+
+void
+CFBinaryHeapReplaceValueForHandle (CFBinaryHeapRef heap, CFIndex handle,
+  const void *value)
+{
+  CFBinaryHeapRetainCallBack retain;
+  CFBinaryHeapReleaseCallBack release;
   CFIndex idx;
-  CFIndex count;
-  CFBinaryHeapCompareCallBack compare;
-  void *info;
   
-  idx = 0;
-  count = heap->_count;
-  compare = heap->_callBacks->compare;
-  info = heap->_context.info;
-  while (idx < count)
-    {
-      const void *v;
-      
-      v = heap->_values[idx++];
-      if (compare ? compare(v, value, info) == kCFCompareEqualTo : v == value)
-        return true;
-    }
+  if (!CFBinaryHeapHandleIsValid (heap, handle))
+    return;
+  
+  idx = heap->_positions[handle];
+  retain = heap->_callBacks->retain;
+  if (retain)
+    value = retain (CFGetAllocator(heap), value);
+  release = heap->_callBacks->release;
+  if (release)
+    release (CFGetAllocator(heap), heap->_values[idx]);
   
-  return false;
+  CFBinaryHeapRestore (heap, idx, value, handle);
 }
 
-CFIndex
-CFBinaryHeapGetCountOfValue (CFBinaryHeapRef heap, const void *value)
+/* Counts the values equal to value, stopping at the first one if first is
+ * true.  No value in the subtree of a value greater than value can match,
+ * so those subtrees are skipped.  The walk goes down to the first child of
+ * a value that is not greater, and otherwise on to the next sibling,
+ * climbing back up after the last one.
+ */
+static CFIndex
+CFBinaryHeapFindValue (CFBinaryHeapRef heap, const void *value, Boolean first)
 {
+  CFBinaryHeapCompareCallBack compare;
   CFIndex idx;
   CFIndex count;
   CFIndex counter;
-  CFBinaryHeapCompareCallBack compare;
+  CFIndex lastChild;
   void *info;
   
-  idx = 0;
   count = heap->_count;
-  counter = 0;
+  if (count == 0)
+    return 0;
+  
   compare = heap->_callBacks->compare;
   info = heap->_context.info;
-  while (idx < count)
+  lastChild = ((CFIndex)1 << heap->_shift) - 1;
+  counter = 0;
+  idx = 0;
+  while (true)
     {
-      const void *v;
+      const void *v = heap->_values[idx];
+      
+      if (!CFBinaryHeapLess (heap, value, v))
+        {
+          CFIndex child;
+          
+          if (compare ? compare(v, value, info) == kCFCompareEqualTo
+              : v == value)
+            {
+              counter++;
+              if (first)
+                return counter;
+            }
+          child = (idx << heap->_shift) + 1;
+          if (child < count)
+            {
+              idx = child;
+              continue;
+            }
+        }
       
-      v = heap->_values[idx++];
-      if (compare ? compare(v, value, info) == kCFCompareEqualTo : v == value)
-        counter++;
+      /* Children are numbered from 1, so the last one is a multiple of
+         the number of children. */
+      while (idx > 0 && ((idx & lastChild) == 0 || idx + 1 >= count))
+        idx = (idx - 1) >> heap->_shift;
+      if (idx == 0)
+        return counter;
+      idx += 1;
     }
-  
-  return counter;
+}
+
+Boolean
+CFBinaryHeapContainsValue (CFBinaryHeapRef heap, const void *value)
+{
+  return CFBinaryHeapFindValue (heap, value, true) > 0;
+}
+
+CFIndex
+CFBinaryHeapGetCountOfValue (CFBinaryHeapRef heap, const void *value)
+{
+  return CFBinaryHeapFindValue (heap, value, false);
 }
 
 const void *
@@ -356,7 +621,7 @@ CFBinaryHeapRemoveAllValues (CFBinaryHeapRef heap)
       const void **cur = heap->_values;
       const void **end = cur + heap->_count;
       while (cur < end)
-        heap->_callBacks->release (allocator, cur++);
+        heap->_callBacks->release (allocator, *cur++);
     }
   
   heap->_count = 0;
@@ -365,52 +630,8 @@ CFBinaryHeapRemoveAllValues (CFBinaryHeapRef heap)
 void
 CFBinaryHeapRemoveMinimumValue (CFBinaryHeapRef heap)
 {
-  CFIndex idx;
-  CFIndex child;
-  CFIndex count;
-  CFBinaryHeapReleaseCallBack release;
-  CFBinaryHeapCompareCallBack compare;
-  const void *last;
-  void *info;
-  
   if (heap->_count == 0)
     return;
 
-  release = heap->_callBacks->release;
-  if (release)
-    release (CFGetAllocator(heap), heap->_values[0]);
-  count = heap->_count;
-  heap->_count -= 1;
-  
-  compare = heap->_callBacks->compare;
-  info = heap->_context.info;
-  
-  idx = 0;
-  child = 1; /* Initialize to left child */
-  last = heap->_values[count - 1];
-  while (child < count)
-    {
-      const void *v;
-      
-      v = heap->_values[child];
-      if (child + 1 < count) /* Check for a right child */
-        {
-          const void *right;
-          
-          right = heap->_values[child + 1];
-          if (compare ? compare(v, right, info) == kCFCompareGreaterThan
-              : v > right)
-            {
-              v = right;
-              child += 1;
-            }
-        }
-      
-      heap->_values[idx] = v;
-      idx = child;
-      child = (idx << 1) + 1; /* Go to left child */
-    }
-  
-  heap->_values[idx] = last;
+  CFBinaryHeapRemoveValueAtIndex (heap, 0);
 }
-
@@ -27,6 +27,7 @@
 #include "CoreFoundation/CFRuntime.h"
 #include "CoreFoundation/CFBase.h"
 #include "CoreFoundation/CFBitVector.h"
+#include "GSBitmap.h"
 
 #include <string.h>
 
@@ -38,11 +39,13 @@ struct __CFBitVector
   CFIndex       _count;
   CFIndex       _byteCount;
   UInt8        *_bytes;
+  GSBitmap      _bitmap; /* Used instead of _bytes when compressed */
 };
 
 enum
 {
-  _kCFBitVectorIsMutable = (1<<0)
+  _kCFBitVectorIsMutable = (1<<0),
+  _kCFBitVectorIsCompressed = (1<<1)
 };
 
 CF_INLINE Boolean
@@ -58,6 +61,19 @@ CFBitVectorSetMutable (CFBitVectorRef bv)
   ((CFRuntimeBase *)bv)->_flags.info |= _kCFBitVectorIsMutable;
 }
 
+CF_INLINE Boolean
+CFBitVectorIsCompressed (CFBitVectorRef bv)
+{
+  return ((CFRuntimeBase *)bv)->_flags.info & _kCFBitVectorIsCompressed ?
+    true : false;
+}
+
+CF_INLINE GSBitmap *
+CFBitVectorGetBitmap (CFBitVectorRef bv)
+{
+  return (GSBitmap *)&bv->_bitmap;
+}
+
 CF_INLINE CFIndex
 CFBitVectorGetByteCount (CFIndex numBits)
 {
@@ -68,7 +84,9 @@ static void
 CFBitVectorFinalize (CFTypeRef cf)
 {
   CFBitVectorRef bv = (CFBitVectorRef)cf;
-  if (CFBitVectorIsMutable(bv))
+  if (CFBitVectorIsCompressed(bv))
+    GSBitmapFree (CFGetAllocator(cf), CFBitVectorGetBitmap(bv));
+  else if (CFBitVectorIsMutable(bv))
     CFAllocatorDeallocate (CFGetAllocator(cf), bv->_bytes);
 }
 
@@ -77,13 +95,31 @@ CFBitVectorEqual (CFTypeRef cf1, CFTypeRef cf2)
 {
   CFBitVectorRef bv1 = (CFBitVectorRef)cf1;
   CFBitVectorRef bv2 = (CFBitVectorRef)cf2;
+  CFIndex idx;
+  CFIndex end;
   
-  if (bv1->_count == bv2->_count)
+  if (bv1->_count != bv2->_count)
+    return false;
+  if (!CFBitVectorIsCompressed(bv1) && !CFBitVectorIsCompressed(bv2))
+    return memcmp (bv1->_bytes, bv2->_bytes,
+      CFBitVectorGetByteCount(bv1->_count)) == 0 ? true : false;
+  if (CFBitVectorIsCompressed(bv1) && CFBitVectorIsCompressed(bv2))
+    return GSBitmapEqual (CFBitVectorGetBitmap(bv1),
+      CFBitVectorGetBitmap(bv2));
+  
+  /* Walk the bits set in either. */
+  end = bv1->_count;
+  for (idx = 0 ; idx < end ; ++idx)
     {
-      return memcmp (bv1->_bytes, bv2->_bytes,
-        CFBitVectorGetByteCount(bv1->_count)) == 0 ? true : false;
+      CFRange range = CFRangeMake (idx, end - idx);
+      
+      idx = CFBitVectorGetFirstIndexOfBit (bv1, range, 1);
+      if (idx != CFBitVectorGetFirstIndexOfBit (bv2, range, 1))
+        return false;
+      if (idx == kCFNotFound)
+        break;
     }
-  return false;
+  return true;
 }
 
 static CFHashCode
@@ -131,9 +167,42 @@ CFBitVectorBitMask (UInt8 mostSig, UInt8 leastSig)
   return ((UInt8)(0xFF << (7 - leastSig + mostSig)) >> mostSig);
 }
 
+/* The loops over whole words are also compiled for processors with AVX2
+   and with the POPCNT instruction, and the best version is picked when the
+   library is loaded. */
+#if defined(__GNUC__) && defined(__x86_64__) && defined(__ELF__) \
+  && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define CFBITVECTOR_KERNEL \
+  __attribute__((target_clones("arch=x86-64-v3", "popcnt", "default")))
+#endif
+#endif
+#ifndef CFBITVECTOR_KERNEL
+#define CFBITVECTOR_KERNEL
+#endif
+
+CF_INLINE UInt64
+CFBitVectorLoadWord (const UInt8 *bytes)
+{
+  UInt64 word;
+  
+  memcpy (&word, bytes, sizeof(word));
+  return word;
+}
+
+CF_INLINE void
+CFBitVectorStoreWord (UInt8 *bytes, UInt64 word)
+{
+  memcpy (bytes, &word, sizeof(word));
+}
+
+/* Applies func to each byte touched by range, with a mask of the bits in
+   range.  If bulk is not NULL it is called instead for the bytes that are
+   entirely in range, so that they can be processed a word at a time. */
 static void
 CFBitVectorOperation (CFBitVectorRef bv, CFRange range,
-  UInt8 (*func)(UInt8, UInt8, void*), void *context)
+  UInt8 (*func)(UInt8, UInt8, void*), void (*bulk)(UInt8*, CFIndex, void*),
+  void *context)
 {
   CFIndex curByte;
   CFIndex endByte;
@@ -165,6 +234,11 @@ CFBitVectorOperation (CFBitVectorRef bv, CFRange range,
   ++curByte;
 
   /* Middle bytes */
+  if (bulk && curByte < endByte)
+    {
+      bulk (bv->_bytes + curByte, endByte - curByte, context);
+      curByte = endByte;
+    }
   while (curByte < endByte)
     {
       bv->_bytes[curByte] = func (bv->_bytes[curByte], 0xFF, context);
@@ -209,11 +283,31 @@ CFBitVectorCreate (CFAllocatorRef alloc, const UInt8 *bytes,
   return new;
 }
 
+static CFMutableBitVectorRef
+CFBitVectorCreateCompressedCopy (CFAllocatorRef alloc, CFBitVectorRef bv)
+{
+  struct __CFBitVector *new;
+  
+  new = (struct __CFBitVector*)_CFRuntimeCreateInstance (alloc,
+    _kCFBitVectorTypeID, CFBITVECTOR_SIZE, 0);
+  if (new)
+    {
+      ((CFRuntimeBase *)new)->_flags.info |= _kCFBitVectorIsCompressed;
+      new->_count = bv->_count;
+      GSBitmapCopy (alloc, &new->_bitmap, &bv->_bitmap);
+    }
+  
+  return new;
+}
+
 CFBitVectorRef
 CFBitVectorCreateCopy (CFAllocatorRef alloc, CFBitVectorRef bv)
 {
+  if (CFBitVectorIsCompressed(bv))
+    return CFBitVectorCreateCompressedCopy (alloc, bv);
   return CFBitVectorCreate (alloc, bv->_bytes, bv->_count);
 }
+
 Boolean
 CFBitVectorContainsBit (CFBitVectorRef bv, CFRange range, CFBit value)
 {
@@ -225,6 +319,8 @@ CFBitVectorGetBitAtIndex (CFBitVectorRef bv, CFIndex idx)
 {
   CFIndex byteIdx = CFBitVectorGetByte (idx);
   CFIndex bitIdx = CFBitVectorGetBitIndex (idx);
+  if (CFBitVectorIsCompressed(bv))
+    return GSBitmapContainsIndex (CFBitVectorGetBitmap(bv), idx) ? 1 : 0;
   return (bv->_bytes[byteIdx] >> (7 - bitIdx)) & 0x01;
 }
 
@@ -249,6 +345,7 @@ CFBitVectorGetCount (CFBitVectorRef bv)
 
 #if defined(__GNUC__) || defined(__llvm__)
 #define POPCOUNT(u8) __builtin_popcount(u8)
+#define POPCOUNT64(u64) __builtin_popcountll(u64)
 #else
 static UInt8 mu0 = 0x55;
 static UInt8 mu1 = 0x33;
@@ -260,6 +357,14 @@ CF_INLINE CFIndex POPCOUNT(UInt8 u8)
   x = (x + (x>>4)) & mu2;
   return x & 0xFF;
 }
+
+CF_INLINE CFIndex POPCOUNT64(UInt64 u64)
+{
+  UInt64 x = u64 - ((u64>>1) & 0x5555555555555555ULL);
+  x = (x & 0x3333333333333333ULL) + ((x>>2) & 0x3333333333333333ULL);
+  x = (x + (x>>4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (x * 0x0101010101010101ULL) >> 56;
+}
 #endif
 
 static UInt8
@@ -280,20 +385,80 @@ CountZero (UInt8 byte, UInt8 mask, void *context)
   return byte;
 }
 
+CFBITVECTOR_KERNEL static void
+CountOneBytes (UInt8 *bytes, CFIndex length, void *context)
+{
+  CFIndex *count = (CFIndex*)context;
+  CFIndex n = 0;
+  CFIndex idx;
+  
+  for (idx = 0 ; idx + 8 <= length ; idx += 8)
+    n += POPCOUNT64(CFBitVectorLoadWord (bytes + idx));
+  for ( ; idx < length ; ++idx)
+    n += POPCOUNT(bytes[idx]);
+  *count += n;
+}
+
+static void
+CountZeroBytes (UInt8 *bytes, CFIndex length, void *context)
+{
+  CFIndex *count = (CFIndex*)context;
+  CFIndex ones = 0;
+  
+  CountOneBytes (bytes, length, &ones);
+  *count += (length << 3) - ones;
+}
+
 CFIndex
 CFBitVectorGetCountOfBit (CFBitVectorRef bv, CFRange range, CFBit value)
 {
   CFIndex count = 0;
-  CFBitVectorOperation (bv, range, value ? CountOne : CountZero, &count);
+  if (CFBitVectorIsCompressed(bv))
+    {
+      count = GSBitmapCountRange (CFBitVectorGetBitmap(bv), range);
+      return value ? count : range.length - count;
+    }
+  CFBitVectorOperation (bv, range, value ? CountOne : CountZero,
+    value ? CountOneBytes : CountZeroBytes, &count);
   return count;
 }
 
+/* The searches below check single bits up to a byte boundary, skip the
+   whole words and then the bytes that do not contain the bit, and check
+   single bits again from there.  That last step ends within a byte. */
+
 CFIndex
 CFBitVectorGetFirstIndexOfBit (CFBitVectorRef bv, CFRange range, CFBit value)
 {
   CFIndex idx;
+  CFIndex end;
+  CFIndex curByte;
+  CFIndex endByte;
+  UInt8 skip;
   
-  for (idx = range.location ; idx < range.location + range.length ; idx++)
+  if (CFBitVectorIsCompressed(bv))
+    return GSBitmapFirstIndex (CFBitVectorGetBitmap(bv), range, value);
+  idx = range.location;
+  end = range.location + range.length;
+  while (idx < end && CFBitVectorGetBitIndex (idx) != 0)
+    {
+      if (value == CFBitVectorGetBitAtIndex (bv, idx))
+        return idx;
+      ++idx;
+    }
+  if (idx == end)
+    return kCFNotFound;
+  
+  skip = value ? 0x00 : 0xFF;
+  curByte = CFBitVectorGetByte (idx);
+  endByte = CFBitVectorGetByte (end);
+  while (curByte + 8 <= endByte
+         && CFBitVectorLoadWord (bv->_bytes + curByte) == (value ? 0 : ~0ULL))
+    curByte += 8;
+  while (curByte < endByte && bv->_bytes[curByte] == skip)
+    ++curByte;
+  
+  for (idx = curByte << 3 ; idx < end ; idx++)
     {
       if (value == CFBitVectorGetBitAtIndex (bv, idx))
         return idx;
@@ -306,10 +471,37 @@ CFIndex
 CFBitVectorGetLastIndexOfBit (CFBitVectorRef bv, CFRange range, CFBit value)
 {
   CFIndex idx;
-
-  for (idx = range.location + range.length - 1 ; idx >= range.location ; idx--)
+  CFIndex start;
+  CFIndex curByte;
+  CFIndex startByte;
+  UInt8 skip;
+
+  if (CFBitVectorIsCompressed(bv))
+    return GSBitmapLastIndex (CFBitVectorGetBitmap(bv), range, value);
+  start = range.location;
+  idx = range.location + range.length;
+  while (idx > start && CFBitVectorGetBitIndex (idx) != 0)
     {
-      if (value == CFBitVectorGetBitAtIndex (bv, idx))
+      if (value == CFBitVectorGetBitAtIndex (bv, --idx))
+        return idx;
+    }
+  if (idx == start)
+    return kCFNotFound;
+  
+  /* Bytes before curByte remain to be checked. */
+  skip = value ? 0x00 : 0xFF;
+  curByte = CFBitVectorGetByte (idx);
+  startByte = CFBitVectorGetByte (start + 7);
+  while (curByte - 8 >= startByte
+         && CFBitVectorLoadWord (bv->_bytes + curByte - 8)
+            == (value ? 0 : ~0ULL))
+    curByte -= 8;
+  while (curByte > startByte && bv->_bytes[curByte - 1] == skip)
+    --curByte;
+  
+  for (idx = curByte << 3 ; idx > start ; )
+    {
+      if (value == CFBitVectorGetBitAtIndex (bv, --idx))
         return idx;
     }
   
@@ -340,12 +532,39 @@ CFBitVectorCreateMutable (CFAllocatorRef alloc, CFIndex capacity)
   return new;
 }
 
+CFMutableBitVectorRef
+CFBitVectorCreateMutableWithOptions (CFAllocatorRef alloc, CFIndex capacity,
+  CFBitVectorOptions options)
+{
+  CFMutableBitVectorRef new;
+  
+  if (!(options & kCFBitVectorCompressed))
+    return CFBitVectorCreateMutable (alloc, capacity);
+  
+  new = (CFMutableBitVectorRef)_CFRuntimeCreateInstance (alloc,
+    _kCFBitVectorTypeID, CFBITVECTOR_SIZE, 0);
+  if (new)
+    {
+      CFBitVectorSetMutable (new);
+      ((CFRuntimeBase *)new)->_flags.info |= _kCFBitVectorIsCompressed;
+    }
+  
+  return new;
+}
+
 CFMutableBitVectorRef
 CFBitVectorCreateMutableCopy (CFAllocatorRef alloc, CFIndex capacity,
   CFBitVectorRef bv)
 {
   CFMutableBitVectorRef new;
   
+  if (CFBitVectorIsCompressed(bv))
+    {
+      new = CFBitVectorCreateCompressedCopy (alloc, bv);
+      if (new)
+        CFBitVectorSetMutable (new);
+      return new;
+    }
   if (capacity < bv->_count)
     capacity = bv->_count;
   new = CFBitVectorCreateMutable (alloc, capacity);
@@ -364,22 +583,52 @@ FlipBits (UInt8 byte, UInt8 mask, void *context)
   return byte ^ mask;
 }
 
+CFBITVECTOR_KERNEL static void
+FlipBytes (UInt8 *bytes, CFIndex length, void *context)
+{
+  CFIndex idx;
+  
+  for (idx = 0 ; idx + 8 <= length ; idx += 8)
+    CFBitVectorStoreWord (bytes + idx, ~CFBitVectorLoadWord (bytes + idx));
+  for ( ; idx < length ; ++idx)
+    bytes[idx] = ~bytes[idx];
+}
+
 void
 CFBitVectorFlipBitAtIndex (CFMutableBitVectorRef bv, CFIndex idx)
 {
-  CFBitVectorOperation (bv, CFRangeMake(idx, 1), FlipBits, NULL);
+  if (CFBitVectorIsCompressed(bv))
+    {
+      CFBitVectorSetBitAtIndex (bv, idx, !CFBitVectorGetBitAtIndex (bv, idx));
+      return;
+    }
+  bv->_bytes[CFBitVectorGetByte (idx)] ^= 0x80 >> CFBitVectorGetBitIndex (idx);
 }
 
 void
 CFBitVectorFlipBits (CFMutableBitVectorRef bv, CFRange range)
 {
-  CFBitVectorOperation (bv, range, FlipBits, NULL);
+  if (CFBitVectorIsCompressed(bv))
+    {
+      GSBitmapFlipRange (CFGetAllocator(bv), &bv->_bitmap, range);
+      return;
+    }
+  CFBitVectorOperation (bv, range, FlipBits, FlipBytes, NULL);
 }
 
 void
 CFBitVectorSetAllBits (CFMutableBitVectorRef bv, CFBit value)
 {
   UInt8 bytes = value ? 0xFF : 0x00;
+  if (CFBitVectorIsCompressed(bv))
+    {
+      if (value)
+        GSBitmapSetRange (CFGetAllocator(bv), &bv->_bitmap,
+          CFRangeMake (0, bv->_count), true);
+      else
+        GSBitmapFree (CFGetAllocator(bv), &bv->_bitmap);
+      return;
+    }
   memset (bv->_bytes, bytes, bv->_byteCount);
 }
 
@@ -395,21 +644,223 @@ SetZero (UInt8 byte, UInt8 mask, void *context)
   return byte & (~mask);
 }
 
+static void
+SetOneBytes (UInt8 *bytes, CFIndex length, void *context)
+{
+  memset (bytes, 0xFF, length);
+}
+
+static void
+SetZeroBytes (UInt8 *bytes, CFIndex length, void *context)
+{
+  memset (bytes, 0x00, length);
+}
+
 void
 CFBitVectorSetBitAtIndex (CFMutableBitVectorRef bv, CFIndex idx, CFBit value)
 {
-  CFBitVectorOperation (bv, CFRangeMake(idx, 1), value ? SetOne : SetZero, NULL);
+  UInt8 mask = 0x80 >> CFBitVectorGetBitIndex (idx);
+  
+  if (CFBitVectorIsCompressed(bv))
+    {
+      if (value)
+        GSBitmapAddIndex (CFGetAllocator(bv), &bv->_bitmap, idx);
+      else
+        GSBitmapRemoveIndex (CFGetAllocator(bv), &bv->_bitmap, idx);
+    }
+  else if (value)
+    bv->_bytes[CFBitVectorGetByte (idx)] |= mask;
+  else
+    bv->_bytes[CFBitVectorGetByte (idx)] &= ~mask;
 }
 
 void
 CFBitVectorSetBits (CFMutableBitVectorRef bv, CFRange range, CFBit value)
 {
-  CFBitVectorOperation (bv, range, value ? SetOne : SetZero, NULL);
+  if (CFBitVectorIsCompressed(bv))
+    {
+      GSBitmapSetRange (CFGetAllocator(bv), &bv->_bitmap, range,
+        value ? true : false);
+      return;
+    }
+  CFBitVectorOperation (bv, range, value ? SetOne : SetZero,
+    value ? SetOneBytes : SetZeroBytes, NULL);
+}
+
+enum
+{
+  _kCFBitVectorAnd = GSBitmapAnd,
+  _kCFBitVectorOr = GSBitmapOr,
+  _kCFBitVectorXor = GSBitmapXor,
+  _kCFBitVectorAndNot = GSBitmapAndNot
+};
+
+CF_INLINE UInt64
+CFBitVectorCombineWord (UInt64 word, UInt64 other, int op)
+{
+  switch (op)
+    {
+      case _kCFBitVectorAnd:
+        return word & other;
+      case _kCFBitVectorOr:
+        return word | other;
+      case _kCFBitVectorXor:
+        return word ^ other;
+      default:
+        return word & ~other;
+    }
+}
+
+/* Combines whole words and returns the number of bytes done.  It is
+   inlined with a constant op, so each operation gets its own loop. */
+CF_INLINE CFIndex
+CFBitVectorCombineWords (UInt8 *bytes, const UInt8 *other, CFIndex length,
+  int op)
+{
+  CFIndex idx;
+  
+  for (idx = 0 ; idx + 8 <= length ; idx += 8)
+    CFBitVectorStoreWord (bytes + idx,
+      CFBitVectorCombineWord (CFBitVectorLoadWord (bytes + idx),
+        CFBitVectorLoadWord (other + idx), op));
+  return idx;
+}
+
+CFBITVECTOR_KERNEL static void
+CFBitVectorCombineBytes (UInt8 *bytes, const UInt8 *other, CFIndex length,
+  int op)
+{
+  CFIndex idx;
+  
+  switch (op)
+    {
+      case _kCFBitVectorAnd:
+        idx = CFBitVectorCombineWords (bytes, other, length, _kCFBitVectorAnd);
+        break;
+      case _kCFBitVectorOr:
+        idx = CFBitVectorCombineWords (bytes, other, length, _kCFBitVectorOr);
+        break;
+      case _kCFBitVectorXor:
+        idx = CFBitVectorCombineWords (bytes, other, length, _kCFBitVectorXor);
+        break;
+      default:
+        idx = CFBitVectorCombineWords (bytes, other, length,
+          _kCFBitVectorAndNot);
+        break;
+    }
+  for ( ; idx < length ; ++idx)
+    bytes[idx] = CFBitVectorCombineWord (bytes[idx], other[idx], op);
+}
+
+static void
+CFBitVectorCombine (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other, int op)
+{
+  CFIndex curByte;
+  CFIndex endByte;
+  UInt8 mask;
+  UInt8 *bytes;
+  const UInt8 *otherBytes;
+
+  if (range.length <= 0)
+    return;
+  if (CFBitVectorIsCompressed(bv) != CFBitVectorIsCompressed(other))
+    {
+      CFMutableBitVectorRef copy;
+      CFIndex idx;
+      CFIndex end;
+      
+      /* Copy the bits of other in range to a vector like bv. */
+      copy = CFBitVectorCreateMutableWithOptions (NULL, other->_count,
+        CFBitVectorIsCompressed(bv) ? kCFBitVectorCompressed : 0);
+      CFBitVectorSetCount (copy, other->_count);
+      end = range.location + range.length;
+      for (idx = range.location ; idx < end ; ++idx)
+        {
+          idx = CFBitVectorGetFirstIndexOfBit (other,
+            CFRangeMake (idx, end - idx), 1);
+          if (idx == kCFNotFound)
+            break;
+          CFBitVectorSetBitAtIndex (copy, idx, 1);
+        }
+      CFBitVectorCombine (bv, range, copy, op);
+      CFRelease (copy);
+      return;
+    }
+  if (CFBitVectorIsCompressed(bv))
+    {
+      GSBitmapCombine (CFGetAllocator(bv), &bv->_bitmap, range,
+        &other->_bitmap, op);
+      return;
+    }
+
+  curByte = CFBitVectorGetByte (range.location);
+  endByte = CFBitVectorGetByte (range.location + range.length - 1);
+  bytes = bv->_bytes;
+  otherBytes = other->_bytes;
+  
+  /* First byte, which may also be the last. */
+  mask = CFBitVectorBitMask (CFBitVectorGetBitIndex (range.location),
+    curByte == endByte ?
+    CFBitVectorGetBitIndex (range.location + range.length - 1) : 7);
+  bytes[curByte] = (bytes[curByte] & ~mask)
+    | (CFBitVectorCombineWord (bytes[curByte], otherBytes[curByte], op) & mask);
+  if (curByte == endByte)
+    return;
+  ++curByte;
+  
+  /* Middle bytes */
+  CFBitVectorCombineBytes (bytes + curByte, otherBytes + curByte,
+    endByte - curByte, op);
+  curByte = endByte;
+  
+  /* Last byte */
+  mask = CFBitVectorBitMask (0,
+    CFBitVectorGetBitIndex (range.location + range.length - 1));
+  bytes[curByte] = (bytes[curByte] & ~mask)
+    | (CFBitVectorCombineWord (bytes[curByte], otherBytes[curByte], op) & mask);
+}
+
+void
+CFBitVectorAndBits (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other)
+{
+  CFBitVectorCombine (bv, range, other, _kCFBitVectorAnd);
+}
+
+void
+CFBitVectorOrBits (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other)
+{
+  CFBitVectorCombine (bv, range, other, _kCFBitVectorOr);
+}
+
+void
+CFBitVectorXorBits (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other)
+{
+  CFBitVectorCombine (bv, range, other, _kCFBitVectorXor);
+}
+
+void
+CFBitVectorAndNotBits (CFMutableBitVectorRef bv, CFRange range,
+  CFBitVectorRef other)
+{
+  CFBitVectorCombine (bv, range, other, _kCFBitVectorAndNot);
 }
 
 void
 CFBitVectorSetCount (CFMutableBitVectorRef bv, CFIndex count)
 {
+  if (CFBitVectorIsCompressed(bv))
+    {
+      /* Bits past the end are cleared so that they are not counted. */
+      if (count < bv->_count)
+        GSBitmapSetRange (CFGetAllocator(bv), &bv->_bitmap,
+          CFRangeMake (count, bv->_count - count), false);
+      bv->_count = count;
+      return;
+    }
   if (count != bv->_count)
     {
       CFIndex newByteCount = CFBitVectorGetByteCount (count);
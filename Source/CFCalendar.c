@@ -253,7 +253,8 @@ CFCalendarCopyCurrent (void)
           
           locale = CFLocaleCopyCurrent ();
           calIdent = CFLocaleGetValue (locale, kCFLocaleCalendarIdentifier);
-          cal = CFCalendarCreateWithIdentifier (NULL, calIdent);
+          cal = CFCalendarCreateWithIdentifier (kCFAllocatorSystemDefault,
+                                                calIdent);
           CFCalendarSetLocale (cal, locale);
           
           CFRelease (locale);
@@ -29,6 +29,7 @@
 #include "CoreFoundation/CFDictionary.h"
 #include "CoreFoundation/CFString.h"
 #include "GSPrivate.h"
+#include "GSConcurrentMap.h"
 
 #if defined(HAVE_UNICODE_USET_H)
 #include <unicode/uset.h>
@@ -44,8 +45,7 @@ struct __CFCharacterSet
 };
 
 static CFTypeID _kCFCharacterSetTypeID = 0;
-static CFMutableDictionaryRef _kCFPredefinedCharacterSets = NULL;
-static GSMutex _kCFPredefinedCharacterSetLock;
+static GSConcurrentMapRef _kCFPredefinedCharacterSets = NULL;
 
 static void
 CFCharacterSetFinalize (CFTypeRef cf)
@@ -83,7 +83,9 @@ static const CFRuntimeClass CFCharacterSetClass =
 void CFCharacterSetInitialize (void)
 {
   _kCFCharacterSetTypeID = _CFRuntimeRegisterClass (&CFCharacterSetClass);
-  GSMutexInitialize (&_kCFPredefinedCharacterSetLock);
+  /* No need to set key callbacks. */
+  _kCFPredefinedCharacterSets = GSConcurrentMapCreate (15, NULL,
+    &kCFTypeDictionaryValueCallBacks);
 }
 
 
@@ -266,38 +268,29 @@ CFCharacterSetGetPredefined (CFCharacterSetPredefinedSet setIdentifier)
 {
   struct __CFCharacterSet *ret;
   
-  if (_kCFPredefinedCharacterSets == NULL)
-    {
-      GSMutexLock (&_kCFPredefinedCharacterSetLock);
-      if (_kCFPredefinedCharacterSets == NULL)
-        {
-          /* No need to set callbacks. */
-          _kCFPredefinedCharacterSets = CFDictionaryCreateMutable (NULL, 15,
-            NULL, &kCFTypeDictionaryValueCallBacks);
-        }
-      GSMutexUnlock (&_kCFPredefinedCharacterSetLock);
-    }
-  
   ret = (struct __CFCharacterSet*)
-    CFDictionaryGetValue (_kCFPredefinedCharacterSets,
+    GSConcurrentMapGetValue (_kCFPredefinedCharacterSets,
     (const void*)setIdentifier);
   if (ret == NULL)
     {
-      GSMutexLock (&_kCFPredefinedCharacterSetLock);
-      ret = (struct __CFCharacterSet*)_CFRuntimeCreateInstance (NULL,
-        _kCFCharacterSetTypeID, CFCHARACTERSET_SIZE, 0);
-      if (ret)
+      struct __CFCharacterSet *new;
+      
+      new = (struct __CFCharacterSet*)_CFRuntimeCreateInstance (
+        kCFAllocatorSystemDefault, _kCFCharacterSetTypeID,
+        CFCHARACTERSET_SIZE, 0);
+      if (new)
         {
           UErrorCode err = U_ZERO_ERROR;
-          ret->_uset = uset_openPattern (predefinedSets[setIdentifier - 1],
+          new->_uset = uset_openPattern (predefinedSets[setIdentifier - 1],
                                          predefinedSetsSize[setIdentifier - 1],
                                          &err);
-          uset_freeze (ret->_uset);
-          CFDictionaryAddValue (_kCFPredefinedCharacterSets,
-                                (const void*)setIdentifier, ret);
-          CFRelease (ret);
+          uset_freeze (new->_uset);
+          /* If another thread got here first, its set is kept instead. */
+          ret = (struct __CFCharacterSet*)
+            GSConcurrentMapAddValue (_kCFPredefinedCharacterSets,
+                                     (const void*)setIdentifier, new);
+          CFRelease (new);
         }
-      GSMutexUnlock (&_kCFPredefinedCharacterSetLock);
     }
   
   return ret;
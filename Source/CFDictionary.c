@@ -254,6 +254,28 @@ CFDictionaryGetValueIfPresent (CFDictionaryRef dict,
   return false;
 }
 
+CFIndex
+CFDictionaryGetValuesForKeys (CFDictionaryRef dict, const void **keys,
+  CFIndex numKeys, const void **values)
+{
+  if (CF_IS_OBJC(_kCFDictionaryTypeID, dict))
+    {
+      CFIndex i;
+      CFIndex found = 0;
+      
+      for (i = 0; i < numKeys; i++)
+        {
+          values[i] = CFDictionaryGetValue (dict, keys[i]);
+          if (values[i])
+            found++;
+        }
+      return found;
+    }
+  
+  return GSHashTableGetValuesForKeys ((GSHashTableRef)dict, keys, numKeys,
+    values, NULL);
+}
+
 CFTypeID
 CFDictionaryGetTypeID (void)
 {
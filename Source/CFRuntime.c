@@ -29,6 +29,7 @@
 
 #include "GSPrivate.h"
 #include "GSObjCRuntime.h"
+#include "GSThreadPool.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -426,11 +427,14 @@ void
 GSRuntimeDeallocateInstance (CFTypeRef cf)
 {
   CFRuntimeClass *cls;
+  CFAllocatorRef allocator;
   cls = __CFRuntimeClassTable[CFGetTypeID (cf)];
+  allocator = CFGetAllocator (cf);
 
-  if (cls->finalize)
+  /* Objects in an arena that is going away need no cleaning up. */
+  if (cls->finalize && !GSAllocatorIsDying (allocator))
     cls->finalize (cf);
-  CFAllocatorDeallocate (CFGetAllocator (cf), (void *) &((obj) cf)[-1]);
+  CFAllocatorDeallocate (allocator, (void *) &((obj) cf)[-1]);
 }
 
 static CFTypeRef GSRuntimeConstantTable[512];
@@ -482,6 +486,7 @@ GS_PRIVATE void CFStreamInitialize (void);
 GS_PRIVATE void CFStringInitialize (void);
 GS_PRIVATE void CFConstantStringInitialize (void);
 GS_PRIVATE void CFStringEncodingInitialize (void);
+GS_PRIVATE void CFStringUtilitiesInitialize (void);
 GS_PRIVATE void CFTimeZoneInitialize (void);
 GS_PRIVATE void CFTreeInitialize (void);
 GS_PRIVATE void CFURLInitialize (void);
@@ -500,6 +505,10 @@ CFInitialize (void)
   if (GSAtomicCompareAndSwapCFIndex (&CFInitialized, 0, 1) == 1)
     return;
 
+  /* Must come before anything computes a hash. */
+  GSHashInitialize ();
+  GSThreadPoolInitialize ();
+
   /* Initialize CFRuntimeClassTable */
   __CFRuntimeClassTable = (CFRuntimeClass **) calloc (__CFRuntimeClassTableSize,
                                                       sizeof (CFRuntimeClass
@@ -534,6 +543,7 @@ CFInitialize (void)
   CFStringInitialize ();
   CFConstantStringInitialize (); /* must be after CFStringIntialize () */
   CFStringEncodingInitialize ();
+  CFStringUtilitiesInitialize ();
   CFTimeZoneInitialize ();
   CFTreeInitialize ();
   CFURLInitialize ();
@@ -208,6 +208,30 @@ CFSetGetValueIfPresent (CFSetRef set, const void *candidate, const void **value)
   return false;
 }
 
+CFIndex
+CFSetContainsValues (CFSetRef set, const void **values, CFIndex numValues,
+                     Boolean *contained)
+{
+  if (CF_IS_OBJC (_kCFSetTypeID, set))
+    {
+      CFIndex i;
+      CFIndex found = 0;
+
+      for (i = 0; i < numValues; i++)
+        {
+          Boolean c = CFSetContainsValue (set, values[i]);
+          if (contained)
+            contained[i] = c;
+          if (c)
+            found++;
+        }
+      return found;
+    }
+
+  return GSHashTableGetValuesForKeys ((GSHashTableRef) set, values, numValues,
+                                      NULL, contained);
+}
+
 CFTypeID
 CFSetGetTypeID (void)
 {
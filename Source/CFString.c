@@ -36,6 +36,7 @@
 #include "CoreFoundation/GSUnicode.h"
 
 #include "GSPrivate.h"
+#include "GSConcurrentMap.h"
 #include "GSObjCRuntime.h"
 #include "GSMemory.h"
 
@@ -181,53 +182,66 @@ CFStringFinalize (CFTypeRef cf)
   CFStringRef str = (CFStringRef) cf;
 
   if (!CFStringIsInline (str))
-    CFAllocatorDeallocate (str->_deallocator, str->_contents);
+    {
+      CFAllocatorDeallocate (str->_deallocator, str->_contents);
+      /* Mutable strings do not retain their allocator. */
+      if (!CFStringIsMutable (str))
+        CFRelease (str->_deallocator);
+    }
 }
 
 static Boolean
 CFStringEqual (CFTypeRef cf1, CFTypeRef cf2)
 {
-  return CFStringCompare (cf1, cf2, 0) == 0 ? true : false;
+  CFStringRef str1 = (CFStringRef) cf1;
+  CFStringRef str2 = (CFStringRef) cf2;
+
+  /* CFEqual() only gets here if neither string is an ObjC object. */
+  if (str1->_count != str2->_count)
+    return false;
+  if (str1->_hash != 0 && str2->_hash != 0 && str1->_hash != str2->_hash)
+    return false;
+
+  return CFStringCompare (str1, str2, 0) == 0 ? true : false;
 }
 
 static CFHashCode
 CFStringHash (CFTypeRef cf)
 {
   CFStringRef str = (CFStringRef) cf;
-  UniChar *buf;
-  CFIndex len;
-  Boolean isObjc;
   CFHashCode hash;
+  CFIndex len;
 
-  isObjc = CF_IS_OBJC (_kCFStringTypeID, str);
-
-  if (!isObjc)
+  len = CFStringGetLength (str);
+  if (CF_IS_OBJC (_kCFStringTypeID, str))
     {
-      if (str->_hash == 0)
+      UniChar buffer[BUFFER_SIZE];
+      UInt64 state;
+      CFIndex idx;
+
+      /* Hash the characters piecewise so nothing needs to be allocated. */
+      state = GSHashCharactersStart ();
+      for (idx = 0; len - idx > BUFFER_SIZE; idx += BUFFER_SIZE)
         {
-          if (CFStringIsUnicode (str))
-            {
-              len = CFStringGetLength (str) * sizeof (UniChar);
-              ((struct __CFString *) str)->_hash =
-                GSHashBytes (str->_contents, len);
-              return str->_hash;
-            }
+          CFStringGetCharacters (str, CFRangeMake (idx, BUFFER_SIZE), buffer);
+          state = GSHashCharactersUpdate (state, buffer, BUFFER_SIZE);
         }
-      else
-        return str->_hash;
+      CFStringGetCharacters (str, CFRangeMake (idx, len - idx), buffer);
+      return GSHashCharactersFinish (state, buffer, len - idx, len);
     }
 
-  len = CFStringGetLength (str) * sizeof (UniChar);
-
-  buf = CFAllocatorAllocate (kCFAllocatorSystemDefault, len, 0);
-  CFStringGetCharacters (str, CFRangeMake (0, len / 2), buf);
-
-  hash = GSHashBytes (buf, len);
-  if (!isObjc)
-    ((struct __CFString *) str)->_hash = hash;
+  if (str->_hash == 0)
+    {
+      if (CFStringIsUnicode (str))
+        hash = GSHashCharactersFinish (GSHashCharactersStart (),
+                                       str->_contents, len, len);
+      else
+        hash = GSHashCharacters8Finish (GSHashCharactersStart (),
+                                        str->_contents, len, len);
+      ((struct __CFString *) str)->_hash = hash;
+    }
 
-  CFAllocatorDeallocate (kCFAllocatorSystemDefault, buf);
-  return hash;
+  return str->_hash;
 }
 
 static CFStringRef
@@ -248,8 +262,7 @@ static const CFRuntimeClass CFStringClass = {
   NULL
 };
 
-static GSMutex static_strings_lock;
-static CFMutableDictionaryRef static_strings;
+static GSConcurrentMapRef static_strings;
 /*
  * Hack to allocated CFStrings uniquely without compiler support.
  */
@@ -258,21 +271,16 @@ __CFStringMakeConstantString (const char *str)
 {
   CFStringRef old;
 
-  GSMutexLock (&static_strings_lock);
-  /* The 170 capacity is really arbitrary.  I just wanted to make the
-   * number large enough so that the hash table size comes out to 257,
-   * a table large enough to fit most needs before needing to expand.
-   */
-  if (static_strings == NULL)
-    static_strings = CFDictionaryCreateMutable (NULL, 170, NULL, NULL);
-
-  old = (CFStringRef) CFDictionaryGetValue (static_strings, str);
+  old = (CFStringRef) GSConcurrentMapGetValue (static_strings, str);
   if (NULL == old)
     {
       struct __CFString *new_const_str;
 
-      new_const_str =
-        CFAllocatorAllocate (NULL, sizeof (struct __CFString), 0);
+      /* Constant strings live as long as the process, so they must not
+       * come from the calling thread's default allocator.
+       */
+      new_const_str = CFAllocatorAllocate (kCFAllocatorSystemDefault,
+                                           sizeof (struct __CFString), 0);
       assert (new_const_str);
 
       /* Using _CFRuntimeInitStaticInstance() guarantees that any CFRetain or
@@ -284,11 +292,12 @@ __CFStringMakeConstantString (const char *str)
       new_const_str->_hash = 0;
       new_const_str->_deallocator = NULL;
 
-      CFDictionaryAddValue (static_strings, str,
-                            (const void *) new_const_str);
-      old = new_const_str;
+      old = (CFStringRef) GSConcurrentMapAddValue (static_strings, str,
+                                                   (const void *)
+                                                   new_const_str);
+      if (old != new_const_str)
+        CFAllocatorDeallocate (kCFAllocatorSystemDefault, new_const_str);
     }
-  GSMutexUnlock (&static_strings_lock);
 
   return old;
 }
@@ -297,7 +306,10 @@ void
 CFStringInitialize (void)
 {
   _kCFStringTypeID = _CFRuntimeRegisterClass (&CFStringClass);
-  GSMutexInitialize (&static_strings_lock);
+  /* The capacity is really arbitrary.  It is large enough to fit most
+   * needs before needing to expand.
+   */
+  static_strings = GSConcurrentMapCreate (170, NULL, NULL);
 }
 
 
@@ -442,10 +454,6 @@ CFStringCreateImmutable (CFAllocatorRef alloc, const UInt8 * bytes,
                                                         extra, NULL);
   if (new)
     {
-      if (contentsDealloc == NULL)
-        contentsDealloc = CFAllocatorGetDefault ();
-      new->_deallocator = CFRetain (contentsDealloc);
-
       if (copy)
         {
           new->_contents = &(new[1]);
@@ -476,6 +484,10 @@ CFStringCreateImmutable (CFAllocatorRef alloc, const UInt8 * bytes,
         }
       else
         {
+          /* Only needed for contents that are not inline. */
+          if (contentsDealloc == NULL)
+            contentsDealloc = CFAllocatorGetDefault ();
+          new->_deallocator = CFRetain (contentsDealloc);
           new->_contents = (void *) bytes;
           new->_count = encoding == kCFStringEncodingASCII
             ? numBytes : numBytes / sizeof (UniChar);
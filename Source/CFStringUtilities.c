@@ -27,9 +27,14 @@
 #include "CoreFoundation/CFBase.h"
 #include "CoreFoundation/CFArray.h"
 #include "CoreFoundation/CFCharacterSet.h"
+#include "CoreFoundation/CFData.h"
 #include "CoreFoundation/CFLocale.h"
 #include "CoreFoundation/CFString.h"
 #include "GSPrivate.h"
+#include "GSObjCRuntime.h"
+
+#include <stdlib.h>
+#include <string.h>
 
 #if defined(HAVE_UNICODE_UCOL_H)
 #include <unicode/ucol.h>
@@ -46,19 +51,73 @@
 
 
 
-CF_INLINE UCollator *
-CFStringICUCollatorOpen (CFStringCompareFlags options, CFLocaleRef loc)
+/* Opening a collator is expensive, so every thread keeps a small cache of
+   the collators it has used recently.  Entries are keyed by the compare
+   options that change the collator's attributes and by the locale
+   identifier, and the least recently used entry is evicted when the cache
+   is full.
+ */
+#define _kCFStringCollatorCacheSize 8
+
+#define _kCFStringCollatorOptionsMask \
+  (kCFCompareCaseInsensitive | kCFCompareNonliteral | kCFCompareLocalized \
+   | kCFCompareNumerically | kCFCompareDiacriticInsensitive \
+   | kCFCompareForcedOrdering)
+
+struct GSCollatorCacheEntry
+{
+  UCollator *collator;
+  CFStringCompareFlags options;
+  UInt32 lastUsed;
+  char locale[ULOC_FULLNAME_CAPACITY];
+};
+
+struct GSCollatorCache
+{
+  UInt32 clock;
+  CFIndex count;
+  struct GSCollatorCacheEntry entries[_kCFStringCollatorCacheSize];
+};
+
+static GSThreadKey _kCFStringCollatorCacheKey;
+static Boolean _kCFStringCollatorCacheKeyValid = false;
+
+static void
+CFStringCollatorCacheDestroy (void *data)
+{
+  struct GSCollatorCache *cache = data;
+  CFIndex idx;
+
+  for (idx = 0 ; idx < cache->count ; ++idx)
+    ucol_close (cache->entries[idx].collator);
+  free (cache);
+}
+
+static struct GSCollatorCache *
+CFStringCollatorCacheGet (void)
+{
+  struct GSCollatorCache *cache;
+
+  if (!_kCFStringCollatorCacheKeyValid)
+    return NULL;
+
+  cache = GSThreadKeyGetValue (_kCFStringCollatorCacheKey);
+  if (cache == NULL)
+    {
+      cache = calloc (1, sizeof (struct GSCollatorCache));
+      if (cache != NULL)
+        GSThreadKeySetValue (_kCFStringCollatorCacheKey, cache);
+    }
+
+  return cache;
+}
+
+static UCollator *
+CFStringICUCollatorCreate (CFStringCompareFlags options, const char *cLocale)
 {
-  const char *cLocale;
-  char buffer[ULOC_FULLNAME_CAPACITY];
   UCollator *ret;
   UErrorCode err = U_ZERO_ERROR;
   
-  if (loc != NULL && (options & kCFCompareLocalized))
-    cLocale = CFLocaleGetCStringIdentifier (loc, buffer, ULOC_FULLNAME_CAPACITY);
-  else
-    cLocale = NULL;
-  
   ret = ucol_open (cLocale, &err);
   if (options)
     {
@@ -79,12 +138,89 @@ CFStringICUCollatorOpen (CFStringCompareFlags options, CFLocaleRef loc)
   return ret;
 }
 
-CF_INLINE void
+/* The returned collator must be given back with CFStringICUCollatorClose().
+ */
+static UCollator *
+CFStringICUCollatorOpen (CFStringCompareFlags options, CFLocaleRef loc)
+{
+  const char *cLocale;
+  char buffer[ULOC_FULLNAME_CAPACITY];
+  struct GSCollatorCache *cache;
+  struct GSCollatorCacheEntry *entry;
+  CFIndex idx;
+  
+  if (loc != NULL && (options & kCFCompareLocalized))
+    cLocale = CFLocaleGetCStringIdentifier (loc, buffer, ULOC_FULLNAME_CAPACITY);
+  else
+    cLocale = NULL;
+  options &= _kCFStringCollatorOptionsMask;
+  
+  cache = CFStringCollatorCacheGet ();
+  if (cache == NULL)
+    return CFStringICUCollatorCreate (options, cLocale);
+  
+  for (idx = 0 ; idx < cache->count ; ++idx)
+    {
+      entry = &cache->entries[idx];
+      if (entry->options == options
+          && strcmp (entry->locale, cLocale ? cLocale : "") == 0)
+        {
+          entry->lastUsed = ++cache->clock;
+          return entry->collator;
+        }
+    }
+  
+  if (cache->count < _kCFStringCollatorCacheSize)
+    {
+      entry = &cache->entries[cache->count++];
+    }
+  else
+    {
+      entry = &cache->entries[0];
+      for (idx = 1 ; idx < cache->count ; ++idx)
+        {
+          if (cache->entries[idx].lastUsed < entry->lastUsed)
+            entry = &cache->entries[idx];
+        }
+      ucol_close (entry->collator);
+    }
+  
+  entry->collator = CFStringICUCollatorCreate (options, cLocale);
+  entry->options = options;
+  entry->lastUsed = ++cache->clock;
+  strncpy (entry->locale, cLocale ? cLocale : "", ULOC_FULLNAME_CAPACITY - 1);
+  entry->locale[ULOC_FULLNAME_CAPACITY - 1] = '\0';
+  
+  return entry->collator;
+}
+
+static void
 CFStringICUCollatorClose (UCollator *collator)
 {
+  struct GSCollatorCache *cache;
+  CFIndex idx;
+  
+  /* Collators owned by the cache stay open for the next caller. */
+  cache = CFStringCollatorCacheGet ();
+  if (cache != NULL)
+    {
+      for (idx = 0 ; idx < cache->count ; ++idx)
+        {
+          if (cache->entries[idx].collator == collator)
+            return;
+        }
+    }
   ucol_close (collator);
 }
 
+void
+CFStringUtilitiesInitialize (void)
+{
+  if (GSThreadKeyCreate (&_kCFStringCollatorCacheKey,
+                         CFStringCollatorCacheDestroy) == 0)
+    _kCFStringCollatorCacheKeyValid = true;
+}
+
 
 
 CFRange
@@ -146,7 +282,12 @@ CFStringFindWithOptionsAndLocale (CFStringRef str,
   usrch = usearch_openFromCollator (text, textLength, pattern, patternLength,
                                     ucol, NULL, &err);
   if (U_FAILURE(err))
-    return false;
+    {
+      CFStringICUCollatorClose (ucol);
+      CFAllocatorDeallocate (alloc, pattern);
+      CFAllocatorDeallocate (alloc, text);
+      return false;
+    }
   
   /* FIXME: need to handle kCFCompareAnchored */
   if (searchOptions & kCFCompareBackwards)
@@ -159,6 +300,8 @@ CFStringFindWithOptionsAndLocale (CFStringRef str,
     }
   if (start == USEARCH_DONE)
     {
+      usearch_close (usrch);
+      CFStringICUCollatorClose (ucol);
       CFAllocatorDeallocate (alloc, pattern);
       CFAllocatorDeallocate (alloc, text);
       return false;
@@ -208,6 +351,137 @@ CFStringCompareWithOptions (CFStringRef str1, CFStringRef str2,
                                               compareOptions, NULL);
 }
 
+/* Any of these options require a collator.  Everything else (backwards,
+   anchored and forced ordering) has no effect on a literal comparison.
+ */
+#define _kCFStringCompareNeedsCollator \
+  (kCFCompareCaseInsensitive | kCFCompareNonliteral | kCFCompareLocalized \
+   | kCFCompareNumerically | kCFCompareDiacriticInsensitive \
+   | kCFCompareWidthInsensitive)
+
+CF_INLINE void
+CFStringGetBackingStore (CFStringRef str, const UniChar **unicode,
+                         const UInt8 **ascii)
+{
+  *unicode = NULL;
+  *ascii = NULL;
+  if (CF_IS_OBJC (CFStringGetTypeID (), str))
+    return;
+
+  *unicode = CFStringGetCharactersPtr (str);
+  if (*unicode == NULL)
+    *ascii = (const UInt8 *) CFStringGetCStringPtr (str,
+                                                    kCFStringEncodingASCII);
+}
+
+/* Compares str1's characters in range1 with all of str2, one UTF-16 code
+   unit at a time.  The ASCII and UTF-16 backing stores are read in place,
+   so nothing is copied unless one of the strings is an ObjC object.
+ */
+static CFComparisonResult
+CFStringCompareLiteral (CFStringRef str1, CFRange range1, CFStringRef str2)
+{
+  const UniChar *u1;
+  const UniChar *u2;
+  const UInt8 *a1;
+  const UInt8 *a2;
+  CFIndex length1;
+  CFIndex length2;
+  CFIndex min;
+  CFIndex idx;
+  SInt32 diff;
+
+  length1 = range1.length;
+  length2 = CFStringGetLength (str2);
+  min = length1 < length2 ? length1 : length2;
+  diff = 0;
+
+  CFStringGetBackingStore (str1, &u1, &a1);
+  CFStringGetBackingStore (str2, &u2, &a2);
+
+  if (a1 != NULL && a2 != NULL)
+    {
+      if (min > 0)
+        diff = memcmp (a1 + range1.location, a2, min);
+    }
+  else if (u1 != NULL && u2 != NULL)
+    {
+      u1 += range1.location;
+      idx = 0;
+      /* Skip the common prefix four code units at a time. */
+      while (idx + 4 <= min)
+        {
+          UInt64 w1;
+          UInt64 w2;
+
+          memcpy (&w1, u1 + idx, sizeof (UInt64));
+          memcpy (&w2, u2 + idx, sizeof (UInt64));
+          if (w1 != w2)
+            break;
+          idx += 4;
+        }
+      for (; idx < min; ++idx)
+        {
+          if (u1[idx] != u2[idx])
+            {
+              diff = (SInt32) u1[idx] - (SInt32) u2[idx];
+              break;
+            }
+        }
+    }
+  else if (u1 != NULL && a2 != NULL)
+    {
+      u1 += range1.location;
+      for (idx = 0; idx < min; ++idx)
+        {
+          if (u1[idx] != a2[idx])
+            {
+              diff = (SInt32) u1[idx] - (SInt32) a2[idx];
+              break;
+            }
+        }
+    }
+  else if (a1 != NULL && u2 != NULL)
+    {
+      a1 += range1.location;
+      for (idx = 0; idx < min; ++idx)
+        {
+          if (a1[idx] != u2[idx])
+            {
+              diff = (SInt32) a1[idx] - (SInt32) u2[idx];
+              break;
+            }
+        }
+    }
+  else
+    {
+      CFStringInlineBuffer buf1;
+      CFStringInlineBuffer buf2;
+
+      CFStringInitInlineBuffer (str1, &buf1, range1);
+      CFStringInitInlineBuffer (str2, &buf2, CFRangeMake (0, length2));
+      for (idx = 0; idx < min; ++idx)
+        {
+          UniChar c1 = CFStringGetCharacterFromInlineBuffer (&buf1, idx);
+          UniChar c2 = CFStringGetCharacterFromInlineBuffer (&buf2, idx);
+          if (c1 != c2)
+            {
+              diff = (SInt32) c1 - (SInt32) c2;
+              break;
+            }
+        }
+    }
+
+  if (diff == 0 && length1 != length2)
+    diff = length1 < length2 ? -1 : 1;
+
+  if (diff < 0)
+    return kCFCompareLessThan;
+  else if (diff > 0)
+    return kCFCompareGreaterThan;
+  return kCFCompareEqualTo;
+}
+
 CFComparisonResult
 CFStringCompareWithOptionsAndLocale (CFStringRef str1,
   CFStringRef str2, CFRange rangeToCompare,
@@ -221,6 +495,9 @@ CFStringCompareWithOptionsAndLocale (CFStringRef str1,
   CFAllocatorRef alloc;
   UCollator *ucol;
   
+  if (!(compareOptions & _kCFStringCompareNeedsCollator))
+    return CFStringCompareLiteral (str1, rangeToCompare, str2);
+  
   alloc = CFAllocatorGetDefault ();
   
   length1 = rangeToCompare.length;
@@ -232,8 +509,8 @@ CFStringCompareWithOptionsAndLocale (CFStringRef str1,
   CFStringGetCharacters (str2, CFRangeMake(0, length2), string2);
   
   ucol = CFStringICUCollatorOpen (compareOptions, locale);
-  ret = (CFComparisonResult)ucol_strcoll (ucol, string2, length2, string1,
-                                          length1);
+  ret = (CFComparisonResult)ucol_strcoll (ucol, string1, length1, string2,
+                                          length2);
   CFStringICUCollatorClose (ucol);
   
   CFAllocatorDeallocate (alloc, string1);
@@ -241,6 +518,137 @@ CFStringCompareWithOptionsAndLocale (CFStringRef str1,
   return ret;
 }
 
+UInt8 *
+GSStringCreateCollationKeys (CFAllocatorRef alloc, const void **strings,
+                             CFIndex count, CFStringCompareFlags options,
+                             CFLocaleRef locale, CFIndex *offsets)
+{
+  UInt8 *keys;
+  UInt8 *newKeys;
+  CFIndex used;
+  CFIndex capacity;
+  UniChar *chars;
+  UniChar *newChars;
+  CFIndex charsCapacity;
+  UCollator *ucol;
+  CFIndex idx;
+  
+  capacity = count * 16 + 16;
+  keys = CFAllocatorAllocate (alloc, capacity, 0);
+  if (keys == NULL)
+    return NULL;
+  used = 0;
+  chars = NULL;
+  charsCapacity = 0;
+  
+  if (options & _kCFStringCompareNeedsCollator)
+    ucol = CFStringICUCollatorOpen (options, locale);
+  else
+    ucol = NULL;
+  
+  for (idx = 0 ; idx < count ; ++idx)
+    {
+      CFStringRef str;
+      const UniChar *characters;
+      CFIndex length;
+      CFIndex need;
+      
+      str = strings[idx];
+      length = CFStringGetLength (str);
+      characters = CFStringGetCharactersPtr (str);
+      if (characters == NULL)
+        {
+          if (length > charsCapacity)
+            {
+              newChars = CFAllocatorReallocate (kCFAllocatorSystemDefault,
+                                                chars,
+                                                length * sizeof (UniChar), 0);
+              if (newChars == NULL)
+                {
+                  CFAllocatorDeallocate (alloc, keys);
+                  keys = NULL;
+                  break;
+                }
+              chars = newChars;
+              charsCapacity = length;
+            }
+          CFStringGetCharacters (str, CFRangeMake (0, length), chars);
+          characters = chars;
+        }
+      
+      offsets[idx] = used;
+      if (ucol != NULL)
+        {
+          need = ucol_getSortKey (ucol, characters, length, keys + used,
+                                  capacity - used);
+        }
+      else
+        {
+          /* Big-endian UTF-16 sorts the same as the code units do. */
+          need = length * sizeof (UniChar);
+        }
+      
+      if (used + need > capacity)
+        {
+          capacity = GS_MAX (capacity * 2, used + need);
+          newKeys = CFAllocatorReallocate (alloc, keys, capacity, 0);
+          if (newKeys == NULL)
+            {
+              CFAllocatorDeallocate (alloc, keys);
+              keys = NULL;
+              break;
+            }
+          keys = newKeys;
+          if (ucol != NULL)
+            ucol_getSortKey (ucol, characters, length, keys + used, need);
+        }
+      
+      if (ucol == NULL)
+        {
+          UInt8 *key;
+          CFIndex i;
+          
+          key = keys + used;
+          for (i = 0 ; i < length ; ++i)
+            {
+              *key++ = characters[i] >> 8;
+              *key++ = characters[i] & 0xFF;
+            }
+        }
+      used += need;
+    }
+  if (keys != NULL)
+    offsets[count] = used;
+  
+  if (ucol != NULL)
+    CFStringICUCollatorClose (ucol);
+  if (chars != NULL)
+    CFAllocatorDeallocate (kCFAllocatorSystemDefault, chars);
+  
+  return keys;
+}
+
+CFDataRef
+CFStringCreateCollationKey (CFAllocatorRef alloc, CFStringRef str,
+                            CFStringCompareFlags compareOptions,
+                            CFLocaleRef locale)
+{
+  CFIndex offsets[2];
+  UInt8 *key;
+  CFDataRef ret;
+  
+  key = GSStringCreateCollationKeys (alloc, (const void **) &str, 1,
+                                     compareOptions, locale, offsets);
+  if (key == NULL)
+    return NULL;
+  
+  ret = CFDataCreateWithBytesNoCopy (alloc, key, offsets[1], alloc);
+  if (ret == NULL)
+    CFAllocatorDeallocate (alloc, key);
+  
+  return ret;
+}
+
 Boolean
 CFStringFindCharacterFromSet (CFStringRef str, CFCharacterSetRef theSet,
   CFRange rangeToSearch, CFStringCompareFlags searchOptions, CFRange *result)
@@ -37,6 +37,7 @@
 #include "CoreFoundation/CFRuntime.h"
 
 #include "GSPrivate.h"
+#include "GSConcurrentMap.h"
 #include "GSObjCRuntime.h"
 #include "tzfile.h"
 
@@ -78,8 +79,7 @@ struct __CFTimeZone
 
 static CFTypeID _kCFTimeZoneTypeID = 0;
 
-static GSMutex _kCFTimeZoneCacheLock;
-static CFMutableDictionaryRef _kCFTimeZoneCache = NULL;
+static GSConcurrentMapRef _kCFTimeZoneCache = NULL;
 static CFTimeZoneRef _kCFTimeZoneDefault = NULL;
 static CFTimeZoneRef _kCFTimeZoneSystem = NULL;
 static CFDictionaryRef _kCFTimeZoneAbbreviationDictionary = NULL;
@@ -115,7 +115,8 @@ static CFRuntimeClass CFTimeZoneClass =
 void CFTimeZoneInitialize (void)
 {
   _kCFTimeZoneTypeID = _CFRuntimeRegisterClass (&CFTimeZoneClass);
-  GSMutexInitialize (&_kCFTimeZoneCacheLock);
+  _kCFTimeZoneCache = GSConcurrentMapCreate (0,
+    &kCFCopyStringDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
 }
 
 
@@ -141,16 +142,13 @@ CFTimeZoneCreate (CFAllocatorRef alloc, CFStringRef name, CFDataRef data)
   struct __CFTimeZone *new;
   CFTimeZoneRef old;
   
-  GSMutexLock(&_kCFTimeZoneCacheLock);
-  if (_kCFTimeZoneCache == NULL)
-    _kCFTimeZoneCache = CFDictionaryCreateMutable (
-      kCFAllocatorSystemDefault, 0,
-      &kCFCopyStringDictionaryKeyCallBacks,
-      &kCFTypeDictionaryValueCallBacks);
-  old = (CFTimeZoneRef)CFDictionaryGetValue (_kCFTimeZoneCache, name);
-  GSMutexUnlock(&_kCFTimeZoneCacheLock);
+  old = (CFTimeZoneRef)GSConcurrentMapGetValue (_kCFTimeZoneCache, name);
   if (old != NULL)
     return CFRetain (old);
+  /* The new time zone is cached for the life of the process and handed
+     to every caller, so it cannot come from the caller's allocator, which
+     may be an arena that is later reset. */
+  alloc = kCFAllocatorSystemDefault;
   
   /* Do some basic checks before we try anything else. */
   bytes = CFDataGetBytePtr (data);
@@ -255,18 +253,14 @@ CFTimeZoneCreate (CFAllocatorRef alloc, CFStringRef name, CFDataRef data)
           /* FIXME: Code for version '2' TZif files */
         }
       
-      GSMutexLock(&_kCFTimeZoneCacheLock);
-      /* Double check another an entry wasn't inserted before we could act. */
-      old = (CFTimeZoneRef)CFDictionaryGetValue (_kCFTimeZoneCache, name);
-      if (old != NULL)
+      /* Another thread may have cached this time zone before we could. */
+      old = (CFTimeZoneRef)GSConcurrentMapAddValue (_kCFTimeZoneCache, name,
+        (const void *)new);
+      if (old != NULL && old != (CFTimeZoneRef)new)
         {
-          GSMutexUnlock(&_kCFTimeZoneCacheLock);
           CFRelease ((CFTimeZoneRef)new);
           return CFRetain (old);
         }
-      CFDictionaryAddValue (_kCFTimeZoneCache, name, (const void *)new);
-      old = (CFTimeZoneRef)new;
-      GSMutexUnlock(&_kCFTimeZoneCacheLock);
     }
   
   return old;
@@ -577,7 +571,8 @@ CFTimeZoneCopySystem (void)
   if (_kCFTimeZoneSystem == NULL)
     {
       CFTimeZoneRef new;
-      new = CFTimeZoneCreateWithTimeIntervalFromGMT (NULL, 0.0); /* FIXME */
+      new = CFTimeZoneCreateWithTimeIntervalFromGMT (kCFAllocatorSystemDefault,
+                                                     0.0); /* FIXME */
       if (GSAtomicCompareAndSwapPointer(&_kCFTimeZoneSystem, NULL, new) != NULL)
         CFRelease (new);
     }
@@ -814,7 +809,8 @@ CFTimeZoneCopyAbbreviationDictionary (void)
       CFMutableDictionaryRef dict;
       CFDictionaryRef new;
       
-      dict = CFDictionaryCreateMutable (NULL, _kCFTimeZoneAbbreviationsSize,
+      dict = CFDictionaryCreateMutable (kCFAllocatorSystemDefault,
+                                        _kCFTimeZoneAbbreviationsSize,
                                         &kCFCopyStringDictionaryKeyCallBacks,
                                         &kCFTypeDictionaryValueCallBacks);
       i = 0;
@@ -830,7 +826,7 @@ CFTimeZoneCopyAbbreviationDictionary (void)
           CFDictionaryAddValue (dict, abbrev, fullname);
           i++;
         }
-      new = CFDictionaryCreateCopy (NULL, dict);
+      new = CFDictionaryCreateCopy (kCFAllocatorSystemDefault, dict);
       CFRelease (dict);
       
       if (GSAtomicCompareAndSwapPointer(&_kCFTimeZoneAbbreviationDictionary,
@@ -847,7 +843,8 @@ CFTimeZoneSetAbbreviationDictionary (CFDictionaryRef dict)
   CFDictionaryRef old;
   old = GSAtomicCompareAndSwapPointer(&_kCFTimeZoneAbbreviationDictionary,
                                       _kCFTimeZoneAbbreviationDictionary,
-                                      CFDictionaryCreateCopy (NULL, dict));
+                                      CFDictionaryCreateCopy (
+                                        kCFAllocatorSystemDefault, dict));
   if (old != NULL)
     CFRelease (old);
 }
@@ -28,12 +28,25 @@
 #include "CoreFoundation/CFString.h"
 #include "CoreFoundation/CFTree.h"
 
+#include "GSCArray.h"
+
 #include <string.h>
 
 
 
 static CFTypeID _kCFTreeTypeID = 0;
 
+/* The nodes of an arena tree are allocated from an arena allocator owned
+   by the root, and go when the root is deallocated. */
+typedef struct GSTreeArena GSTreeArena;
+struct GSTreeArena
+{
+  CFAllocatorRef    parent;       /* Allocates child indices and this */
+  CFAllocatorRef    allocator;    /* Allocates the nodes */
+  CFTreeRef         root;
+  Boolean           needsWalk;    /* Set if teardown must visit nodes */
+};
+
 struct __CFTree
 {
   CFRuntimeBase parent;
@@ -42,6 +55,10 @@ struct __CFTree
   CFTreeRef     _nextSibling;
   CFTreeRef     _firstChild;
   CFTreeRef     _lastChild;
+  CFIndex       _childCount;
+  CFTreeRef    *_childIndex;      /* Children in order, or NULL if stale */
+  CFIndex       _childIndexCapacity;
+  GSTreeArena  *_arena;           /* Shared region, or NULL */
 };
 
 static CFTreeContext _kCFNullTreeContext =
@@ -55,31 +72,165 @@ static CFTreeContext _kCFNullTreeContext =
 
 
 
+static GSTreeArena *
+GSTreeArenaCreate (CFAllocatorRef allocator)
+{
+  GSTreeArena *arena;
+  
+  arena = CFAllocatorAllocate (allocator, sizeof(GSTreeArena), 0);
+  if (arena == NULL)
+    return NULL;
+  memset (arena, 0, sizeof(GSTreeArena));
+  arena->allocator = CFAllocatorCreateArena (allocator, 0);
+  if (arena->allocator == NULL)
+    {
+      CFAllocatorDeallocate (allocator, arena);
+      return NULL;
+    }
+  arena->parent = CFRetain (allocator);
+  
+  return arena;
+}
+
 static void
-CFTreeFinalize (CFTypeRef cf)
+GSTreeArenaDestroy (GSTreeArena *arena)
 {
-  CFTreeRef tree = (CFTreeRef)cf;
-  CFTreeRef child;
-  CFTreeRef tmp;
-  CFTreeReleaseCallBack release;
+  CFAllocatorRef allocator = arena->parent;
+  
+  CFRelease (arena->allocator);
+  CFAllocatorDeallocate (allocator, arena);
+  CFRelease (allocator);
+}
 
-  /* Release the children we retained when they were added. */
-  child = tree->_firstChild;
-  while (child)
+/* Child indices are resized and freed as the tree changes, so arena nodes
+   take them from the allocator behind the arena. */
+CF_INLINE CFAllocatorRef
+CFTreeGetIndexAllocator (CFTreeRef tree)
+{
+  return tree->_arena ? tree->_arena->parent : CFGetAllocator (tree);
+}
+
+/* Notes that the arena can no longer be dropped without visiting its
+   nodes, because child now holds something that must be released. */
+CF_INLINE void
+CFTreeArenaNoteChild (CFTreeRef tree, CFTreeRef child)
+{
+  if (tree->_arena && child->_arena != tree->_arena)
+    tree->_arena->needsWalk = true;
+}
+
+static void
+CFTreeInvalidateChildIndex (CFTreeRef tree)
+{
+  if (tree->_childIndex)
+    {
+      CFAllocatorDeallocate (CFTreeGetIndexAllocator (tree),
+        tree->_childIndex);
+      tree->_childIndex = NULL;
+      tree->_childIndexCapacity = 0;
+    }
+}
+
+/* Releases the children we retained when they were added.  A child that
+   is about to be deallocated hands its own children over to this loop
+   first, so that releasing a deep tree does not recurse. */
+static void
+CFTreeReleaseChildren (CFTreeRef tree)
+{
+  CFTreeRef pending;
+  CFTreeRef child;
+  
+  pending = tree->_firstChild;
+  tree->_firstChild = NULL;
+  tree->_lastChild = NULL;
+  tree->_childCount = 0;
+  CFTreeInvalidateChildIndex (tree);
+  
+  while (pending)
     {
-      tmp = child->_nextSibling;
+      child = pending;
+      pending = child->_nextSibling;
       child->_parent = NULL;
       child->_nextSibling = NULL;
+      if (CFGetRetainCount (child) == 1 && child->_firstChild)
+        {
+          child->_lastChild->_nextSibling = pending;
+          pending = child->_firstChild;
+          child->_firstChild = NULL;
+          child->_lastChild = NULL;
+          child->_childCount = 0;
+        }
       CFRelease (child);
-      child = tmp;
     }
+}
+
+/* Tears down the nodes of the arena rooted at tree.  Nodes in the arena
+   are not released one by one; only their info, their child indices and
+   any foreign trees hanging off them need attention, and the walk is
+   skipped altogether when there are none. */
+static void
+CFTreeReleaseArenaChildren (CFTreeRef tree)
+{
+  GSTreeArena *arena = tree->_arena;
+  CFTreeRef node;
+  CFTreeRef next;
+  
+  node = arena->needsWalk ? tree->_firstChild : NULL;
+  while (node)
+    {
+      /* Find the next node in preorder before this one goes away.  The
+         children of a foreign tree are its own business. */
+      if (node->_arena == arena && node->_firstChild)
+        {
+          next = node->_firstChild;
+        }
+      else
+        {
+          next = node;
+          while (next != tree && next->_nextSibling == NULL)
+            next = next->_parent;
+          next = next == tree ? NULL : next->_nextSibling;
+        }
+      
+      if (node->_arena == arena)
+        {
+          if (node->_context.release)
+            node->_context.release (node->_context.info);
+          CFTreeInvalidateChildIndex (node);
+        }
+      else
+        {
+          node->_parent = NULL;
+          node->_nextSibling = NULL;
+          CFRelease (node);
+        }
+      node = next;
+    }
+  
   tree->_firstChild = NULL;
   tree->_lastChild = NULL;
+  tree->_childCount = 0;
+  CFTreeInvalidateChildIndex (tree);
+}
+
+static void
+CFTreeFinalize (CFTypeRef cf)
+{
+  CFTreeRef tree = (CFTreeRef)cf;
+  CFTreeReleaseCallBack release;
+
+  if (tree->_arena && tree->_arena->root == tree)
+    CFTreeReleaseArenaChildren (tree);
+  else
+    CFTreeReleaseChildren (tree);
 
   /* Release the info supplied in the context. */
   release = tree->_context.release;
   if (release)
     release (tree->_context.info);
+  
+  if (tree->_arena && tree->_arena->root == tree)
+    GSTreeArenaDestroy (tree->_arena);
 }
 
 static CFRuntimeClass CFTreeClass =
@@ -130,11 +281,67 @@ CFTreeCreate (CFAllocatorRef allocator, const CFTreeContext *context)
   return new;
 }
 
+CFTreeRef
+CFTreeCreateWithArena (CFAllocatorRef allocator, const CFTreeContext *context)
+{
+  GSTreeArena *arena;
+  CFTreeRef new;
+  
+  if (allocator == NULL)
+    allocator = CFAllocatorGetDefault ();
+  arena = GSTreeArenaCreate (allocator);
+  if (arena == NULL)
+    return NULL;
+  
+  new = CFTreeCreate (allocator, context);
+  if (new == NULL)
+    {
+      GSTreeArenaDestroy (arena);
+      return NULL;
+    }
+  new->_arena = arena;
+  arena->root = new;
+  arena->needsWalk = new->_context.release != NULL;
+  
+  return new;
+}
+
+CFTreeRef
+CFTreeCreateInArena (CFTreeRef tree, const CFTreeContext *context)
+{
+  GSTreeArena *arena = tree->_arena;
+  CFTreeRef new;
+  
+  if (arena == NULL)
+    return CFTreeCreate (CFGetAllocator (tree), context);
+  
+  new = CFTreeCreate (arena->allocator, context);
+  if (new)
+    {
+      new->_arena = arena;
+      if (new->_context.release)
+        arena->needsWalk = true;
+    }
+  
+  return new;
+}
+
 void
 CFTreeAppendChild (CFTreeRef tree, CFTreeRef newChild)
 {
   CFRetain (newChild);
   newChild->_parent = tree;
+  CFTreeArenaNoteChild (tree, newChild);
+  
+  /* Appending keeps the child index valid if there is room. */
+  if (tree->_childIndex)
+    {
+      if (tree->_childCount < tree->_childIndexCapacity)
+        tree->_childIndex[tree->_childCount] = newChild;
+      else
+        CFTreeInvalidateChildIndex (tree);
+    }
+  tree->_childCount += 1;
 
   if (tree->_firstChild == NULL)
     {
@@ -157,6 +364,9 @@ CFTreeInsertSibling (CFTreeRef tree, CFTreeRef newSibling)
     {
       CFRetain (newSibling);
       newSibling->_parent = parent;
+      CFTreeArenaNoteChild (parent, newSibling);
+      parent->_childCount += 1;
+      CFTreeInvalidateChildIndex (parent);
 
       if (parent->_lastChild == tree)
         parent->_lastChild = newSibling;
@@ -170,21 +380,7 @@ CFTreeInsertSibling (CFTreeRef tree, CFTreeRef newSibling)
 void
 CFTreeRemoveAllChildren (CFTreeRef tree)
 {
-  CFTreeRef child;
-  CFTreeRef tmp;
-  
-  child = tree->_firstChild;
-  while (child)
-    {
-      tmp = child->_nextSibling;
-      child->_parent = NULL;
-      child->_nextSibling = NULL;
-      CFRelease (child);
-      child = tmp;
-    }
-
-  tree->_firstChild = NULL;
-  tree->_lastChild = NULL;
+  CFTreeReleaseChildren (tree);
 }
 
 void
@@ -192,6 +388,9 @@ CFTreePrependChild (CFTreeRef tree, CFTreeRef newChild)
 {
   CFRetain (newChild);
   newChild->_parent = tree;
+  CFTreeArenaNoteChild (tree, newChild);
+  tree->_childCount += 1;
+  CFTreeInvalidateChildIndex (tree);
   newChild->_nextSibling = tree->_firstChild;
   tree->_firstChild = newChild;
   if (tree->_lastChild == NULL)
@@ -232,6 +431,8 @@ CFTreeRemove (CFTreeRef tree)
       parent->_lastChild = last;
     }
 
+  parent->_childCount -= 1;
+  CFTreeInvalidateChildIndex (parent);
   tree->_parent = NULL;
   tree->_nextSibling = NULL;
 
@@ -245,12 +446,39 @@ CFTreeSetContext (CFTreeRef tree, const CFTreeContext *context)
   if (context == NULL)
     context = &_kCFNullTreeContext;
   memcpy (&tree->_context, context, sizeof(CFTreeContext));
+  if (tree->_arena && tree->_context.release)
+    tree->_arena->needsWalk = true;
 }
 
 void
 CFTreeSortChildren (CFTreeRef tree, CFComparatorFunction comp, void *context)
 {
-  /* FIXME */
+  CFTreeRef buffer[64];
+  CFTreeRef *children;
+  CFTreeRef child;
+  CFIndex count;
+  CFIndex idx;
+  
+  count = CFTreeGetChildCount (tree);
+  if (count < 2)
+    return;
+  
+  children = count <= 64 ? buffer
+    : CFAllocatorAllocate (NULL, count * sizeof(CFTreeRef), 0);
+  CFTreeGetChildren (tree, children);
+  GSCArrayQuickSort ((const void **)children, count, comp, context);
+  CFTreeInvalidateChildIndex (tree);
+  
+  /* Relink the children in their new order. */
+  tree->_firstChild = children[0];
+  for (idx = 1 ; idx < count ; ++idx)
+    children[idx - 1]->_nextSibling = children[idx];
+  child = children[count - 1];
+  child->_nextSibling = NULL;
+  tree->_lastChild = child;
+  
+  if (children != buffer)
+    CFAllocatorDeallocate (NULL, children);
 }
 
 CFTreeRef
@@ -262,35 +490,38 @@ CFTreeFindRoot (CFTreeRef tree)
   return tree;
 }
 
+/* The child index is an array of the children in order.  It is built on
+   the first access by index and dropped whenever the children change,
+   except when a child is appended. */
 CFTreeRef
 CFTreeGetChildAtIndex (CFTreeRef tree, CFIndex idx)
 {
-  CFIndex j;
-  CFTreeRef child;
+  if (idx < 0 || idx >= tree->_childCount)
+    return NULL;
+  if (idx == 0)
+    return tree->_firstChild;
+  if (idx == tree->_childCount - 1)
+    return tree->_lastChild;
   
-  j = 0;
-  child = tree->_firstChild;
-  while (child != NULL && j++ < idx)
-    child = child->_nextSibling;
+  if (tree->_childIndex == NULL)
+    {
+      CFIndex capacity = tree->_childCount + (tree->_childCount >> 1);
+      
+      tree->_childIndex = CFAllocatorAllocate (CFTreeGetIndexAllocator (tree),
+        capacity * sizeof(CFTreeRef), 0);
+      if (tree->_arena)
+        tree->_arena->needsWalk = true;
+      tree->_childIndexCapacity = capacity;
+      CFTreeGetChildren (tree, tree->_childIndex);
+    }
 
-  return child;
+  return tree->_childIndex[idx];
 }
 
 CFIndex
 CFTreeGetChildCount (CFTreeRef tree)
 {
-  CFIndex count;
-  CFTreeRef child;
-  
-  count = 0;
-  child = tree->_firstChild;
-  while (child)
-    {
-      child = child->_nextSibling;
-      ++count;
-    }
-  
-  return count;
+  return tree->_childCount;
 }
 
 void
@@ -299,6 +530,12 @@ CFTreeGetChildren (CFTreeRef tree, CFTreeRef *children)
   CFIndex idx;
   CFTreeRef child;
   
+  if (tree->_childIndex && tree->_childIndex != children)
+    {
+      memcpy (children, tree->_childIndex,
+        tree->_childCount * sizeof(CFTreeRef));
+      return;
+    }
   idx = 0;
   child = tree->_firstChild;
   while (child)
@@ -346,3 +583,27 @@ CFTreeApplyFunctionToChildren (CFTreeRef tree, CFTreeApplierFunction applier,
     }
 }
 
+void
+CFTreeApplyFunctionToDescendants (CFTreeRef tree,
+  CFTreeApplierFunction applier, void *context)
+{
+  CFTreeRef node;
+  
+  /* Walk the tree in preorder by following the parent and sibling links,
+     so no stack is needed however deep the tree is. */
+  node = tree->_firstChild;
+  while (node)
+    {
+      applier (node, context);
+      if (node->_firstChild)
+        {
+          node = node->_firstChild;
+          continue;
+        }
+      while (node != tree && node->_nextSibling == NULL)
+        node = node->_parent;
+      if (node == tree)
+        break;
+      node = node->_nextSibling;
+    }
+}
@@ -391,7 +391,7 @@ CFURLStringParse (CFStringRef urlString, CFRange ranges[12])
   
   if (resourceSpecifierStart != kCFNotFound)
     ranges[kCFURLComponentResourceSpecifier - 1] =
-      CFRangeMake (resourceSpecifierStart, idx - resourceSpecifierStart);
+      CFRangeMake (resourceSpecifierStart, idx - resourceSpecifierStart - 1);
   
   return true;
 }
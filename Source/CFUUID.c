@@ -326,12 +326,12 @@ CFUUIDGetConstantUUIDWithBytes (CFAllocatorRef alloc, UInt8 byte0, UInt8 byte1,
   
   GSMutexLock (&_kCFUUIDLock);
   if (_kCFUUIDConstants == NULL)
-    _kCFUUIDConstants = CFSetCreateMutable (NULL, 0, &cb);
+    _kCFUUIDConstants = CFSetCreateMutable (kCFAllocatorSystemDefault, 0, &cb);
   
   if (!CFSetGetValueIfPresent(_kCFUUIDConstants, &uuidBytes,
       (const void**)&uuid))
     {
-      uuid = CFUUIDCreateFromUUIDBytes (NULL, uuidBytes);
+      uuid = CFUUIDCreateFromUUIDBytes (kCFAllocatorSystemDefault, uuidBytes);
       CFSetAddValue (_kCFUUIDConstants, (const void*)uuid);
       CFRelease (uuid);
     }
@@ -0,0 +1,1327 @@
+/* GSBitmap.c
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep CoreBase Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the
+   Free Software Foundation, 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "CoreFoundation/CFBase.h"
+#include "GSBitmap.h"
+
+#include <string.h>
+
+#define GSBITMAP_CHUNK_BITS 16
+#define GSBITMAP_CHUNK_SIZE (1 << GSBITMAP_CHUNK_BITS)
+#define GSBITMAP_CHUNK_MASK (GSBITMAP_CHUNK_SIZE - 1)
+#define GSBITMAP_WORDS (GSBITMAP_CHUNK_SIZE / 64)
+#define GSBITMAP_BITMAP_BYTES (GSBITMAP_WORDS * sizeof(UInt64))
+/* An array holding more values than this is larger than a bitmap. */
+#define GSBITMAP_ARRAY_MAX (GSBITMAP_BITMAP_BYTES / sizeof(UInt16))
+
+enum
+{
+  GSBitmapArrayType,
+  GSBitmapBitmapType,
+  GSBitmapRunType
+};
+
+/* A run is stored as its first and last value. */
+typedef struct
+{
+  UInt16 start;
+  UInt16 last;
+} GSBitmapRun;
+
+#if defined(__GNUC__) || defined(__llvm__)
+#define GSBITMAP_POPCOUNT(w) __builtin_popcountll(w)
+#define GSBITMAP_CTZ(w) __builtin_ctzll(w)
+#define GSBITMAP_CLZ(w) __builtin_clzll(w)
+#else
+CF_INLINE CFIndex
+GSBITMAP_POPCOUNT (UInt64 w)
+{
+  w = w - ((w >> 1) & 0x5555555555555555ULL);
+  w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+  w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (w * 0x0101010101010101ULL) >> 56;
+}
+
+CF_INLINE CFIndex
+GSBITMAP_CTZ (UInt64 w)
+{
+  CFIndex n = 0;
+
+  while ((w & 1) == 0)
+    {
+      w >>= 1;
+      ++n;
+    }
+  return n;
+}
+
+CF_INLINE CFIndex
+GSBITMAP_CLZ (UInt64 w)
+{
+  CFIndex n = 0;
+
+  while ((w & 0x8000000000000000ULL) == 0)
+    {
+      w <<= 1;
+      ++n;
+    }
+  return n;
+}
+#endif
+
+
+
+/* Bitmap words */
+
+/* Returns the mask of bits lo to hi, inclusive, of word w. */
+CF_INLINE UInt64
+GSBitmapWordMask (CFIndex w, CFIndex lo, CFIndex hi)
+{
+  CFIndex first = (w << 6) > lo ? 0 : lo & 63;
+  CFIndex last = (w << 6) + 63 < hi ? 63 : hi & 63;
+
+  return (~0ULL >> (63 - last)) & (~0ULL << first);
+}
+
+static void
+GSBitmapWordsSetRange (UInt64 * words, CFIndex lo, CFIndex hi, Boolean value)
+{
+  CFIndex w;
+
+  for (w = lo >> 6; w <= hi >> 6; ++w)
+    {
+      if (value)
+        words[w] |= GSBitmapWordMask (w, lo, hi);
+      else
+        words[w] &= ~GSBitmapWordMask (w, lo, hi);
+    }
+}
+
+CF_INLINE UInt64
+GSBitmapCombineWord (UInt64 word, UInt64 other, int op)
+{
+  switch (op)
+    {
+    case GSBitmapAnd:
+      return word & other;
+    case GSBitmapOr:
+      return word | other;
+    case GSBitmapXor:
+      return word ^ other;
+    default:
+      return word & ~other;
+    }
+}
+
+
+
+/* Containers */
+
+/* Returns the position of the first value in array that is not less than
+ * v.  v may be GSBITMAP_CHUNK_SIZE.
+ */
+static CFIndex
+GSBitmapArrayLowerBound (const UInt16 * array, CFIndex length, CFIndex v)
+{
+  CFIndex lo = 0;
+  CFIndex hi = length;
+
+  while (lo < hi)
+    {
+      CFIndex mid = (lo + hi) >> 1;
+
+      if (array[mid] < v)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* Returns the number of runs starting at or before v. */
+static CFIndex
+GSBitmapRunUpperBound (const GSBitmapRun * runs, CFIndex length, CFIndex v)
+{
+  CFIndex lo = 0;
+  CFIndex hi = length;
+
+  while (lo < hi)
+    {
+      CFIndex mid = (lo + hi) >> 1;
+
+      if (runs[mid].start <= v)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+static void
+GSBitmapContainerFree (CFAllocatorRef alloc, GSBitmapContainer * c)
+{
+  if (c->data)
+    CFAllocatorDeallocate (alloc, c->data);
+  c->data = NULL;
+  c->cardinality = 0;
+  c->length = 0;
+  c->capacity = 0;
+}
+
+/* Makes room for capacity values or runs, keeping the contents. */
+static void
+GSBitmapContainerReserve (CFAllocatorRef alloc, GSBitmapContainer * c,
+                          CFIndex capacity)
+{
+  CFIndex size;
+
+  if (capacity <= c->capacity)
+    return;
+  size = c->type == GSBitmapRunType ? sizeof(GSBitmapRun) : sizeof(UInt16);
+  if (c->data)
+    c->data = CFAllocatorReallocate (alloc, c->data, capacity * size, 0);
+  else
+    c->data = CFAllocatorAllocate (alloc, capacity * size, 0);
+  c->capacity = capacity;
+}
+
+static void
+GSBitmapContainerCopy (CFAllocatorRef alloc, GSBitmapContainer * dst,
+                       const GSBitmapContainer * src)
+{
+  CFIndex size;
+
+  *dst = *src;
+  if (src->type == GSBitmapBitmapType)
+    size = GSBITMAP_BITMAP_BYTES;
+  else if (src->type == GSBitmapRunType)
+    size = src->length * sizeof(GSBitmapRun);
+  else
+    size = src->length * sizeof(UInt16);
+  dst->capacity = src->length;
+  dst->data = size > 0 ? CFAllocatorAllocate (alloc, size, 0) : NULL;
+  if (dst->data)
+    memcpy (dst->data, src->data, size);
+}
+
+static Boolean
+GSBitmapContainerContains (const GSBitmapContainer * c, CFIndex v)
+{
+  if (c->type == GSBitmapArrayType)
+    {
+      const UInt16 *array = c->data;
+      CFIndex i = GSBitmapArrayLowerBound (array, c->length, v);
+
+      return i < c->length && array[i] == v;
+    }
+  else if (c->type == GSBitmapBitmapType)
+    {
+      const UInt64 *words = c->data;
+
+      return (words[v >> 6] >> (v & 63)) & 1;
+    }
+  else
+    {
+      const GSBitmapRun *runs = c->data;
+      CFIndex r = GSBitmapRunUpperBound (runs, c->length, v);
+
+      return r > 0 && runs[r - 1].last >= v;
+    }
+}
+
+static void
+GSBitmapContainerToWords (const GSBitmapContainer * c, UInt64 * words)
+{
+  CFIndex i;
+
+  if (c == NULL)
+    {
+      memset (words, 0, GSBITMAP_BITMAP_BYTES);
+    }
+  else if (c->type == GSBitmapBitmapType)
+    {
+      memcpy (words, c->data, GSBITMAP_BITMAP_BYTES);
+    }
+  else if (c->type == GSBitmapArrayType)
+    {
+      const UInt16 *array = c->data;
+
+      memset (words, 0, GSBITMAP_BITMAP_BYTES);
+      for (i = 0; i < c->length; ++i)
+        words[array[i] >> 6] |= 1ULL << (array[i] & 63);
+    }
+  else
+    {
+      const GSBitmapRun *runs = c->data;
+
+      memset (words, 0, GSBITMAP_BITMAP_BYTES);
+      for (i = 0; i < c->length; ++i)
+        GSBitmapWordsSetRange (words, runs[i].start, runs[i].last, true);
+    }
+}
+
+/* Replaces the contents of c with the bits in words, in whichever form is
+ * smallest.  The cardinality may be 0, in which case the caller should
+ * remove the container.
+ */
+static void
+GSBitmapContainerFromWords (CFAllocatorRef alloc, GSBitmapContainer * c,
+                            const UInt64 * words)
+{
+  CFIndex cardinality = 0;
+  CFIndex runCount = 0;
+  UInt64 carry = 0;
+  CFIndex runSize;
+  CFIndex arraySize;
+  CFIndex w;
+
+  /* A run starts at each set bit whose lower neighbour is clear. */
+  for (w = 0; w < GSBITMAP_WORDS; ++w)
+    {
+      cardinality += GSBITMAP_POPCOUNT (words[w]);
+      runCount += GSBITMAP_POPCOUNT (words[w] & ~((words[w] << 1) | carry));
+      carry = words[w] >> 63;
+    }
+
+  GSBitmapContainerFree (alloc, c);
+  c->cardinality = cardinality;
+  if (cardinality == 0)
+    {
+      c->type = GSBitmapArrayType;
+      return;
+    }
+
+  runSize = runCount * sizeof(GSBitmapRun);
+  arraySize = cardinality <= GSBITMAP_ARRAY_MAX
+    ? cardinality * sizeof(UInt16) : GSBITMAP_BITMAP_BYTES;
+  if (runSize < arraySize && runSize < GSBITMAP_BITMAP_BYTES)
+    {
+      GSBitmapRun *runs;
+      CFIndex v = 0;
+      CFIndex r = 0;
+
+      c->type = GSBitmapRunType;
+      GSBitmapContainerReserve (alloc, c, runCount);
+      runs = c->data;
+      while (r < runCount)
+        {
+          UInt64 word;
+
+          /* Find the next set bit, then the next clear bit. */
+          w = v >> 6;
+          word = words[w] & (~0ULL << (v & 63));
+          while (word == 0)
+            word = words[++w];
+          v = (w << 6) + GSBITMAP_CTZ (word);
+          runs[r].start = v;
+
+          w = v >> 6;
+          word = ~words[w] & (~0ULL << (v & 63));
+          while (word == 0 && w + 1 < GSBITMAP_WORDS)
+            word = ~words[++w];
+          v = word == 0 ? GSBITMAP_CHUNK_SIZE : (w << 6) + GSBITMAP_CTZ (word);
+          runs[r].last = v - 1;
+          ++r;
+        }
+      c->length = runCount;
+    }
+  else if (cardinality <= GSBITMAP_ARRAY_MAX)
+    {
+      UInt16 *array;
+      CFIndex i = 0;
+
+      c->type = GSBitmapArrayType;
+      GSBitmapContainerReserve (alloc, c, cardinality);
+      array = c->data;
+      for (w = 0; w < GSBITMAP_WORDS; ++w)
+        {
+          UInt64 word = words[w];
+
+          while (word)
+            {
+              array[i++] = (w << 6) + GSBITMAP_CTZ (word);
+              word &= word - 1;
+            }
+        }
+      c->length = cardinality;
+    }
+  else
+    {
+      c->type = GSBitmapBitmapType;
+      c->data = CFAllocatorAllocate (alloc, GSBITMAP_BITMAP_BYTES, 0);
+      memcpy (c->data, words, GSBITMAP_BITMAP_BYTES);
+    }
+}
+
+/* Stores a single run from lo to hi. */
+static void
+GSBitmapContainerSetRun (CFAllocatorRef alloc, GSBitmapContainer * c,
+                         CFIndex lo, CFIndex hi)
+{
+  GSBitmapRun *runs;
+
+  GSBitmapContainerFree (alloc, c);
+  c->type = GSBitmapRunType;
+  GSBitmapContainerReserve (alloc, c, 1);
+  runs = c->data;
+  runs[0].start = lo;
+  runs[0].last = hi;
+  c->length = 1;
+  c->cardinality = hi - lo + 1;
+}
+
+/* Converts a run list that has grown too long. */
+static void
+GSBitmapContainerCheckRuns (CFAllocatorRef alloc, GSBitmapContainer * c)
+{
+  CFIndex runSize = c->length * sizeof(GSBitmapRun);
+
+  if (runSize > GSBITMAP_BITMAP_BYTES
+      || (c->cardinality <= GSBITMAP_ARRAY_MAX
+          && runSize > c->cardinality * sizeof(UInt16)))
+    {
+      UInt64 words[GSBITMAP_WORDS];
+
+      GSBitmapContainerToWords (c, words);
+      GSBitmapContainerFromWords (alloc, c, words);
+    }
+}
+
+static void
+GSBitmapContainerAdd (CFAllocatorRef alloc, GSBitmapContainer * c, CFIndex v)
+{
+  if (c->type == GSBitmapArrayType)
+    {
+      UInt16 *array = c->data;
+      CFIndex i = GSBitmapArrayLowerBound (array, c->length, v);
+
+      if (i < c->length && array[i] == v)
+        return;
+      if (c->length == GSBITMAP_ARRAY_MAX)
+        {
+          UInt64 words[GSBITMAP_WORDS];
+
+          GSBitmapContainerToWords (c, words);
+          GSBitmapContainerFree (alloc, c);
+          words[v >> 6] |= 1ULL << (v & 63);
+          c->type = GSBitmapBitmapType;
+          c->data = CFAllocatorAllocate (alloc, GSBITMAP_BITMAP_BYTES, 0);
+          memcpy (c->data, words, GSBITMAP_BITMAP_BYTES);
+          c->cardinality = GSBITMAP_ARRAY_MAX + 1;
+          return;
+        }
+      if (c->length == c->capacity)
+        GSBitmapContainerReserve (alloc, c, c->capacity < 4 ? 4
+                                  : c->capacity * 2 > GSBITMAP_ARRAY_MAX
+                                  ? GSBITMAP_ARRAY_MAX : c->capacity * 2);
+      array = c->data;
+      memmove (array + i + 1, array + i, (c->length - i) * sizeof(UInt16));
+      array[i] = v;
+      c->length += 1;
+      c->cardinality += 1;
+    }
+  else if (c->type == GSBitmapBitmapType)
+    {
+      UInt64 *words = c->data;
+      UInt64 bit = 1ULL << (v & 63);
+
+      if ((words[v >> 6] & bit) == 0)
+        {
+          words[v >> 6] |= bit;
+          c->cardinality += 1;
+        }
+    }
+  else
+    {
+      GSBitmapRun *runs = c->data;
+      CFIndex r = GSBitmapRunUpperBound (runs, c->length, v);
+      Boolean joinsPrev = r > 0 && runs[r - 1].last + 1 >= v;
+      Boolean joinsNext = r < c->length && runs[r].start == v + 1;
+
+      if (r > 0 && runs[r - 1].last >= v)
+        return;
+      if (joinsPrev && joinsNext)
+        {
+          runs[r - 1].last = runs[r].last;
+          memmove (runs + r, runs + r + 1,
+                   (c->length - r - 1) * sizeof(GSBitmapRun));
+          c->length -= 1;
+        }
+      else if (joinsPrev)
+        {
+          runs[r - 1].last = v;
+        }
+      else if (joinsNext)
+        {
+          runs[r].start = v;
+        }
+      else
+        {
+          if (c->length == c->capacity)
+            GSBitmapContainerReserve (alloc, c, c->capacity * 2);
+          runs = c->data;
+          memmove (runs + r + 1, runs + r,
+                   (c->length - r) * sizeof(GSBitmapRun));
+          runs[r].start = v;
+          runs[r].last = v;
+          c->length += 1;
+        }
+      c->cardinality += 1;
+      GSBitmapContainerCheckRuns (alloc, c);
+    }
+}
+
+static void
+GSBitmapContainerRemove (CFAllocatorRef alloc, GSBitmapContainer * c,
+                         CFIndex v)
+{
+  if (c->type == GSBitmapArrayType)
+    {
+      UInt16 *array = c->data;
+      CFIndex i = GSBitmapArrayLowerBound (array, c->length, v);
+
+      if (i == c->length || array[i] != v)
+        return;
+      memmove (array + i, array + i + 1,
+               (c->length - i - 1) * sizeof(UInt16));
+      c->length -= 1;
+      c->cardinality -= 1;
+    }
+  else if (c->type == GSBitmapBitmapType)
+    {
+      UInt64 *words = c->data;
+      UInt64 bit = 1ULL << (v & 63);
+
+      if (words[v >> 6] & bit)
+        {
+          words[v >> 6] &= ~bit;
+          c->cardinality -= 1;
+          if (c->cardinality <= GSBITMAP_ARRAY_MAX)
+            {
+              UInt64 copy[GSBITMAP_WORDS];
+
+              memcpy (copy, words, GSBITMAP_BITMAP_BYTES);
+              GSBitmapContainerFromWords (alloc, c, copy);
+            }
+        }
+    }
+  else
+    {
+      GSBitmapRun *runs = c->data;
+      CFIndex r = GSBitmapRunUpperBound (runs, c->length, v) - 1;
+
+      if (r < 0 || runs[r].last < v)
+        return;
+      if (runs[r].start == v && runs[r].last == v)
+        {
+          memmove (runs + r, runs + r + 1,
+                   (c->length - r - 1) * sizeof(GSBitmapRun));
+          c->length -= 1;
+        }
+      else if (runs[r].start == v)
+        {
+          runs[r].start = v + 1;
+        }
+      else if (runs[r].last == v)
+        {
+          runs[r].last = v - 1;
+        }
+      else
+        {
+          if (c->length == c->capacity)
+            GSBitmapContainerReserve (alloc, c, c->capacity * 2);
+          runs = c->data;
+          memmove (runs + r + 1, runs + r,
+                   (c->length - r) * sizeof(GSBitmapRun));
+          runs[r].last = v - 1;
+          runs[r + 1].start = v + 1;
+          c->length += 1;
+        }
+      c->cardinality -= 1;
+      GSBitmapContainerCheckRuns (alloc, c);
+    }
+}
+
+/* Returns the number of bits set from lo to hi, inclusive. */
+static CFIndex
+GSBitmapContainerCount (const GSBitmapContainer * c, CFIndex lo, CFIndex hi)
+{
+  CFIndex count = 0;
+
+  if (lo == 0 && hi == GSBITMAP_CHUNK_MASK)
+    return c->cardinality;
+  if (c->type == GSBitmapArrayType)
+    {
+      const UInt16 *array = c->data;
+
+      count = GSBitmapArrayLowerBound (array, c->length, hi + 1)
+        - GSBitmapArrayLowerBound (array, c->length, lo);
+    }
+  else if (c->type == GSBitmapBitmapType)
+    {
+      const UInt64 *words = c->data;
+      CFIndex w;
+
+      for (w = lo >> 6; w <= hi >> 6; ++w)
+        count += GSBITMAP_POPCOUNT (words[w] & GSBitmapWordMask (w, lo, hi));
+    }
+  else
+    {
+      const GSBitmapRun *runs = c->data;
+      CFIndex r = GSBitmapRunUpperBound (runs, c->length, lo);
+
+      if (r > 0)
+        --r;
+      for (; r < c->length && runs[r].start <= hi; ++r)
+        {
+          CFIndex start = runs[r].start < lo ? lo : runs[r].start;
+          CFIndex last = runs[r].last > hi ? hi : runs[r].last;
+
+          if (last >= start)
+            count += last - start + 1;
+        }
+    }
+  return count;
+}
+
+/* Returns the first value from v on whose bit is value, or -1. */
+static CFIndex
+GSBitmapContainerNext (const GSBitmapContainer * c, CFIndex v, Boolean value)
+{
+  if (c->type == GSBitmapArrayType)
+    {
+      const UInt16 *array = c->data;
+      CFIndex i = GSBitmapArrayLowerBound (array, c->length, v);
+
+      if (value)
+        return i < c->length ? array[i] : -1;
+      while (i < c->length && array[i] == v)
+        {
+          ++i;
+          ++v;
+        }
+      return v < GSBITMAP_CHUNK_SIZE ? v : -1;
+    }
+  else if (c->type == GSBitmapBitmapType)
+    {
+      const UInt64 *words = c->data;
+      UInt64 flip = value ? 0 : ~0ULL;
+      CFIndex w = v >> 6;
+      UInt64 word = (words[w] ^ flip) & (~0ULL << (v & 63));
+
+      while (word == 0)
+        {
+          if (++w == GSBITMAP_WORDS)
+            return -1;
+          word = words[w] ^ flip;
+        }
+      return (w << 6) + GSBITMAP_CTZ (word);
+    }
+  else
+    {
+      const GSBitmapRun *runs = c->data;
+      CFIndex r = GSBitmapRunUpperBound (runs, c->length, v);
+      Boolean inRun = r > 0 && runs[r - 1].last >= v;
+
+      if (value)
+        return inRun ? v : (r < c->length ? runs[r].start : -1);
+      if (!inRun)
+        return v;
+      v = runs[r - 1].last + 1;
+      return v < GSBITMAP_CHUNK_SIZE ? v : -1;
+    }
+}
+
+/* Returns the last value up to v whose bit is value, or -1. */
+static CFIndex
+GSBitmapContainerPrevious (const GSBitmapContainer * c, CFIndex v,
+                           Boolean value)
+{
+  if (c->type == GSBitmapArrayType)
+    {
+      const UInt16 *array = c->data;
+      CFIndex i = GSBitmapArrayLowerBound (array, c->length, v + 1);
+
+      if (value)
+        return i > 0 ? array[i - 1] : -1;
+      while (i > 0 && array[i - 1] == v)
+        {
+          --i;
+          --v;
+        }
+      return v;
+    }
+  else if (c->type == GSBitmapBitmapType)
+    {
+      const UInt64 *words = c->data;
+      UInt64 flip = value ? 0 : ~0ULL;
+      CFIndex w = v >> 6;
+      UInt64 word = (words[w] ^ flip) & (~0ULL >> (63 - (v & 63)));
+
+      while (word == 0)
+        {
+          if (w-- == 0)
+            return -1;
+          word = words[w] ^ flip;
+        }
+      return (w << 6) + 63 - GSBITMAP_CLZ (word);
+    }
+  else
+    {
+      const GSBitmapRun *runs = c->data;
+      CFIndex r = GSBitmapRunUpperBound (runs, c->length, v);
+      Boolean inRun = r > 0 && runs[r - 1].last >= v;
+
+      if (value)
+        return r == 0 ? -1 : (inRun ? v : runs[r - 1].last);
+      return inRun ? runs[r - 1].start - 1 : v;
+    }
+}
+
+/* Sets c to the combination of itself and other, both containers of a chunk
+ * that is wholly in range.
+ */
+static void
+GSBitmapContainerCombine (CFAllocatorRef alloc, GSBitmapContainer * c,
+                          const GSBitmapContainer * other, int op)
+{
+  UInt64 words[GSBITMAP_WORDS];
+  const UInt64 *otherWords;
+  UInt64 otherCopy[GSBITMAP_WORDS];
+  CFIndex w;
+
+  if (c->type == GSBitmapArrayType && other->type == GSBitmapArrayType)
+    {
+      /* Merge the two sorted arrays. */
+      const UInt16 *a = c->data;
+      const UInt16 *b = other->data;
+      UInt16 merged[2 * GSBITMAP_ARRAY_MAX];
+      CFIndex i = 0;
+      CFIndex j = 0;
+      CFIndex n = 0;
+
+      while (i < c->length && j < other->length)
+        {
+          if (a[i] < b[j])
+            {
+              if (op != GSBitmapAnd)
+                merged[n++] = a[i];
+              ++i;
+            }
+          else if (a[i] > b[j])
+            {
+              if (op == GSBitmapOr || op == GSBitmapXor)
+                merged[n++] = b[j];
+              ++j;
+            }
+          else
+            {
+              if (op == GSBitmapAnd || op == GSBitmapOr)
+                merged[n++] = a[i];
+              ++i;
+              ++j;
+            }
+        }
+      if (op != GSBitmapAnd)
+        while (i < c->length)
+          merged[n++] = a[i++];
+      if (op == GSBitmapOr || op == GSBitmapXor)
+        while (j < other->length)
+          merged[n++] = b[j++];
+
+      if (n <= GSBITMAP_ARRAY_MAX)
+        {
+          GSBitmapContainerReserve (alloc, c, n);
+          if (n > 0)
+            memcpy (c->data, merged, n * sizeof(UInt16));
+          c->length = n;
+          c->cardinality = n;
+          return;
+        }
+      memset (words, 0, GSBITMAP_BITMAP_BYTES);
+      for (i = 0; i < n; ++i)
+        words[merged[i] >> 6] |= 1ULL << (merged[i] & 63);
+      GSBitmapContainerFromWords (alloc, c, words);
+      return;
+    }
+
+  if (c->type == GSBitmapArrayType && other->type == GSBitmapBitmapType
+      && (op == GSBitmapAnd || op == GSBitmapAndNot))
+    {
+      /* Keep the values whose bit in other is as wanted. */
+      UInt16 *a = c->data;
+      const UInt64 *b = other->data;
+      UInt64 keep = op == GSBitmapAnd ? 1 : 0;
+      CFIndex i;
+      CFIndex n = 0;
+
+      for (i = 0; i < c->length; ++i)
+        {
+          a[n] = a[i];
+          n += ((b[a[i] >> 6] >> (a[i] & 63)) & 1) == keep;
+        }
+      c->length = n;
+      c->cardinality = n;
+      return;
+    }
+
+  if (c->type == GSBitmapBitmapType && other->type == GSBitmapArrayType
+      && op == GSBitmapAnd)
+    {
+      /* The result is the values of other that are in c. */
+      const UInt64 *a = c->data;
+      const UInt16 *b = other->data;
+      UInt16 kept[GSBITMAP_ARRAY_MAX];
+      CFIndex i;
+      CFIndex n = 0;
+
+      for (i = 0; i < other->length; ++i)
+        {
+          kept[n] = b[i];
+          n += (a[b[i] >> 6] >> (b[i] & 63)) & 1;
+        }
+      GSBitmapContainerFree (alloc, c);
+      c->type = GSBitmapArrayType;
+      GSBitmapContainerReserve (alloc, c, n);
+      if (n > 0)
+        memcpy (c->data, kept, n * sizeof(UInt16));
+      c->length = n;
+      c->cardinality = n;
+      return;
+    }
+
+  /* Anything else is done a word at a time. */
+  GSBitmapContainerToWords (c, words);
+  if (other->type == GSBitmapBitmapType)
+    {
+      otherWords = other->data;
+    }
+  else
+    {
+      GSBitmapContainerToWords (other, otherCopy);
+      otherWords = otherCopy;
+    }
+  for (w = 0; w < GSBITMAP_WORDS; ++w)
+    words[w] = GSBitmapCombineWord (words[w], otherWords[w], op);
+  GSBitmapContainerFromWords (alloc, c, words);
+}
+
+
+
+/* The list of containers */
+
+/* Returns the position of the first container whose key is not less than
+ * key.
+ */
+static CFIndex
+GSBitmapLowerBound (const GSBitmap * bitmap, CFIndex key)
+{
+  CFIndex lo = 0;
+  CFIndex hi = bitmap->count;
+
+  while (lo < hi)
+    {
+      CFIndex mid = (lo + hi) >> 1;
+
+      if (bitmap->keys[mid] < key)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+static GSBitmapContainer *
+GSBitmapFind (const GSBitmap * bitmap, CFIndex key)
+{
+  CFIndex i = GSBitmapLowerBound (bitmap, key);
+
+  if (i < bitmap->count && bitmap->keys[i] == key)
+    return &bitmap->containers[i];
+  return NULL;
+}
+
+static void
+GSBitmapReserve (CFAllocatorRef alloc, GSBitmap * bitmap, CFIndex capacity)
+{
+  if (capacity <= bitmap->capacity)
+    return;
+  if (bitmap->containers)
+    {
+      bitmap->keys = CFAllocatorReallocate (alloc, bitmap->keys,
+                                            capacity * sizeof(UInt32), 0);
+      bitmap->containers =
+        CFAllocatorReallocate (alloc, bitmap->containers,
+                               capacity * sizeof(GSBitmapContainer), 0);
+    }
+  else
+    {
+      bitmap->keys = CFAllocatorAllocate (alloc, capacity * sizeof(UInt32), 0);
+      bitmap->containers =
+        CFAllocatorAllocate (alloc, capacity * sizeof(GSBitmapContainer), 0);
+    }
+  bitmap->capacity = capacity;
+}
+
+/* Returns the container for key, inserting an empty one if needed. */
+static GSBitmapContainer *
+GSBitmapFindOrInsert (CFAllocatorRef alloc, GSBitmap * bitmap, CFIndex key)
+{
+  CFIndex i = GSBitmapLowerBound (bitmap, key);
+  GSBitmapContainer *c;
+
+  if (i < bitmap->count && bitmap->keys[i] == key)
+    return &bitmap->containers[i];
+  if (bitmap->count == bitmap->capacity)
+    GSBitmapReserve (alloc, bitmap,
+                     bitmap->capacity < 4 ? 4 : bitmap->capacity * 2);
+  c = &bitmap->containers[i];
+  memmove (c + 1, c, (bitmap->count - i) * sizeof(GSBitmapContainer));
+  memmove (bitmap->keys + i + 1, bitmap->keys + i,
+           (bitmap->count - i) * sizeof(UInt32));
+  bitmap->count += 1;
+  memset (c, 0, sizeof(GSBitmapContainer));
+  c->type = GSBitmapArrayType;
+  bitmap->keys[i] = key;
+  return c;
+}
+
+static void
+GSBitmapRemoveContainer (CFAllocatorRef alloc, GSBitmap * bitmap,
+                         GSBitmapContainer * c)
+{
+  CFIndex i = c - bitmap->containers;
+
+  GSBitmapContainerFree (alloc, c);
+  memmove (c, c + 1, (bitmap->count - i - 1) * sizeof(GSBitmapContainer));
+  memmove (bitmap->keys + i, bitmap->keys + i + 1,
+           (bitmap->count - i - 1) * sizeof(UInt32));
+  bitmap->count -= 1;
+}
+
+void
+GSBitmapFree (CFAllocatorRef alloc, GSBitmap * bitmap)
+{
+  CFIndex i;
+
+  for (i = 0; i < bitmap->count; ++i)
+    GSBitmapContainerFree (alloc, &bitmap->containers[i]);
+  if (bitmap->containers)
+    {
+      CFAllocatorDeallocate (alloc, bitmap->keys);
+      CFAllocatorDeallocate (alloc, bitmap->containers);
+    }
+  bitmap->keys = NULL;
+  bitmap->containers = NULL;
+  bitmap->count = 0;
+  bitmap->capacity = 0;
+}
+
+void
+GSBitmapCopy (CFAllocatorRef alloc, GSBitmap * dst, const GSBitmap * src)
+{
+  CFIndex i;
+
+  dst->count = 0;
+  dst->capacity = 0;
+  dst->keys = NULL;
+  dst->containers = NULL;
+  if (src->count == 0)
+    return;
+  GSBitmapReserve (alloc, dst, src->count);
+  memcpy (dst->keys, src->keys, src->count * sizeof(UInt32));
+  for (i = 0; i < src->count; ++i)
+    GSBitmapContainerCopy (alloc, &dst->containers[i], &src->containers[i]);
+  dst->count = src->count;
+}
+
+Boolean
+GSBitmapEqual (const GSBitmap * bitmap1, const GSBitmap * bitmap2)
+{
+  CFIndex i;
+
+  if (bitmap1->count != bitmap2->count)
+    return false;
+  if (bitmap1->count > 0 && memcmp (bitmap1->keys, bitmap2->keys,
+                                    bitmap1->count * sizeof(UInt32)) != 0)
+    return false;
+  for (i = 0; i < bitmap1->count; ++i)
+    {
+      const GSBitmapContainer *c1 = &bitmap1->containers[i];
+      const GSBitmapContainer *c2 = &bitmap2->containers[i];
+      UInt64 words1[GSBITMAP_WORDS];
+      UInt64 words2[GSBITMAP_WORDS];
+
+      if (c1->cardinality != c2->cardinality)
+        return false;
+      if (c1->type == GSBitmapArrayType && c2->type == GSBitmapArrayType)
+        {
+          if (memcmp (c1->data, c2->data, c1->length * sizeof(UInt16)) != 0)
+            return false;
+          continue;
+        }
+      GSBitmapContainerToWords (c1, words1);
+      GSBitmapContainerToWords (c2, words2);
+      if (memcmp (words1, words2, GSBITMAP_BITMAP_BYTES) != 0)
+        return false;
+    }
+  return true;
+}
+
+Boolean
+GSBitmapContainsIndex (const GSBitmap * bitmap, CFIndex idx)
+{
+  GSBitmapContainer *c = GSBitmapFind (bitmap, idx >> GSBITMAP_CHUNK_BITS);
+
+  return c ? GSBitmapContainerContains (c, idx & GSBITMAP_CHUNK_MASK) : false;
+}
+
+void
+GSBitmapAddIndex (CFAllocatorRef alloc, GSBitmap * bitmap, CFIndex idx)
+{
+  GSBitmapContainer *c;
+
+  c = GSBitmapFindOrInsert (alloc, bitmap, idx >> GSBITMAP_CHUNK_BITS);
+  GSBitmapContainerAdd (alloc, c, idx & GSBITMAP_CHUNK_MASK);
+}
+
+void
+GSBitmapRemoveIndex (CFAllocatorRef alloc, GSBitmap * bitmap, CFIndex idx)
+{
+  GSBitmapContainer *c = GSBitmapFind (bitmap, idx >> GSBITMAP_CHUNK_BITS);
+
+  if (c)
+    {
+      GSBitmapContainerRemove (alloc, c, idx & GSBITMAP_CHUNK_MASK);
+      if (c->cardinality == 0)
+        GSBitmapRemoveContainer (alloc, bitmap, c);
+    }
+}
+
+void
+GSBitmapSetRange (CFAllocatorRef alloc, GSBitmap * bitmap, CFRange range,
+                  Boolean value)
+{
+  CFIndex idx = range.location;
+  CFIndex end = range.location + range.length;
+
+  while (idx < end)
+    {
+      CFIndex key = idx >> GSBITMAP_CHUNK_BITS;
+      CFIndex lo = idx & GSBITMAP_CHUNK_MASK;
+      CFIndex hi = end - (key << GSBITMAP_CHUNK_BITS) > GSBITMAP_CHUNK_MASK
+        ? GSBITMAP_CHUNK_MASK : end - (key << GSBITMAP_CHUNK_BITS) - 1;
+      GSBitmapContainer *c;
+
+      idx = (key + 1) << GSBITMAP_CHUNK_BITS;
+      if (value)
+        {
+          c = GSBitmapFindOrInsert (alloc, bitmap, key);
+          if (c->cardinality == 0
+              || (lo == 0 && hi == GSBITMAP_CHUNK_MASK))
+            {
+              GSBitmapContainerSetRun (alloc, c, lo, hi);
+              continue;
+            }
+        }
+      else
+        {
+          c = GSBitmapFind (bitmap, key);
+          if (c == NULL)
+            continue;
+          if (lo == 0 && hi == GSBITMAP_CHUNK_MASK)
+            {
+              GSBitmapRemoveContainer (alloc, bitmap, c);
+              continue;
+            }
+        }
+      {
+        UInt64 words[GSBITMAP_WORDS];
+
+        GSBitmapContainerToWords (c, words);
+        GSBitmapWordsSetRange (words, lo, hi, value);
+        GSBitmapContainerFromWords (alloc, c, words);
+        if (c->cardinality == 0)
+          GSBitmapRemoveContainer (alloc, bitmap, c);
+      }
+    }
+}
+
+void
+GSBitmapFlipRange (CFAllocatorRef alloc, GSBitmap * bitmap, CFRange range)
+{
+  CFIndex idx = range.location;
+  CFIndex end = range.location + range.length;
+
+  while (idx < end)
+    {
+      CFIndex key = idx >> GSBITMAP_CHUNK_BITS;
+      CFIndex lo = idx & GSBITMAP_CHUNK_MASK;
+      CFIndex hi = end - (key << GSBITMAP_CHUNK_BITS) > GSBITMAP_CHUNK_MASK
+        ? GSBITMAP_CHUNK_MASK : end - (key << GSBITMAP_CHUNK_BITS) - 1;
+      GSBitmapContainer *c;
+      UInt64 words[GSBITMAP_WORDS];
+      CFIndex w;
+
+      idx = (key + 1) << GSBITMAP_CHUNK_BITS;
+      c = GSBitmapFindOrInsert (alloc, bitmap, key);
+      if (c->cardinality == 0)
+        {
+          GSBitmapContainerSetRun (alloc, c, lo, hi);
+          continue;
+        }
+      GSBitmapContainerToWords (c, words);
+      for (w = lo >> 6; w <= hi >> 6; ++w)
+        words[w] ^= GSBitmapWordMask (w, lo, hi);
+      GSBitmapContainerFromWords (alloc, c, words);
+      if (c->cardinality == 0)
+        GSBitmapRemoveContainer (alloc, bitmap, c);
+    }
+}
+
+CFIndex
+GSBitmapCountRange (const GSBitmap * bitmap, CFRange range)
+{
+  CFIndex end = range.location + range.length;
+  CFIndex first = range.location >> GSBITMAP_CHUNK_BITS;
+  CFIndex last;
+  CFIndex count = 0;
+  CFIndex i;
+
+  if (range.length <= 0)
+    return 0;
+  last = (end - 1) >> GSBITMAP_CHUNK_BITS;
+  for (i = GSBitmapLowerBound (bitmap, first);
+       i < bitmap->count && bitmap->keys[i] <= last; ++i)
+    {
+      CFIndex key = bitmap->keys[i];
+      CFIndex lo = key == first ? range.location & GSBITMAP_CHUNK_MASK : 0;
+      CFIndex hi = key == last ? (end - 1) & GSBITMAP_CHUNK_MASK
+        : GSBITMAP_CHUNK_MASK;
+
+      count += GSBitmapContainerCount (&bitmap->containers[i], lo, hi);
+    }
+  return count;
+}
+
+CFIndex
+GSBitmapFirstIndex (const GSBitmap * bitmap, CFRange range, Boolean value)
+{
+  CFIndex idx = range.location;
+  CFIndex end = range.location + range.length;
+  CFIndex i;
+
+  if (range.length <= 0)
+    return kCFNotFound;
+  i = GSBitmapLowerBound (bitmap, idx >> GSBITMAP_CHUNK_BITS);
+  while (idx < end)
+    {
+      CFIndex key = idx >> GSBITMAP_CHUNK_BITS;
+      CFIndex v;
+
+      if (i == bitmap->count)
+        return value ? kCFNotFound : idx;
+      if (bitmap->keys[i] != key)
+        {
+          /* A missing chunk has no bits set. */
+          if (!value)
+            return idx;
+          idx = (CFIndex) bitmap->keys[i] << GSBITMAP_CHUNK_BITS;
+          continue;
+        }
+      v = GSBitmapContainerNext (&bitmap->containers[i],
+                                 idx & GSBITMAP_CHUNK_MASK, value);
+      if (v >= 0)
+        {
+          idx = (key << GSBITMAP_CHUNK_BITS) + v;
+          return idx < end ? idx : kCFNotFound;
+        }
+      idx = (key + 1) << GSBITMAP_CHUNK_BITS;
+      ++i;
+    }
+  return kCFNotFound;
+}
+
+CFIndex
+GSBitmapLastIndex (const GSBitmap * bitmap, CFRange range, Boolean value)
+{
+  CFIndex idx = range.location + range.length - 1;
+  CFIndex i;
+
+  if (range.length <= 0)
+    return kCFNotFound;
+  i = GSBitmapLowerBound (bitmap, (idx >> GSBITMAP_CHUNK_BITS) + 1) - 1;
+  while (idx >= range.location)
+    {
+      CFIndex key = idx >> GSBITMAP_CHUNK_BITS;
+      CFIndex v;
+
+      if (i < 0)
+        return value ? kCFNotFound : idx;
+      if (bitmap->keys[i] != key)
+        {
+          if (!value)
+            return idx;
+          idx = ((CFIndex) bitmap->keys[i] << GSBITMAP_CHUNK_BITS)
+            + GSBITMAP_CHUNK_MASK;
+          continue;
+        }
+      v = GSBitmapContainerPrevious (&bitmap->containers[i],
+                                     idx & GSBITMAP_CHUNK_MASK, value);
+      if (v >= 0)
+        {
+          idx = (key << GSBITMAP_CHUNK_BITS) + v;
+          return idx >= range.location ? idx : kCFNotFound;
+        }
+      idx = (key << GSBITMAP_CHUNK_BITS) - 1;
+      --i;
+    }
+  return kCFNotFound;
+}
+
+void
+GSBitmapCombine (CFAllocatorRef alloc, GSBitmap * bitmap, CFRange range,
+                 const GSBitmap * other, int op)
+{
+  GSBitmap result = { 0, 0, NULL, NULL };
+  CFIndex end = range.location + range.length;
+  CFIndex first;
+  CFIndex last;
+  CFIndex i = 0;
+  CFIndex j;
+
+  if (range.length <= 0)
+    return;
+  if (other == bitmap)
+    {
+      if (op == GSBitmapXor || op == GSBitmapAndNot)
+        GSBitmapSetRange (alloc, bitmap, range, false);
+      return;
+    }
+
+  /* Merge the two lists of containers into a new list. */
+  first = range.location >> GSBITMAP_CHUNK_BITS;
+  last = (end - 1) >> GSBITMAP_CHUNK_BITS;
+  GSBitmapReserve (alloc, &result, bitmap->count + other->count + 1);
+  j = GSBitmapLowerBound (other, first);
+  while (i < bitmap->count || (j < other->count && other->keys[j] <= last))
+    {
+      GSBitmapContainer *a = NULL;
+      const GSBitmapContainer *b = NULL;
+      CFIndex key;
+      CFIndex lo;
+      CFIndex hi;
+      CFIndex n = result.count;
+
+      if (i < bitmap->count)
+        a = &bitmap->containers[i];
+      if (j < other->count && other->keys[j] <= last)
+        b = &other->containers[j];
+      if (a && b && bitmap->keys[i] != other->keys[j])
+        {
+          if (bitmap->keys[i] < other->keys[j])
+            b = NULL;
+          else
+            a = NULL;
+        }
+      key = a ? bitmap->keys[i++] : other->keys[j];
+      if (b)
+        ++j;
+
+      result.keys[n] = key;
+      if (key < first || key > last)
+        {
+          result.containers[result.count++] = *a;
+          continue;
+        }
+      lo = key == first ? range.location & GSBITMAP_CHUNK_MASK : 0;
+      hi = key == last ? (end - 1) & GSBITMAP_CHUNK_MASK : GSBITMAP_CHUNK_MASK;
+
+      if (b == NULL)
+        {
+          /* Only AND changes the bits of a. */
+          if (op != GSBitmapAnd)
+            {
+              result.containers[result.count++] = *a;
+              continue;
+            }
+          if (lo == 0 && hi == GSBITMAP_CHUNK_MASK)
+            {
+              GSBitmapContainerFree (alloc, a);
+              continue;
+            }
+        }
+      else if (a == NULL)
+        {
+          if (op == GSBitmapAnd || op == GSBitmapAndNot)
+            continue;
+          if (lo == 0 && hi == GSBITMAP_CHUNK_MASK)
+            {
+              GSBitmapContainerCopy (alloc, &result.containers[n], b);
+              result.count++;
+              continue;
+            }
+        }
+      else if (lo == 0 && hi == GSBITMAP_CHUNK_MASK)
+        {
+          GSBitmapContainerCombine (alloc, a, b, op);
+          if (a->cardinality > 0)
+            result.containers[result.count++] = *a;
+          else
+            GSBitmapContainerFree (alloc, a);
+          continue;
+        }
+
+      /* Only part of the chunk is in range. */
+      {
+        UInt64 words[GSBITMAP_WORDS];
+        UInt64 otherWords[GSBITMAP_WORDS];
+        GSBitmapContainer c;
+        CFIndex w;
+
+        GSBitmapContainerToWords (a, words);
+        GSBitmapContainerToWords (b, otherWords);
+        for (w = lo >> 6; w <= hi >> 6; ++w)
+          {
+            UInt64 mask = GSBitmapWordMask (w, lo, hi);
+
+            words[w] = (words[w] & ~mask)
+              | (GSBitmapCombineWord (words[w], otherWords[w], op) & mask);
+          }
+        if (a)
+          c = *a;
+        else
+          memset (&c, 0, sizeof(c));
+        GSBitmapContainerFromWords (alloc, &c, words);
+        if (c.cardinality > 0)
+          result.containers[result.count++] = c;
+        else
+          GSBitmapContainerFree (alloc, &c);
+      }
+    }
+
+  /* The containers now belong to result. */
+  bitmap->count = 0;
+  GSBitmapFree (alloc, bitmap);
+  *bitmap = result;
+}
@@ -0,0 +1,112 @@
+/* GSBitmap.h
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of GNUstep CoreBase library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the
+   Free Software Foundation, 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __GSBITMAP_H__
+#define __GSBITMAP_H__
+
+#include "config.h"
+
+#include "CoreFoundation/CFBase.h"
+#include "GSPrivate.h"
+
+/* A compressed set of bit indices.  The indices are split into chunks of
+ * 2^16 and each chunk with at least one bit set has a container holding the
+ * low 16 bits of its indices.  A container is a sorted array of values, a
+ * bitmap or a sorted list of runs, whichever is smallest.  The chunk
+ * numbers, or keys, are kept sorted in an array of their own so that
+ * finding a chunk touches little memory.
+ */
+typedef struct GSBitmapContainer GSBitmapContainer;
+struct GSBitmapContainer
+{
+  UInt16 type;
+  UInt32 cardinality;           /* Number of bits set */
+  UInt32 length;                /* Values in an array, runs in a run list */
+  UInt32 capacity;              /* Allocated values or runs */
+  void *data;
+};
+
+typedef struct GSBitmap GSBitmap;
+struct GSBitmap
+{
+  CFIndex count;
+  CFIndex capacity;
+  UInt32 *keys;                 /* Index >> 16 */
+  GSBitmapContainer *containers;
+};
+
+enum
+{
+  GSBitmapAnd,
+  GSBitmapOr,
+  GSBitmapXor,
+  GSBitmapAndNot
+};
+
+GS_PRIVATE void
+GSBitmapFree (CFAllocatorRef alloc, GSBitmap * bitmap);
+
+GS_PRIVATE void
+GSBitmapCopy (CFAllocatorRef alloc, GSBitmap * dst, const GSBitmap * src);
+
+GS_PRIVATE Boolean
+GSBitmapEqual (const GSBitmap * bitmap1, const GSBitmap * bitmap2);
+
+GS_PRIVATE Boolean
+GSBitmapContainsIndex (const GSBitmap * bitmap, CFIndex idx);
+
+GS_PRIVATE void
+GSBitmapAddIndex (CFAllocatorRef alloc, GSBitmap * bitmap, CFIndex idx);
+
+GS_PRIVATE void
+GSBitmapRemoveIndex (CFAllocatorRef alloc, GSBitmap * bitmap, CFIndex idx);
+
+GS_PRIVATE void
+GSBitmapSetRange (CFAllocatorRef alloc, GSBitmap * bitmap, CFRange range,
+                  Boolean value);
+
+GS_PRIVATE void
+GSBitmapFlipRange (CFAllocatorRef alloc, GSBitmap * bitmap, CFRange range);
+
+/* Returns the number of bits set in range. */
+GS_PRIVATE CFIndex
+GSBitmapCountRange (const GSBitmap * bitmap, CFRange range);
+
+/* Return the first or last index in range whose bit is value, or
+ * kCFNotFound.
+ */
+GS_PRIVATE CFIndex
+GSBitmapFirstIndex (const GSBitmap * bitmap, CFRange range, Boolean value);
+
+GS_PRIVATE CFIndex
+GSBitmapLastIndex (const GSBitmap * bitmap, CFRange range, Boolean value);
+
+/* Combines the bits in range with those of other using one of the
+ * operations above.  Chunks wholly in range are combined container by
+ * container.
+ */
+GS_PRIVATE void
+GSBitmapCombine (CFAllocatorRef alloc, GSBitmap * bitmap, CFRange range,
+                 const GSBitmap * other, int op);
+
+#endif /* __GSBITMAP_H__ */
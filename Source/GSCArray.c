@@ -25,6 +25,9 @@
 */
 
 #include "GSCArray.h"
+#include "GSThreadPool.h"
+
+#include <string.h>
 
 #define GS_EXCHANGE_VALUES(_v1, _v2) do \
 { \
@@ -34,35 +37,491 @@
   _v2 = _tmp_; \
 } while (0)
 
+/* GSCArrayQuickSort() is a pattern-defeating quicksort (pdqsort), after
+ * Orson Peters' algorithm.  It chooses the pivot as the median of three
+ * values, or of three medians of three for large ranges, and partitions
+ * without branching on the comparison results (the block partitioning of
+ * Edelkamp and Weiss).  Partitions that turn out to be badly unbalanced
+ * make it shuffle a few values to break up patterns, and if that keeps
+ * happening it finishes with a heapsort, so the worst case is
+ * O(n log n).  Ranges with many equal values and ranges that are already
+ * (nearly) sorted take linear time.
+ */
+
+#define GSCARRAY_INSERTION_SORT_THRESHOLD 24
+#define GSCARRAY_NINTHER_THRESHOLD 128
+#define GSCARRAY_PARTIAL_INSERTION_SORT_LIMIT 8
+#define GSCARRAY_BLOCK_SIZE 64
+
+#define GS_LESS(_v1, _v2) \
+  ((*comparator) ((_v1), (_v2), context) == kCFCompareLessThan)
+
+CF_INLINE void
+GSCArraySort2 (const void **a, const void **b,
+               CFComparatorFunction comparator, void *context)
+{
+  if (GS_LESS (*b, *a))
+    GS_EXCHANGE_VALUES (*a, *b);
+}
+
+CF_INLINE void
+GSCArraySort3 (const void **a, const void **b, const void **c,
+               CFComparatorFunction comparator, void *context)
+{
+  GSCArraySort2 (a, b, comparator, context);
+  GSCArraySort2 (b, c, comparator, context);
+  GSCArraySort2 (a, b, comparator, context);
+}
+
+/* Like GSCArrayInsertionSort(), but assumes that array[-1] is not greater
+   than any value in the range, so the scan needs no bounds check. */
+static void
+GSCArrayUnguardedInsertionSort (const void **array, CFIndex length,
+                                CFComparatorFunction comparator,
+                                void *context)
+{
+  const void **cur;
+  const void **end = array + length;
+
+  for (cur = array + 1; cur < end; ++cur)
+    {
+      const void **hole = cur;
+      const void *value = *cur;
+
+      if (GS_LESS (value, hole[-1]))
+        {
+          do
+            {
+              hole[0] = hole[-1];
+              --hole;
+            }
+          while (GS_LESS (value, hole[-1]));
+          *hole = value;
+        }
+    }
+}
+
+/* Insertion sorts the range, but gives up and returns false once more
+   than GSCARRAY_PARTIAL_INSERTION_SORT_LIMIT values have been moved. */
+static Boolean
+GSCArrayPartialInsertionSort (const void **array, CFIndex length,
+                              CFComparatorFunction comparator, void *context)
+{
+  const void **cur;
+  const void **end = array + length;
+  CFIndex moved = 0;
+
+  for (cur = array + 1; cur < end; ++cur)
+    {
+      const void **hole = cur;
+      const void *value = *cur;
+
+      if (GS_LESS (value, hole[-1]))
+        {
+          do
+            {
+              hole[0] = hole[-1];
+              --hole;
+            }
+          while (hole > array && GS_LESS (value, hole[-1]));
+          *hole = value;
+          moved += cur - hole;
+          if (moved > GSCARRAY_PARTIAL_INSERTION_SORT_LIMIT)
+            return false;
+        }
+    }
+
+  return true;
+}
+
+static void
+GSCArraySiftDown (const void **array, CFIndex root, CFIndex length,
+                  CFComparatorFunction comparator, void *context)
+{
+  const void *value = array[root];
+  CFIndex child;
+
+  while ((child = 2 * root + 1) < length)
+    {
+      if (child + 1 < length && GS_LESS (array[child], array[child + 1]))
+        ++child;
+      if (!GS_LESS (value, array[child]))
+        break;
+      array[root] = array[child];
+      root = child;
+    }
+  array[root] = value;
+}
+
+/* Arranges the range as a binary max-heap: no value is less than one of
+   its children, so array[0] is a greatest value. */
 void
-GSCArrayQuickSort (const void **array, CFIndex length,
-                   CFComparatorFunction comparator, void *context)
+GSCArrayHeapify (const void **array, CFIndex length,
+                 CFComparatorFunction comparator, void *context)
 {
-  if (length > 16)              /* 16 is an arbritrary "small" number */
+  CFIndex idx;
+
+  for (idx = length / 2; idx-- > 0;)
+    GSCArraySiftDown (array, idx, length, comparator, context);
+}
+
+/* Sorts a range arranged by GSCArrayHeapify() in ascending order. */
+static void
+GSCArraySortHeap (const void **array, CFIndex length,
+                  CFComparatorFunction comparator, void *context)
+{
+  CFIndex idx;
+
+  for (idx = length - 1; idx > 0; --idx)
     {
-      const void *value;
-      CFIndex pivot;
-      CFIndex stored;
-      CFIndex idx;
+      GS_EXCHANGE_VALUES (array[0], array[idx]);
+      GSCArraySiftDown (array, 0, idx, comparator, context);
+    }
+}
+
+static void
+GSCArrayHeapSort (const void **array, CFIndex length,
+                  CFComparatorFunction comparator, void *context)
+{
+  GSCArrayHeapify (array, length, comparator, context);
+  GSCArraySortHeap (array, length, comparator, context);
+}
 
-      pivot = length / 2;
-      value = array[pivot];
-      GS_EXCHANGE_VALUES (array[pivot], array[length - 1]);
-      for (idx = 0, stored = 0; idx < length; ++idx)
+/* Exchanges the values at the given offsets from left and right.  If the
+   counts of misplaced values on both sides were equal, each pair is simply
+   swapped; otherwise the values are rotated through a cycle, which needs
+   fewer moves. */
+CF_INLINE void
+GSCArraySwapOffsets (const void **left, const void **right,
+                     const unsigned char *offsetsL,
+                     const unsigned char *offsetsR, CFIndex num,
+                     Boolean useSwaps)
+{
+  CFIndex idx;
+
+  if (useSwaps)
+    {
+      for (idx = 0; idx < num; ++idx)
+        GS_EXCHANGE_VALUES (left[offsetsL[idx]], right[-offsetsR[idx]]);
+    }
+  else if (num > 0)
+    {
+      const void **l = left + offsetsL[0];
+      const void **r = right - offsetsR[0];
+      const void *tmp = *l;
+
+      *l = *r;
+      for (idx = 1; idx < num; ++idx)
         {
-          if ((*comparator) (array[idx], value, context) == kCFCompareLessThan)
+          l = left + offsetsL[idx];
+          *r = *l;
+          r = right - offsetsR[idx];
+          *l = *r;
+        }
+      *r = tmp;
+    }
+}
+
+/* Partitions the range around array[0].  Values less than the pivot end
+   up on its left, the others on its right.  Returns the pivot's final
+   position; *partitioned is set if no value had to be moved. */
+static const void **
+GSCArrayPartitionRight (const void **begin, const void **end,
+                        Boolean *partitioned,
+                        CFComparatorFunction comparator, void *context)
+{
+  const void *pivot = *begin;
+  const void **first = begin;
+  const void **last = end;
+  const void **pivotPos;
+
+  /* The median-of-three guarantees a value not less than the pivot. */
+  while (GS_LESS (*++first, pivot))
+    ;
+  if (first - 1 == begin)
+    {
+      while (first < last && !GS_LESS (*--last, pivot))
+        ;
+    }
+  else
+    {
+      while (!GS_LESS (*--last, pivot))
+        ;
+    }
+
+  *partitioned = first >= last;
+  if (!*partitioned)
+    {
+      unsigned char offsetsL[GSCARRAY_BLOCK_SIZE];
+      unsigned char offsetsR[GSCARRAY_BLOCK_SIZE];
+      const void **baseL;
+      const void **baseR;
+      CFIndex numL = 0;
+      CFIndex numR = 0;
+      CFIndex startL = 0;
+      CFIndex startR = 0;
+
+      GS_EXCHANGE_VALUES (*first, *last);
+      ++first;
+      baseL = first;
+      baseR = last;
+
+      while (first < last)
+        {
+          CFIndex unknown = last - first;
+          CFIndex splitL;
+          CFIndex splitR;
+          CFIndex num;
+          CFIndex idx;
+
+          /* Record the offsets of values on the wrong side, adding to the
+             count without branching on the comparison. */
+          splitL = numL == 0 ? (numR == 0 ? unknown / 2 : unknown) : 0;
+          splitR = numR == 0 ? unknown - splitL : 0;
+          if (splitL > GSCARRAY_BLOCK_SIZE)
+            splitL = GSCARRAY_BLOCK_SIZE;
+          if (splitR > GSCARRAY_BLOCK_SIZE)
+            splitR = GSCARRAY_BLOCK_SIZE;
+
+          for (idx = 0; idx < splitL;)
             {
-              GS_EXCHANGE_VALUES (array[idx], array[stored]);
-              ++stored;
+              offsetsL[numL] = idx++;
+              numL += !GS_LESS (*first, pivot);
+              ++first;
+            }
+          for (idx = 0; idx < splitR;)
+            {
+              offsetsR[numR] = ++idx;
+              numR += GS_LESS (*--last, pivot);
+            }
+
+          num = numL < numR ? numL : numR;
+          GSCArraySwapOffsets (baseL, baseR, offsetsL + startL,
+                               offsetsR + startR, num, numL == numR);
+          numL -= num;
+          numR -= num;
+          startL += num;
+          startR += num;
+          if (numL == 0)
+            {
+              startL = 0;
+              baseL = first;
+            }
+          if (numR == 0)
+            {
+              startR = 0;
+              baseR = last;
             }
         }
-      GS_EXCHANGE_VALUES (array[stored], array[length - 1]);
 
-      GSCArrayQuickSort (array, stored, comparator, context);
-      GSCArrayQuickSort (array + stored + 1, length - stored - 1, comparator,
-                         context);
+      /* Move the remaining misplaced values to the boundary. */
+      if (numL > 0)
+        {
+          while (numL-- > 0)
+            {
+              --last;
+              GS_EXCHANGE_VALUES (baseL[offsetsL[startL + numL]], *last);
+            }
+          first = last;
+        }
+      if (numR > 0)
+        {
+          while (numR-- > 0)
+            {
+              GS_EXCHANGE_VALUES (baseR[-offsetsR[startR + numR]], *first);
+              ++first;
+            }
+        }
+    }
+
+  pivotPos = first - 1;
+  *begin = *pivotPos;
+  *pivotPos = pivot;
+
+  return pivotPos;
+}
+
+/* Partitions the range around array[0], putting values equal to the pivot
+   on its left.  Used when the pivot equals the value before the range,
+   which means no value in the range is less than the pivot: the left side
+   is then all equal and needs no further sorting. */
+static const void **
+GSCArrayPartitionLeft (const void **begin, const void **end,
+                       CFComparatorFunction comparator, void *context)
+{
+  const void *pivot = *begin;
+  const void **first = begin;
+  const void **last = end;
+
+  while (GS_LESS (pivot, *--last))
+    ;
+  if (last + 1 == end)
+    {
+      while (first < last && !GS_LESS (pivot, *++first))
+        ;
+    }
+  else
+    {
+      while (!GS_LESS (pivot, *++first))
+        ;
+    }
+
+  while (first < last)
+    {
+      GS_EXCHANGE_VALUES (*first, *last);
+      while (GS_LESS (pivot, *--last))
+        ;
+      while (!GS_LESS (pivot, *++first))
+        ;
+    }
+
+  *begin = *last;
+  *last = pivot;
+
+  return last;
+}
+
+/* Moves the median of three (or of three medians) to the front of the
+   range, leaving a value not less than it at the end. */
+static void
+GSCArrayChoosePivot (const void **begin, const void **end,
+                     CFComparatorFunction comparator, void *context)
+{
+  CFIndex half = (end - begin) / 2;
+
+  if (end - begin > GSCARRAY_NINTHER_THRESHOLD)
+    {
+      GSCArraySort3 (begin, begin + half, end - 1, comparator, context);
+      GSCArraySort3 (begin + 1, begin + half - 1, end - 2, comparator,
+                     context);
+      GSCArraySort3 (begin + 2, begin + half + 1, end - 3, comparator,
+                     context);
+      GSCArraySort3 (begin + half - 1, begin + half, begin + half + 1,
+                     comparator, context);
+      GS_EXCHANGE_VALUES (*begin, begin[half]);
+    }
+  else
+    {
+      GSCArraySort3 (begin + half, begin, end - 1, comparator, context);
+    }
+}
+
+/* Swaps a few values on both sides of a badly unbalanced partition to
+   break up whatever pattern produced it. */
+static void
+GSCArrayBreakPatterns (const void **begin, const void **pivotPos,
+                       const void **end)
+{
+  CFIndex sizeL = pivotPos - begin;
+  CFIndex sizeR = end - (pivotPos + 1);
+
+  if (sizeL >= GSCARRAY_INSERTION_SORT_THRESHOLD)
+    {
+      GS_EXCHANGE_VALUES (begin[0], begin[sizeL / 4]);
+      GS_EXCHANGE_VALUES (pivotPos[-1], pivotPos[-(sizeL / 4)]);
+      if (sizeL > GSCARRAY_NINTHER_THRESHOLD)
+        {
+          GS_EXCHANGE_VALUES (begin[1], begin[sizeL / 4 + 1]);
+          GS_EXCHANGE_VALUES (begin[2], begin[sizeL / 4 + 2]);
+          GS_EXCHANGE_VALUES (pivotPos[-2], pivotPos[-(sizeL / 4 + 1)]);
+          GS_EXCHANGE_VALUES (pivotPos[-3], pivotPos[-(sizeL / 4 + 2)]);
+        }
+    }
+  if (sizeR >= GSCARRAY_INSERTION_SORT_THRESHOLD)
+    {
+      GS_EXCHANGE_VALUES (pivotPos[1], pivotPos[1 + sizeR / 4]);
+      GS_EXCHANGE_VALUES (end[-1], end[-(sizeR / 4)]);
+      if (sizeR > GSCARRAY_NINTHER_THRESHOLD)
+        {
+          GS_EXCHANGE_VALUES (pivotPos[2], pivotPos[2 + sizeR / 4]);
+          GS_EXCHANGE_VALUES (pivotPos[3], pivotPos[3 + sizeR / 4]);
+          GS_EXCHANGE_VALUES (end[-2], end[-(1 + sizeR / 4)]);
+          GS_EXCHANGE_VALUES (end[-3], end[-(2 + sizeR / 4)]);
+        }
+    }
+}
+
+static void
+GSCArrayPDQSort (const void **begin, const void **end, int badAllowed,
+                 Boolean leftmost, CFComparatorFunction comparator,
+                 void *context)
+{
+  while (true)
+    {
+      CFIndex size = end - begin;
+      CFIndex sizeL;
+      CFIndex sizeR;
+      const void **pivotPos;
+      Boolean partitioned;
+
+      if (size < GSCARRAY_INSERTION_SORT_THRESHOLD)
+        {
+          if (leftmost)
+            GSCArrayInsertionSort (begin, size, comparator, context);
+          else
+            GSCArrayUnguardedInsertionSort (begin, size, comparator, context);
+          return;
+        }
+
+      GSCArrayChoosePivot (begin, end, comparator, context);
+
+      /* begin[-1] is the pivot of an earlier partition, so no value here
+         is less than it.  If the new pivot is equal to it, put the equal
+         values on the left and only sort the right. */
+      if (!leftmost && !GS_LESS (begin[-1], *begin))
+        {
+          begin = GSCArrayPartitionLeft (begin, end, comparator, context) + 1;
+          continue;
+        }
+
+      pivotPos = GSCArrayPartitionRight (begin, end, &partitioned,
+                                         comparator, context);
+      sizeL = pivotPos - begin;
+      sizeR = end - (pivotPos + 1);
+
+      if (sizeL < size / 8 || sizeR < size / 8)
+        {
+          if (--badAllowed == 0)
+            {
+              GSCArrayHeapSort (begin, size, comparator, context);
+              return;
+            }
+
+          GSCArrayBreakPatterns (begin, pivotPos, end);
+        }
+      else if (partitioned
+               && GSCArrayPartialInsertionSort (begin, sizeL, comparator,
+                                                context)
+               && GSCArrayPartialInsertionSort (pivotPos + 1, sizeR,
+                                                comparator, context))
+        {
+          /* The range was already sorted, or nearly so. */
+          return;
+        }
+
+      /* Recurse into the left side and loop on the right one. */
+      GSCArrayPDQSort (begin, pivotPos, badAllowed, leftmost, comparator,
+                       context);
+      begin = pivotPos + 1;
+      leftmost = false;
     }
-  GSCArrayInsertionSort (array, length, comparator, context);
+}
+
+void
+GSCArrayQuickSort (const void **array, CFIndex length,
+                   CFComparatorFunction comparator, void *context)
+{
+  int badAllowed = 0;
+  CFIndex n;
+
+  if (length < 2)
+    return;
+
+  /* Allow about log2(length) badly unbalanced partitions. */
+  for (n = length; n > 1; n >>= 1)
+    ++badAllowed;
+  GSCArrayPDQSort (array, array + length, badAllowed, true, comparator,
+                   context);
 }
 
 void
@@ -73,7 +532,7 @@ GSCArrayInsertionSort (const void **array, CFIndex length,
 
   for (idx = 1; idx < length; ++idx)
     {
-      int hole;
+      CFIndex hole;
       const void *value;
 
       hole = idx;
@@ -89,43 +548,671 @@ GSCArrayInsertionSort (const void **array, CFIndex length,
     }
 }
 
-CFIndex
-GSCArrayBSearch (const void **array, const void *key, CFIndex length,
-                 CFComparatorFunction comparator, void *context)
+/* GSCArraySelect() is an introselect built from the same parts as the
+ * quicksort: it partitions around a median-of-three pivot, but only keeps
+ * going on the side that holds the requested position, which takes linear
+ * time on average.  After too many badly unbalanced partitions it finishes
+ * with a heap selection, which is O(n log k).
+ */
+
+/* Puts the nth smallest value at array[nth] by keeping a max-heap of the
+   nth + 1 smallest values seen so far at the front of the range. */
+static void
+GSCArrayHeapSelect (const void **array, CFIndex length, CFIndex nth,
+                    CFComparatorFunction comparator, void *context)
+{
+  CFIndex idx;
+
+  GSCArrayHeapify (array, nth + 1, comparator, context);
+  for (idx = nth + 1; idx < length; ++idx)
+    {
+      if (GS_LESS (array[idx], array[0]))
+        {
+          GS_EXCHANGE_VALUES (array[0], array[idx]);
+          GSCArraySiftDown (array, 0, nth + 1, comparator, context);
+        }
+    }
+  GS_EXCHANGE_VALUES (array[0], array[nth]);
+}
+
+void
+GSCArraySelect (const void **array, CFIndex length, CFIndex nth,
+                CFComparatorFunction comparator, void *context)
+{
+  const void **begin = array;
+  const void **end = array + length;
+  const void **target = array + nth;
+  int badAllowed = 0;
+  CFIndex n;
+
+  if (nth < 0 || nth >= length)
+    return;
+
+  for (n = length; n > 1; n >>= 1)
+    ++badAllowed;
+  while (end - begin > GSCARRAY_INSERTION_SORT_THRESHOLD)
+    {
+      CFIndex size = end - begin;
+      const void **pivotPos;
+      Boolean partitioned;
+
+      GSCArrayChoosePivot (begin, end, comparator, context);
+
+      /* As in the quicksort, a pivot equal to the value before the range
+         means the values equal to it can be split off in one pass. */
+      if (begin > array && !GS_LESS (begin[-1], *begin))
+        {
+          pivotPos = GSCArrayPartitionLeft (begin, end, comparator, context);
+          if (target <= pivotPos)
+            return;
+          begin = pivotPos + 1;
+          continue;
+        }
+
+      pivotPos = GSCArrayPartitionRight (begin, end, &partitioned,
+                                         comparator, context);
+      if (pivotPos == target)
+        return;
+
+      if (pivotPos - begin < size / 8 || end - (pivotPos + 1) < size / 8)
+        {
+          if (--badAllowed == 0)
+            {
+              GSCArrayHeapSelect (begin, size, target - begin, comparator,
+                                  context);
+              return;
+            }
+          GSCArrayBreakPatterns (begin, pivotPos, end);
+        }
+
+      if (target < pivotPos)
+        end = pivotPos;
+      else
+        begin = pivotPos + 1;
+    }
+
+  GSCArrayInsertionSort (begin, end - begin, comparator, context);
+}
+
+void
+GSCArrayTopValues (const void **array, CFIndex length, const void **values,
+                   CFIndex count, CFComparatorFunction comparator,
+                   void *context)
+{
+  CFIndex idx;
+
+  if (count > length)
+    count = length;
+  if (count <= 0)
+    return;
+
+  /* values[0] is the greatest of the count smallest values seen so far,
+     and each later value only needs comparing against it. */
+  memcpy (values, array, count * sizeof (const void *));
+  GSCArrayHeapify (values, count, comparator, context);
+  for (idx = count; idx < length; ++idx)
+    {
+      if (GS_LESS (array[idx], values[0]))
+        {
+          values[0] = array[idx];
+          GSCArraySiftDown (values, 0, count, comparator, context);
+        }
+    }
+  GSCArraySortHeap (values, count, comparator, context);
+}
+
+/* GSCArrayMergeSort() is a stable merge sort in the style of timsort.  It
+ * splits the range into runs that are already in order (reversing strictly
+ * descending ones), extends short runs to a minimum length with a binary
+ * insertion sort and merges adjacent runs while keeping their lengths
+ * balanced.  Already sorted input takes n - 1 comparisons, and inputs made
+ * of a few sorted runs take little more than what it costs to merge them.
+ */
+
+#define GSCARRAY_MIN_MERGE 32
+#define GSCARRAY_MAX_RUNS 96
+
+/* Returns the index of the first value in the range that is greater than
+   value, i.e. the position after any values equal to it. */
+CF_INLINE CFIndex
+GSCArrayUpperBound (const void **array, CFIndex length, const void *value,
+                    CFComparatorFunction comparator, void *context)
 {
-  CFIndex min;
-  CFIndex mid;
-  CFIndex max;
+  CFIndex min = 0;
 
-  min = 0;
-  max = length;
-  while (min < max)
+  while (length > 0)
     {
-      CFComparisonResult r;
+      CFIndex half = length / 2;
 
-      mid = (min + max) / 2;
-      r = (*comparator) (key, array[mid], context);
-      if (r == kCFCompareLessThan)
+      if (GS_LESS (value, array[min + half]))
         {
-          max = mid - 1;
-          break;
+          length = half;
         }
-      else if (r == kCFCompareGreaterThan)
+      else
         {
-          max = mid - 1;
+          min += half + 1;
+          length -= half + 1;
+        }
+    }
+  return min;
+}
+
+/* Returns the index of the first value in the range that is not less than
+   value. */
+CF_INLINE CFIndex
+GSCArrayLowerBound (const void **array, CFIndex length, const void *value,
+                    CFComparatorFunction comparator, void *context)
+{
+  CFIndex min = 0;
+
+  while (length > 0)
+    {
+      CFIndex half = length / 2;
+
+      if (GS_LESS (array[min + half], value))
+        {
+          min += half + 1;
+          length -= half + 1;
         }
       else
         {
-          min = mid + 1;
+          length = half;
         }
     }
+  return min;
+}
+
+/* Sorts the range, of which the first sorted values are already in order,
+   inserting each of the others after any values equal to it. */
+static void
+GSCArrayBinaryInsertionSort (const void **array, CFIndex length,
+                             CFIndex sorted, CFComparatorFunction comparator,
+                             void *context)
+{
+  for (; sorted < length; ++sorted)
+    {
+      const void *value = array[sorted];
+      CFIndex pos;
 
-  return max + 1;
+      pos = GSCArrayUpperBound (array, sorted, value, comparator, context);
+      memmove (array + pos + 1, array + pos,
+               (sorted - pos) * sizeof (const void *));
+      array[pos] = value;
+    }
+}
+
+/* Returns the length of the run at the start of the range, reversing it
+   first if it is strictly descending (reversing a run with equal values
+   would break stability). */
+static CFIndex
+GSCArrayCountRun (const void **array, CFIndex length,
+                  CFComparatorFunction comparator, void *context)
+{
+  CFIndex run = 1;
+
+  if (length < 2)
+    return length;
+
+  if (GS_LESS (array[1], array[0]))
+    {
+      CFIndex lo;
+      CFIndex hi;
+
+      for (run = 2; run < length && GS_LESS (array[run], array[run - 1]);
+           ++run)
+        ;
+      for (lo = 0, hi = run - 1; lo < hi; ++lo, --hi)
+        GS_EXCHANGE_VALUES (array[lo], array[hi]);
+    }
+  else
+    {
+      for (run = 2; run < length && !GS_LESS (array[run], array[run - 1]);
+           ++run)
+        ;
+    }
+
+  return run;
+}
+
+/* Returns a run length between GSCARRAY_MIN_MERGE / 2 and
+   GSCARRAY_MIN_MERGE such that length divided by it is close to, but no
+   more than, a power of two, so the final merges are balanced. */
+static CFIndex
+GSCArrayMinRun (CFIndex length)
+{
+  CFIndex low = 0;
+
+  while (length >= GSCARRAY_MIN_MERGE)
+    {
+      low |= length & 1;
+      length >>= 1;
+    }
+  return length + low;
+}
+
+/* Merges the sorted runs array[0, len1) and array[len1, len1 + len2)
+   using scratch, which has room for the shorter of the two. */
+static void
+GSCArrayMergeRuns (const void **array, CFIndex len1, CFIndex len2,
+                   const void **scratch, CFComparatorFunction comparator,
+                   void *context)
+{
+  const void **run2 = array + len1;
+  CFIndex skip;
+
+  /* Values of the first run that are not greater than the first value of
+     the second are already in place, as are values of the second run that
+     are not less than the last value of the first. */
+  skip = GSCArrayUpperBound (array, len1, run2[0], comparator, context);
+  array += skip;
+  len1 -= skip;
+  if (len1 == 0)
+    return;
+  len2 = GSCArrayLowerBound (run2, len2, run2[-1], comparator, context);
+  if (len2 == 0)
+    return;
+
+  if (len1 <= len2)
+    {
+      const void **a = scratch;
+      const void **aEnd = scratch + len1;
+      const void **b = run2;
+      const void **bEnd = run2 + len2;
+      const void **dest = array;
+
+      /* Merge forwards, taking from the first run unless the second is
+         strictly less. */
+      memcpy (scratch, array, len1 * sizeof (const void *));
+      while (a < aEnd && b < bEnd)
+        *dest++ = GS_LESS (*b, *a) ? *b++ : *a++;
+      memcpy (dest, a, (aEnd - a) * sizeof (const void *));
+    }
+  else
+    {
+      const void **a = run2 - 1;
+      const void **b = scratch + len2 - 1;
+      const void **dest = run2 + len2 - 1;
+
+      /* Merge backwards, taking from the second run unless it is strictly
+         less than the first. */
+      memcpy (scratch, run2, len2 * sizeof (const void *));
+      while (a >= array && b >= scratch)
+        *dest-- = GS_LESS (*b, *a) ? *a-- : *b--;
+      memcpy (dest - (b - scratch), scratch,
+              (b - scratch + 1) * sizeof (const void *));
+    }
 }
 
 void
-GSCArrayHeapify (const void **array, CFIndex length,
+GSCArrayMergeSort (const void **array, CFIndex length,
+                   CFComparatorFunction comparator, void *context,
+                   CFAllocatorRef alloc)
+{
+  CFIndex runBase[GSCARRAY_MAX_RUNS];
+  CFIndex runLength[GSCARRAY_MAX_RUNS];
+  CFIndex runs = 0;
+  const void **scratch;
+  CFIndex minRun;
+  CFIndex pos;
+
+  if (length < 2)
+    return;
+
+  if (length < GSCARRAY_MIN_MERGE)
+    {
+      pos = GSCArrayCountRun (array, length, comparator, context);
+      GSCArrayBinaryInsertionSort (array, length, pos, comparator, context);
+      return;
+    }
+
+  scratch = CFAllocatorAllocate (alloc, (length / 2) * sizeof (const void *),
+                                 0);
+  minRun = GSCArrayMinRun (length);
+  for (pos = 0; pos < length;)
+    {
+      CFIndex run;
+
+      run = GSCArrayCountRun (array + pos, length - pos, comparator, context);
+      if (run < minRun)
+        {
+          CFIndex forced = length - pos < minRun ? length - pos : minRun;
+
+          GSCArrayBinaryInsertionSort (array + pos, forced, run, comparator,
+                                       context);
+          run = forced;
+        }
+      runBase[runs] = pos;
+      runLength[runs] = run;
+      ++runs;
+      pos += run;
+
+      /* Merge until the run lengths, from the top of the stack down, grow
+         at least as fast as the Fibonacci numbers (checking the top four
+         runs, as the original three-run check is not enough). */
+      while (runs > 1)
+        {
+          CFIndex n = runs - 2;
+
+          if ((n > 0 && runLength[n - 1] <= runLength[n] + runLength[n + 1])
+              || (n > 1
+                  && runLength[n - 2] <= runLength[n - 1] + runLength[n]))
+            {
+              if (runLength[n - 1] < runLength[n + 1])
+                --n;
+            }
+          else if (runLength[n] > runLength[n + 1])
+            {
+              break;
+            }
+          GSCArrayMergeRuns (array + runBase[n], runLength[n],
+                             runLength[n + 1], scratch, comparator, context);
+          runLength[n] += runLength[n + 1];
+          if (n + 2 < runs)
+            {
+              runBase[n + 1] = runBase[n + 2];
+              runLength[n + 1] = runLength[n + 2];
+            }
+          --runs;
+        }
+    }
+
+  /* Merge what is left, from the top of the stack. */
+  while (runs > 1)
+    {
+      CFIndex n = runs - 2;
+
+      if (n > 0 && runLength[n - 1] < runLength[n + 1])
+        --n;
+      GSCArrayMergeRuns (array + runBase[n], runLength[n], runLength[n + 1],
+                         scratch, comparator, context);
+      runLength[n] += runLength[n + 1];
+      if (n + 2 < runs)
+        {
+          runBase[n + 1] = runBase[n + 2];
+          runLength[n + 1] = runLength[n + 2];
+        }
+      --runs;
+    }
+
+  CFAllocatorDeallocate (alloc, scratch);
+}
+
+/* GSCArrayParallelSort() sorts equal slices of the range on the threads
+ * of the pool, one slice per thread, then merges pairs of sorted runs in
+ * rounds, going back and forth between the array and a buffer.  Every
+ * merge is split into parts of equal size at points found by binary
+ * search (the "merge path"), so that all threads stay busy until the last
+ * round, which is a single merge.
+ */
+
+typedef struct
+{
+  const void **src;
+  const void **dst;
+  CFIndex length;
+  CFIndex slices;
+  CFIndex width;                /* Slices per run in this round */
+  CFIndex parts;                /* Parts each merge is split into */
+  CFComparatorFunction comparator;
+  void *context;
+} GSCArrayParallelSortJob;
+
+/* Returns length * part / parts without overflowing. */
+CF_INLINE CFIndex
+GSCArraySplit (CFIndex length, CFIndex part, CFIndex parts)
+{
+  return length / parts * part + length % parts * part / parts;
+}
+
+CF_INLINE CFIndex
+GSCArraySliceStart (GSCArrayParallelSortJob * job, CFIndex slice)
+{
+  if (slice >= job->slices)
+    return job->length;
+  return GSCArraySplit (job->length, slice, job->slices);
+}
+
+static void
+GSCArraySortSlice (void *ctx, CFIndex idx)
+{
+  GSCArrayParallelSortJob *job = ctx;
+  CFIndex start = GSCArraySliceStart (job, idx);
+  CFIndex end = GSCArraySliceStart (job, idx + 1);
+
+  GSCArrayQuickSort (job->src + start, end - start, job->comparator,
+                     job->context);
+}
+
+/* Returns how many of the first k values of the stable merge of a and b
+   come from a. */
+static CFIndex
+GSCArrayCoRank (CFIndex k, const void **a, CFIndex lenA, const void **b,
+                CFIndex lenB, CFComparatorFunction comparator, void *context)
+{
+  CFIndex lo = k > lenB ? k - lenB : 0;
+  CFIndex hi = k < lenA ? k : lenA;
+
+  while (lo < hi)
+    {
+      CFIndex i = lo + (hi - lo) / 2;
+
+      if (GS_LESS (b[k - i - 1], a[i]))
+        hi = i;
+      else
+        lo = i + 1;
+    }
+  return lo;
+}
+
+static void
+GSCArrayMergePart (void *ctx, CFIndex idx)
+{
+  GSCArrayParallelSortJob *job = ctx;
+  CFComparatorFunction comparator = job->comparator;
+  void *context = job->context;
+  CFIndex first = (idx / job->parts) * 2 * job->width;
+  CFIndex part = idx % job->parts;
+  CFIndex start = GSCArraySliceStart (job, first);
+  CFIndex mid = GSCArraySliceStart (job, first + job->width);
+  CFIndex end = GSCArraySliceStart (job, first + 2 * job->width);
+  const void **a = job->src + start;
+  const void **b = job->src + mid;
+  CFIndex lenA = mid - start;
+  CFIndex lenB = end - mid;
+  CFIndex k0 = GSCArraySplit (end - start, part, job->parts);
+  CFIndex k1 = GSCArraySplit (end - start, part + 1, job->parts);
+  const void **aEnd;
+  const void **bEnd;
+  const void **dest;
+  CFIndex i0;
+  CFIndex i1;
+
+  i0 = GSCArrayCoRank (k0, a, lenA, b, lenB, comparator, context);
+  i1 = GSCArrayCoRank (k1, a, lenA, b, lenB, comparator, context);
+  aEnd = a + i1;
+  bEnd = b + (k1 - i1);
+  a += i0;
+  b += k0 - i0;
+  dest = job->dst + start + k0;
+
+  while (a < aEnd && b < bEnd)
+    *dest++ = GS_LESS (*b, *a) ? *b++ : *a++;
+  memcpy (dest, a, (aEnd - a) * sizeof (const void *));
+  dest += aEnd - a;
+  memcpy (dest, b, (bEnd - b) * sizeof (const void *));
+}
+
+void
+GSCArrayParallelSort (const void **array, CFIndex length,
+                      CFComparatorFunction comparator, void *context,
+                      CFAllocatorRef alloc)
+{
+  GSCArrayParallelSortJob job;
+  const void **buffer;
+  CFIndex threads;
+
+  threads = GSThreadPoolGetThreadCount ();
+  if (threads < 2 || length < threads * GSCARRAY_INSERTION_SORT_THRESHOLD)
+    {
+      GSCArrayQuickSort (array, length, comparator, context);
+      return;
+    }
+
+  buffer = CFAllocatorAllocate (alloc, length * sizeof (const void *), 0);
+  job.src = array;
+  job.length = length;
+  job.slices = threads;
+  job.comparator = comparator;
+  job.context = context;
+  GSThreadPoolApply (job.slices, GSCArraySortSlice, &job);
+
+  for (job.width = 1; job.width < job.slices; job.width *= 2)
+    {
+      CFIndex merges = (job.slices + 2 * job.width - 1) / (2 * job.width);
+
+      job.parts = (threads + merges - 1) / merges;
+      job.dst = job.src == array ? buffer : array;
+      GSThreadPoolApply (merges * job.parts, GSCArrayMergePart, &job);
+      job.src = job.dst;
+    }
+  if (job.src != array)
+    memcpy (array, buffer, length * sizeof (const void *));
+
+  CFAllocatorDeallocate (alloc, buffer);
+}
+
+#if defined(__GNUC__)
+#define GSCArrayPrefetch(addr) __builtin_prefetch ((addr), 0)
+#else
+#define GSCArrayPrefetch(addr)
+#endif
+
+/* Returns the index of the first value that is not less than key, or
+   length if there is none.  The range is halved without branching on the
+   comparison, so the compiler can use a conditional move and the loop
+   always runs log2(length) times.  Since the processor no longer guesses
+   where the next probe is, both candidates are prefetched instead. */
+CFIndex
+GSCArrayBSearch (const void **array, const void *key, CFIndex length,
                  CFComparatorFunction comparator, void *context)
 {
+  const void **base = array;
+
+  if (length == 0)
+    return 0;
+
+  while (length > 1)
+    {
+      CFIndex half = length / 2;
+
+      GSCArrayPrefetch (base + half / 2);
+      GSCArrayPrefetch (base + half + half / 2);
+      base = GS_LESS (base[half], key) ? base + half : base;
+      length -= half;
+    }
+
+  return (base - array) + GS_LESS (*base, key);
+}
+
+/* In the Eytzinger layout the values of a sorted array are stored in the
+ * order of a breadth-first walk of the binary search tree over them:
+ * layout[1] is the root and the children of layout[k] are layout[2k] and
+ * layout[2k + 1].  A search then reads the layout from front to back, and
+ * the eight values three levels below layout[k] share one cache line if
+ * layout is aligned to GSCARRAY_EYTZINGER_ALIGNMENT, so they are prefetched
+ * while the levels above are compared.  The index in the sorted array of
+ * the value found is worked out from k, which takes a few instructions but
+ * no memory access.
+ */
+
+static CFIndex
+GSCArrayEytzingerFill (const void **array, CFIndex length,
+                       const void **layout, CFIndex k, CFIndex idx)
+{
+  if (k <= length)
+    {
+      idx = GSCArrayEytzingerFill (array, length, layout, 2 * k, idx);
+      layout[k] = array[idx++];
+      idx = GSCArrayEytzingerFill (array, length, layout, 2 * k + 1, idx);
+    }
+
+  return idx;
+}
+
+void
+GSCArrayEytzingerLayout (const void **array, CFIndex length,
+                         const void **layout)
+{
+  GSCArrayEytzingerFill (array, length, layout, 1, 0);
+}
+
+CF_INLINE CFIndex
+GSCArrayLog2 (CFIndex n)
+{
+#if defined(__GNUC__)
+  return (CFIndex) (sizeof (unsigned long long) * 8 - 1)
+    - __builtin_clzll ((unsigned long long) n);
+#else
+  CFIndex log = 0;
+
+  while (n >>= 1)
+    ++log;
+  return log;
+#endif
+}
+
+/* Counts the values that come before layout[k] in sorted order.  With k
+   the m-th node of level d, the levels down to d hold 2m of them: those
+   left of each ancestor, and the ancestors k is right of.  Each full level
+   below d holds 2m + 1 more per node of k's left subtree at that level,
+   and the last level, which may be partly filled, is counted on its own. */
+static CFIndex
+GSCArrayEytzingerRank (CFIndex k, CFIndex length)
+{
+  CFIndex depth = GSCArrayLog2 (k);
+  CFIndex last = GSCArrayLog2 (length);
+  CFIndex m = k - ((CFIndex) 1 << depth);
+  CFIndex rank = 2 * m;
+
+  if (last > depth)
+    {
+      CFIndex below = last - depth - 1;
+      CFIndex bound = (2 * k + 1) << below;
+
+      rank += (2 * m + 1) * (((CFIndex) 1 << below) - 1);
+      if (bound > length + 1)
+        bound = length + 1;
+      if (bound > ((CFIndex) 1 << last))
+        rank += bound - ((CFIndex) 1 << last);
+    }
+
+  return rank;
+}
+
+CFIndex
+GSCArrayEytzingerSearch (const void **layout, CFIndex length,
+                         const void *key, CFComparatorFunction comparator,
+                         void *context)
+{
+  CFIndex k = 1;
+
+  while (k <= length)
+    {
+      if (8 * k <= length)
+        GSCArrayPrefetch (layout + 8 * k);
+      k = 2 * k + GS_LESS (layout[k], key);
+    }
+
+  /* Each step to the right went past a value less than key.  Undoing the
+     steps to the right after the last step to the left, and that step,
+     leads back to the first value not less than key. */
+#if defined(__GNUC__)
+  k >>= __builtin_ctzll (~(unsigned long long) k) + 1;
+#else
+  while (k & 1)
+    k >>= 1;
+  k >>= 1;
+#endif
 
+  return k == 0 ? length : GSCArrayEytzingerRank (k, length);
 }
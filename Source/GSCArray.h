@@ -36,6 +36,16 @@ GS_PRIVATE void
 GSCArrayQuickSort (const void **array, CFIndex length,
                    CFComparatorFunction comparator, void *context);
 
+GS_PRIVATE void
+GSCArrayMergeSort (const void **array, CFIndex length,
+                   CFComparatorFunction comparator, void *context,
+                   CFAllocatorRef alloc);
+
+GS_PRIVATE void
+GSCArrayParallelSort (const void **array, CFIndex length,
+                      CFComparatorFunction comparator, void *context,
+                      CFAllocatorRef alloc);
+
 GS_PRIVATE void
 GSCArrayInsertionSort (const void **array, CFIndex length,
                        CFComparatorFunction comparator, void *context);
@@ -44,8 +54,28 @@ GS_PRIVATE void
 GSCArrayHeapify (const void **array, CFIndex length,
                  CFComparatorFunction comparator, void *context);
 
+GS_PRIVATE void
+GSCArraySelect (const void **array, CFIndex length, CFIndex nth,
+                CFComparatorFunction comparator, void *context);
+
+GS_PRIVATE void
+GSCArrayTopValues (const void **array, CFIndex length, const void **values,
+                   CFIndex count, CFComparatorFunction comparator,
+                   void *context);
+
 GS_PRIVATE CFIndex
 GSCArrayBSearch (const void **array, const void *key, CFIndex length,
                  CFComparatorFunction comparator, void *context);
 
+#define GSCARRAY_EYTZINGER_ALIGNMENT 64
+
+GS_PRIVATE void
+GSCArrayEytzingerLayout (const void **array, CFIndex length,
+                         const void **layout);
+
+GS_PRIVATE CFIndex
+GSCArrayEytzingerSearch (const void **layout, CFIndex length,
+                         const void *key, CFComparatorFunction comparator,
+                         void *context);
+
 #endif /* __GSCARRAY_H__ */
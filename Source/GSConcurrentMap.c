@@ -0,0 +1,287 @@
+/* GSConcurrentMap.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "CoreFoundation/CFBase.h"
+#include "GSConcurrentMap.h"
+#include "GSPrivate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* READ THIS FIRST
+ * 
+ * GSConcurrentMap is an open-addressing table with linear probing, at
+ * most half full.  Writers hold the map's mutex; readers take no lock and
+ * rely only on the order in which writers publish data:
+ * 
+ *  - A slot is filled by storing its hash and value first and its key
+ *    last, with release semantics.  A reader that sees the key with an
+ *    acquire load therefore also sees the hash and value.
+ *  - Slots are never emptied, so a probe sequence is never cut short
+ *    under a reader and a value a reader found stays valid.  There is no
+ *    way to remove a key until readers can be told apart from writers.
+ *  - When the table is full enough, a writer copies it into one twice as
+ *    big and publishes the new table.  The old table is kept, linked from
+ *    the new one, because readers may still be probing it; those readers
+ *    may miss keys added later, which for a cache only means a slower
+ *    path.
+ */
+
+typedef struct GSConcurrentMapSlot GSConcurrentMapSlot;
+struct GSConcurrentMapSlot
+{
+  CFHashCode hash;
+  const void *key;              /* NULL until the slot is used */
+  const void *value;
+};
+
+typedef struct GSConcurrentMapTable GSConcurrentMapTable;
+struct GSConcurrentMapTable
+{
+  GSConcurrentMapTable *retired;        /* The table this one replaced */
+  CFIndex capacity;                     /* Always a power of two */
+  CFIndex shift;
+  CFIndex used;
+  GSConcurrentMapSlot slots[1];
+};
+
+struct GSConcurrentMap
+{
+  GSConcurrentMapTable *table;
+  GSMutex lock;
+  CFDictionaryKeyCallBacks keyCallBacks;
+  CFDictionaryValueCallBacks valueCallBacks;
+};
+
+/* 2^N divided by the golden ratio, for N the width of CFHashCode. */
+#define GSCONCURRENTMAP_MULTIPLIER ((CFHashCode)(sizeof (CFHashCode) > 4 ? \
+  0x9E3779B97F4A7C15ULL : 0x9E3779B9UL))
+
+static GSConcurrentMapTable *
+GSConcurrentMapTableCreate (CFIndex count)
+{
+  GSConcurrentMapTable *table;
+  CFIndex capacity = 8;
+  CFIndex shift = sizeof (CFHashCode) * 8 - 3;
+
+  while (capacity < count * 2)
+    {
+      capacity <<= 1;
+      --shift;
+    }
+  table = calloc (1, sizeof (GSConcurrentMapTable)
+                  + (capacity - 1) * sizeof (GSConcurrentMapSlot));
+  if (table)
+    {
+      table->capacity = capacity;
+      table->shift = shift;
+    }
+  return table;
+}
+
+CF_INLINE CFHashCode
+GSConcurrentMapHash (GSConcurrentMapRef map, const void *key)
+{
+  CFDictionaryHashCallBack fHash = map->keyCallBacks.hash;
+
+  return fHash ? fHash (key) : GSHashPointer (key);
+}
+
+CF_INLINE Boolean
+GSConcurrentMapEqual (GSConcurrentMapRef map, const void *key1,
+                      const void *key2)
+{
+  CFDictionaryEqualCallBack fEqual = map->keyCallBacks.equal;
+
+  return key1 == key2 || (fEqual && fEqual (key1, key2));
+}
+
+/* Returns the slot holding key, or the empty slot where it belongs. */
+static GSConcurrentMapSlot *
+GSConcurrentMapTableFind (GSConcurrentMapRef map,
+                          GSConcurrentMapTable * table, const void *key,
+                          CFHashCode hash)
+{
+  CFIndex mask = table->capacity - 1;
+  CFIndex idx = (CFIndex) ((hash * GSCONCURRENTMAP_MULTIPLIER)
+                           >> table->shift);
+
+  while (true)
+    {
+      GSConcurrentMapSlot *slot = &table->slots[idx];
+      const void *k = GSAtomicLoadPointer (&slot->key);
+
+      if (k == NULL
+          || (slot->hash == hash && GSConcurrentMapEqual (map, key, k)))
+        return slot;
+      idx = (idx + 1) & mask;
+    }
+}
+
+/* Must be called with the lock held. */
+static GSConcurrentMapTable *
+GSConcurrentMapGrow (GSConcurrentMapRef map)
+{
+  GSConcurrentMapTable *old = map->table;
+  GSConcurrentMapTable *new;
+  CFIndex idx;
+
+  new = GSConcurrentMapTableCreate (old->capacity);
+  if (new == NULL)
+    return NULL;
+  for (idx = 0; idx < old->capacity; ++idx)
+    {
+      GSConcurrentMapSlot *slot = &old->slots[idx];
+
+      if (slot->key != NULL)
+        *GSConcurrentMapTableFind (map, new, slot->key, slot->hash) = *slot;
+    }
+  new->used = old->used;
+  new->retired = old;
+  GSAtomicStorePointer (&map->table, new);
+
+  return new;
+}
+
+GSConcurrentMapRef
+GSConcurrentMapCreate (CFIndex capacity,
+                       const CFDictionaryKeyCallBacks * keyCallBacks,
+                       const CFDictionaryValueCallBacks * valueCallBacks)
+{
+  GSConcurrentMapRef map;
+
+  map = calloc (1, sizeof (struct GSConcurrentMap));
+  if (map == NULL)
+    return NULL;
+
+  map->table = GSConcurrentMapTableCreate (capacity);
+  if (map->table == NULL)
+    {
+      free (map);
+      return NULL;
+    }
+  GSMutexInitialize (&map->lock);
+  if (keyCallBacks)
+    map->keyCallBacks = *keyCallBacks;
+  if (valueCallBacks)
+    map->valueCallBacks = *valueCallBacks;
+
+  return map;
+}
+
+void
+GSConcurrentMapDestroy (GSConcurrentMapRef map)
+{
+  GSConcurrentMapTable *table = map->table;
+  CFIndex idx;
+
+  for (idx = 0; idx < table->capacity; ++idx)
+    {
+      GSConcurrentMapSlot *slot = &table->slots[idx];
+
+      if (slot->key != NULL && map->keyCallBacks.release)
+        map->keyCallBacks.release (kCFAllocatorSystemDefault, slot->key);
+      if (slot->value != NULL && map->valueCallBacks.release)
+        map->valueCallBacks.release (kCFAllocatorSystemDefault, slot->value);
+    }
+  while (table != NULL)
+    {
+      GSConcurrentMapTable *retired = table->retired;
+
+      free (table);
+      table = retired;
+    }
+  GSMutexDestroy (&map->lock);
+  free (map);
+}
+
+const void *
+GSConcurrentMapGetValue (GSConcurrentMapRef map, const void *key)
+{
+  GSConcurrentMapTable *table;
+  CFHashCode hash;
+  CFIndex mask;
+  CFIndex idx;
+
+  table = GSAtomicLoadPointer (&map->table);
+  hash = GSConcurrentMapHash (map, key);
+  mask = table->capacity - 1;
+  idx = (CFIndex) ((hash * GSCONCURRENTMAP_MULTIPLIER) >> table->shift);
+
+  while (true)
+    {
+      GSConcurrentMapSlot *slot = &table->slots[idx];
+      const void *k = GSAtomicLoadPointer (&slot->key);
+
+      if (k == NULL)
+        return NULL;
+      if (slot->hash == hash && GSConcurrentMapEqual (map, key, k))
+        return GSAtomicLoadPointer (&slot->value);
+      idx = (idx + 1) & mask;
+    }
+}
+
+const void *
+GSConcurrentMapAddValue (GSConcurrentMapRef map, const void *key,
+                         const void *value)
+{
+  GSConcurrentMapTable *table;
+  GSConcurrentMapSlot *slot;
+  CFHashCode hash;
+  const void *result;
+
+  hash = GSConcurrentMapHash (map, key);
+
+  GSMutexLock (&map->lock);
+  table = map->table;
+  slot = GSConcurrentMapTableFind (map, table, key, hash);
+  if (slot->key != NULL)
+    {
+      result = slot->value;
+    }
+  else
+    {
+      if ((table->used + 1) * 2 > table->capacity)
+        {
+          table = GSConcurrentMapGrow (map);
+          if (table == NULL)
+            {
+              GSMutexUnlock (&map->lock);
+              return NULL;
+            }
+          slot = GSConcurrentMapTableFind (map, table, key, hash);
+        }
+
+      result = map->valueCallBacks.retain ?
+        map->valueCallBacks.retain (kCFAllocatorSystemDefault, value) : value;
+      GSAtomicStorePointer (&slot->value, result);
+      if (map->keyCallBacks.retain)
+        key = map->keyCallBacks.retain (kCFAllocatorSystemDefault, key);
+      slot->hash = hash;
+      GSAtomicStorePointer (&slot->key, key);
+      table->used += 1;
+    }
+  GSMutexUnlock (&map->lock);
+
+  return result;
+}
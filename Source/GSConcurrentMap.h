@@ -0,0 +1,63 @@
+/* GSConcurrentMap.h
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __GSCONCURRENTMAP__
+#define __GSCONCURRENTMAP__ 1
+
+#include "CoreFoundation/CFBase.h"
+#include "CoreFoundation/CFDictionary.h"
+#include "GSPrivate.h"
+
+/* A hash map for process-wide caches that are read far more often than
+ * they are written.  Lookups take no lock; additions are serialised by a
+ * mutex.
+ *
+ * Entries cannot be removed, since a lock-free reader may still be using
+ * a value it just looked up.  Keys and values are only released when the
+ * map is destroyed, and tables replaced by a bigger one are kept until
+ * then, so that readers still using them stay safe.  Neither keys nor
+ * values may be NULL.  The callbacks are passed kCFAllocatorSystemDefault,
+ * since the map outlives any thread's default allocator.
+ */
+typedef struct GSConcurrentMap *GSConcurrentMapRef;
+
+GS_PRIVATE GSConcurrentMapRef
+GSConcurrentMapCreate (CFIndex capacity,
+                       const CFDictionaryKeyCallBacks * keyCallBacks,
+                       const CFDictionaryValueCallBacks * valueCallBacks);
+
+GS_PRIVATE void GSConcurrentMapDestroy (GSConcurrentMapRef map);
+
+/* Returns the value for key, or NULL.  Takes no lock. */
+GS_PRIVATE const void *
+GSConcurrentMapGetValue (GSConcurrentMapRef map, const void *key);
+
+/* Adds value for key unless the key already has a value.  Returns the
+ * value the map holds for key afterwards: either value or the one that
+ * was already there.
+ */
+GS_PRIVATE const void *
+GSConcurrentMapAddValue (GSConcurrentMapRef map, const void *key,
+                         const void *value);
+
+#endif /* __GSCONCURRENTMAP__ */
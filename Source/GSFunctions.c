@@ -26,6 +26,15 @@
 
 #include "GSPrivate.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if !defined(_WIN32)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 CFIndex
 GSBSearch (const void *array, const void *key, CFRange range, CFIndex size,
   CFComparatorFunction comp, void *ctxt)
@@ -63,3 +72,302 @@ GSBSearch (const void *array, const void *key, CFRange range, CFIndex size,
   return min - 1;
 }
 
+
+
+
+/* The hash functions below follow the construction of Wang Yi's wyhash
+ * (public domain): input is consumed 16 bytes at a time and each pair of
+ * 64-bit words is folded into the state with a 64x64->128 bit multiply.
+ *
+ * The seed defaults to 0 so that hash values are reproducible.  Setting the
+ * GNUSTEP_COREBASE_HASH_SEED environment variable to a number uses that as
+ * the seed, and setting it to "random" takes a seed from the system's
+ * random number generator for every process, which protects hash tables
+ * against collision flooding.
+ */
+#define GS_HASH_SECRET0 0xa0761d6478bd642fULL
+#define GS_HASH_SECRET1 0xe7037ed1a0b428dbULL
+#define GS_HASH_SECRET2 0x8ebc6af09c88c6e3ULL
+#define GS_HASH_SECRET3 0x589965cc75374cc3ULL
+
+static UInt64 _kGSHashSeed = 0;
+
+CF_INLINE void
+GSHashMultiply (UInt64 *a, UInt64 *b)
+{
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = *a;
+  r *= *b;
+  *a = (UInt64) r;
+  *b = (UInt64) (r >> 64);
+#else
+  UInt64 ha = *a >> 32, hb = *b >> 32, la = (UInt32) *a, lb = (UInt32) *b;
+  UInt64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  UInt64 t = rl + (rm0 << 32);
+  UInt64 c = t < rl;
+  UInt64 lo = t + (rm1 << 32);
+  c += lo < t;
+  *a = lo;
+  *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+CF_INLINE UInt64
+GSHashMix (UInt64 a, UInt64 b)
+{
+  GSHashMultiply (&a, &b);
+  return a ^ b;
+}
+
+CF_INLINE UInt64
+GSHashRead64 (const UInt8 *p)
+{
+  UInt64 v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+CF_INLINE UInt64
+GSHashRead32 (const UInt8 *p)
+{
+  UInt32 v;
+  memcpy (&v, p, sizeof (v));
+  return v;
+}
+
+CF_INLINE CFHashCode
+GSHashFinal (UInt64 a, UInt64 b, UInt64 state, UInt64 length)
+{
+  UInt64 h;
+
+  a ^= GS_HASH_SECRET1;
+  b ^= state;
+  GSHashMultiply (&a, &b);
+  h = GSHashMix (a ^ GS_HASH_SECRET0 ^ length, b ^ GS_HASH_SECRET1);
+  if (sizeof (CFHashCode) < sizeof (UInt64))
+    h ^= h >> 32;
+  /* Objects use 0 to mean the hash has not been computed yet. */
+  return (CFHashCode) h != 0 ? (CFHashCode) h : 1;
+}
+
+/* Fills value with bytes from the system's random number generator. */
+static Boolean
+GSHashGetRandomSeed (UInt64 *value)
+{
+#if defined(_WIN32)
+  LONG (WINAPI *genRandom) (void *, PUCHAR, ULONG, ULONG);
+  HMODULE lib;
+  Boolean ok;
+
+  /* Loaded at run time, as CFUUID does, so that nothing more is linked. */
+  lib = LoadLibraryW (L"bcrypt.dll");
+  if (lib == NULL)
+    return false;
+  genRandom = (LONG (WINAPI *) (void *, PUCHAR, ULONG, ULONG))
+    GetProcAddress (lib, "BCryptGenRandom");
+  /* 2 is BCRYPT_USE_SYSTEM_PREFERRED_RNG. */
+  ok = genRandom != NULL
+    && genRandom (NULL, (PUCHAR) value, sizeof (*value), 2) >= 0;
+  FreeLibrary (lib);
+
+  return ok;
+#else
+  size_t got = 0;
+  ssize_t n;
+  int fd;
+
+  fd = open ("/dev/urandom", O_RDONLY);
+  if (fd < 0)
+    return false;
+  while (got < sizeof (*value))
+    {
+      n = read (fd, (char *) value + got, sizeof (*value) - got);
+      if (n > 0)
+        got += n;
+      else if (n == 0 || errno != EINTR)
+        break;
+    }
+  close (fd);
+
+  return got == sizeof (*value);
+#endif
+}
+
+void
+GSHashInitialize (void)
+{
+  const char *seed;
+
+  seed = getenv ("GNUSTEP_COREBASE_HASH_SEED");
+  if (seed == NULL)
+    return;
+
+  if (strcmp (seed, "random") == 0)
+    {
+      UInt64 entropy;
+
+      if (GSHashGetRandomSeed (&entropy))
+        {
+          _kGSHashSeed = entropy;
+          return;
+        }
+      /* Much easier to guess, but better than a fixed seed. */
+      entropy = (UInt64) time (NULL);
+      entropy ^= (UInt64) (uintptr_t) &entropy << 16;
+      entropy ^= (UInt64) clock () << 40;
+      _kGSHashSeed = GSHashInt64 (entropy);
+    }
+  else
+    {
+      _kGSHashSeed = strtoull (seed, NULL, 0);
+    }
+}
+
+CFHashCode
+GSHashBytes (const void *bytes, CFIndex length)
+{
+  const UInt8 *p = bytes;
+  UInt64 state;
+  UInt64 a;
+  UInt64 b;
+
+  state = _kGSHashSeed ^ GSHashMix (_kGSHashSeed ^ GS_HASH_SECRET0,
+                                    GS_HASH_SECRET1);
+  if (length <= 16)
+    {
+      if (length >= 4)
+        {
+          CFIndex shift = (length >> 3) << 2;
+
+          a = (GSHashRead32 (p) << 32) | GSHashRead32 (p + shift);
+          b = (GSHashRead32 (p + length - 4) << 32)
+            | GSHashRead32 (p + length - 4 - shift);
+        }
+      else if (length > 0)
+        {
+          a = ((UInt64) p[0] << 16) | ((UInt64) p[length >> 1] << 8)
+            | p[length - 1];
+          b = 0;
+        }
+      else
+        {
+          a = b = 0;
+        }
+    }
+  else
+    {
+      CFIndex i = length;
+
+      if (i > 48)
+        {
+          UInt64 see1 = state;
+          UInt64 see2 = state;
+
+          do
+            {
+              state = GSHashMix (GSHashRead64 (p) ^ GS_HASH_SECRET1,
+                                 GSHashRead64 (p + 8) ^ state);
+              see1 = GSHashMix (GSHashRead64 (p + 16) ^ GS_HASH_SECRET2,
+                                GSHashRead64 (p + 24) ^ see1);
+              see2 = GSHashMix (GSHashRead64 (p + 32) ^ GS_HASH_SECRET3,
+                                GSHashRead64 (p + 40) ^ see2);
+              p += 48;
+              i -= 48;
+            }
+          while (i > 48);
+          state ^= see1 ^ see2;
+        }
+      while (i > 16)
+        {
+          state = GSHashMix (GSHashRead64 (p) ^ GS_HASH_SECRET1,
+                             GSHashRead64 (p + 8) ^ state);
+          p += 16;
+          i -= 16;
+        }
+      a = GSHashRead64 (p + i - 16);
+      b = GSHashRead64 (p + i - 8);
+    }
+
+  return GSHashFinal (a, b, state, (UInt64) length);
+}
+
+/* The character hashes work on 64-bit words of four UTF-16 code units.
+ * Both the UTF-16 and the 8-bit variant build the words arithmetically, so
+ * they agree with each other and do not depend on the byte order.
+ */
+CF_INLINE UInt64
+GSHashPackCharacters (const UniChar *c)
+{
+  return (UInt64) c[0] | ((UInt64) c[1] << 16) | ((UInt64) c[2] << 32)
+    | ((UInt64) c[3] << 48);
+}
+
+CF_INLINE UInt64
+GSHashPackCharacters8 (const UInt8 *c)
+{
+  return (UInt64) c[0] | ((UInt64) c[1] << 16) | ((UInt64) c[2] << 32)
+    | ((UInt64) c[3] << 48);
+}
+
+UInt64
+GSHashCharactersStart (void)
+{
+  return _kGSHashSeed ^ GSHashMix (_kGSHashSeed ^ GS_HASH_SECRET0,
+                                   GS_HASH_SECRET1);
+}
+
+UInt64
+GSHashCharactersUpdate (UInt64 state, const UniChar *chars, CFIndex length)
+{
+  const UniChar *end = chars + (length & ~(GS_HASH_CHARACTERS_BLOCK - 1));
+
+  for (; chars < end; chars += GS_HASH_CHARACTERS_BLOCK)
+    state = GSHashMix (GSHashPackCharacters (chars) ^ GS_HASH_SECRET1,
+                       GSHashPackCharacters (chars + 4) ^ state);
+
+  return state;
+}
+
+UInt64
+GSHashCharacters8Update (UInt64 state, const UInt8 *chars, CFIndex length)
+{
+  const UInt8 *end = chars + (length & ~(GS_HASH_CHARACTERS_BLOCK - 1));
+
+  for (; chars < end; chars += GS_HASH_CHARACTERS_BLOCK)
+    state = GSHashMix (GSHashPackCharacters8 (chars) ^ GS_HASH_SECRET1,
+                       GSHashPackCharacters8 (chars + 4) ^ state);
+
+  return state;
+}
+
+CFHashCode
+GSHashCharactersFinish (UInt64 state, const UniChar *chars, CFIndex length,
+                        CFIndex totalLength)
+{
+  UniChar tail[GS_HASH_CHARACTERS_BLOCK] = { 0 };
+  CFIndex full;
+
+  full = length & ~(GS_HASH_CHARACTERS_BLOCK - 1);
+  state = GSHashCharactersUpdate (state, chars, full);
+  memcpy (tail, chars + full, (length - full) * sizeof (UniChar));
+
+  return GSHashFinal (GSHashPackCharacters (tail),
+                      GSHashPackCharacters (tail + 4), state,
+                      (UInt64) totalLength);
+}
+
+CFHashCode
+GSHashCharacters8Finish (UInt64 state, const UInt8 *chars, CFIndex length,
+                         CFIndex totalLength)
+{
+  UInt8 tail[GS_HASH_CHARACTERS_BLOCK] = { 0 };
+  CFIndex full;
+
+  full = length & ~(GS_HASH_CHARACTERS_BLOCK - 1);
+  state = GSHashCharacters8Update (state, chars, full);
+  memcpy (tail, chars + full, length - full);
+
+  return GSHashFinal (GSHashPackCharacters8 (tail),
+                      GSHashPackCharacters8 (tail + 4), state,
+                      (UInt64) totalLength);
+}
@@ -33,33 +33,49 @@
 
 /* READ THIS FIRST
  * 
- * GSHashTable uses an open-address scheme with double hashing for
- * collision resolution.  This method has a few drawbacks, such as much
- * higher memory usage on the worst case, but it is very simple to
- * implement.  This is because, as explained below, we try to keep the
- * load factor less than 80%, so at least 20% of the memory allocated is
- * not used.
+ * GSHashTable uses open addressing with linear probing and Robin Hood
+ * hashing.  Each key has a home bucket, taken from the top bits of its
+ * hash multiplied by a large odd constant (Fibonacci hashing).  This lets
+ * the table size be a power of two, so finding a bucket is a multiply and
+ * a shift instead of a division, and weak hash functions (pointers, small
+ * integers) still spread out over the whole table.
  * 
- * One thing that needs to be kept in mind is table load, we
- * don't want it to go over 80%.  The collisions start to get out of
- * hand at that point.  Collisions might also be a problem if the hash
- * algorithm isn't very good.  Some of this is mitigated by using
- * prime numbers as the hash table size.  There are other open addressing
- * algorithms out there that can handle high load factors more gracefully
- * than double hashing, but they're also more complicated, like
- * Cuckoo hashing or Hopscotch hasing.
+ * The distance of a key from its home bucket is its probe length.  On
+ * insertion a new key takes the place of the first key that is closer to
+ * its own home than the new key would be, and the keys after it move down
+ * one bucket.  This keeps every run of occupied buckets sorted by home
+ * bucket, which has two nice properties: probe lengths stay short and
+ * even, and a lookup can stop as soon as it reaches a key that is closer
+ * to home than the key being searched for would be.
  * 
- * The implementation originally used an equation to calculate the next
- * array size.  This became a problem because we were calculating the
- * table size each time we add or removed an item.  Now a lookup table
- * is used, instead.
+ * Removal uses backward shifting: the keys following the removed one move
+ * back one bucket until an empty bucket, or a key already in its home
+ * bucket, is reached.  There are no tombstones, so lookups do not slow
+ * down after many removals.
  * 
- * To be as easy as possible on system memory, we rehash not only when
- * the table load factor gets above 80% but also when it gets below 25%.
- * This is optimum, but we also want to keep memory usage at a manageable
- * level.  Rehashing to a lower level is only done when removing an object,
- * though.  So we can start with a really large table (high capacity) and
- * never shrink if we don't remove anything.
+ * The table grows when it would become more than 7/8 full and shrinks when
+ * it falls below 1/4 full.  Shrinking is only done when removing an
+ * object, though.  So we can start with a really large table (high
+ * capacity) and never shrink if we don't remove anything.
+ * 
+ * Each occupied bucket also remembers the full hash code of its key.
+ * Probing compares that first and only calls the equal callback, which
+ * may be an expensive CFEqual() or an Objective-C message, when the
+ * hashes match.  The stored hash also gives the probe length of a bucket,
+ * and rehashing and copying reuse it instead of calling the hash callback
+ * again.
+ * 
+ * Large immutable tables are built differently.  GSHashTableCreate() and
+ * GSHashTableCreateCopy() first try to find a perfect hash function for
+ * the keys with the CHD (compress, hash and displace) algorithm.  Keys
+ * are split into groups of about four by their hash.  Going from the
+ * largest group to the smallest, each group gets the first displacement
+ * value that sends all of its keys to free buckets.  The table then has
+ * one bucket per key plus about 1.5% to spare, and a lookup reads one
+ * displacement and one bucket, with no probing at all.  Keys are never
+ * moved after creation, so iteration order is fixed for the life of the
+ * table and kept by copies.  If no perfect hash is found, for example
+ * because two keys have the same hash code, an ordinary table is built.
  */
 
 static const GSHashTableKeyCallBacks _kGSNullHashTableKeyCallBacks = {
@@ -82,7 +98,8 @@ static const GSHashTableValueCallBacks _kGSNullHashTableValueCallBacks = {
 enum
 {
   _kGSHashTableMutable = (1 << 0),
-  _kGSHashTableShouldCount = (1 << 1)
+  _kGSHashTableShouldCount = (1 << 1),
+  _kGSHashTablePerfect = (1 << 2)
 };
 
 CF_INLINE Boolean
@@ -99,6 +116,13 @@ GSHashTableShouldCount (GSHashTableRef table)
     true : false;
 }
 
+CF_INLINE Boolean
+GSHashTableIsPerfect (GSHashTableRef table)
+{
+  return ((CFRuntimeBase *) table)->_flags.info & _kGSHashTablePerfect ?
+    true : false;
+}
+
 CF_INLINE void
 GSHashTableSetMutable (GSHashTableRef table)
 {
@@ -111,26 +135,24 @@ GSHashTableSetShouldCount (GSHashTableRef table)
   ((CFRuntimeBase *) table)->_flags.info |= _kGSHashTableShouldCount;
 }
 
-
-
-typedef enum
+CF_INLINE void
+GSHashTableSetPerfect (GSHashTableRef table)
 {
-  _kGSHashTableRetrieve, // retrieval or deletion
-  _kGSHashTableInsert    // insertion only
-} _kGSHashTableOperation;
+  ((CFRuntimeBase *) table)->_flags.info |= _kGSHashTablePerfect;
+}
+
 
-static CFIndex _kGSHashTableBucketCountDeleted = -1;
 
 CF_INLINE void
 GSHashTableAddKeyValuePair (GSHashTableRef table,
                             GSHashTableBucket * bucket, const void *key,
-                            const void *value)
+                            const void *value, CFHashCode hash)
 {
   GSHashTableRetainCallBack keyRetain = table->_keyCallBacks.retain;
   GSHashTableRetainCallBack valueRetain = table->_valueCallBacks.retain;
-  CFIndex count = bucket->count;
 
-  bucket->count = (count == _kGSHashTableBucketCountDeleted) ? 1 : (count + 1);
+  bucket->count = 1;
+  bucket->hash = hash;
   bucket->key = keyRetain ? keyRetain (table->_allocator, key) : key;
   bucket->value = valueRetain ? valueRetain (table->_allocator, value) : value;
 }
@@ -149,8 +171,7 @@ GSHashTableReplaceKeyValuePair (GSHashTableRef table,
 }
 
 CF_INLINE void
-GSHashTableRemoveKeyValuePair (GSHashTableRef table, GSHashTableBucket * bucket,
-                               CFIndex bucketCountDeleted)
+GSHashTableRemoveKeyValuePair (GSHashTableRef table, GSHashTableBucket * bucket)
 {
   GSHashTableReleaseCallBack keyRelease = table->_keyCallBacks.release;
   GSHashTableReleaseCallBack valueRelease = table->_valueCallBacks.release;
@@ -160,110 +181,442 @@ GSHashTableRemoveKeyValuePair (GSHashTableRef table, GSHashTableBucket * bucket,
   if (valueRelease)
     valueRelease (table->_allocator, bucket->value);
 
-  bucket->count = bucketCountDeleted;
+  bucket->count = 0;
+  bucket->hash = 0;
   bucket->key = NULL;
   bucket->value = NULL;
 }
 
-typedef Boolean (*GSHashTableBucketIsUnoccupiedCallback) (GSHashTableBucket bucket);
-
-CF_INLINE Boolean
-GSHashTableBucketIsUnoccupied(GSHashTableBucket bucket, _kGSHashTableOperation operation)
-{
-  switch (operation) {
-    case _kGSHashTableRetrieve:
-      return bucket.count == 0; // treat deleted buckets as occupied
-    case _kGSHashTableInsert:
-      return bucket.count <= 0; // treat deleted buckets as unoccupied
-  }
-#if __has_builtin(__builtin_unreachable)
-  __builtin_unreachable();
-#else
-  abort();
-#endif
-}
-
 static Boolean
 GSHashTableEqualPointers (const void *key1, const void *key2)
 {
   return key1 == key2;
 }
 
+CF_INLINE CFHashCode
+GSHashTableHashKey (GSHashTableRef table, const void *key)
+{
+  GSHashTableHashCallBack fHash = table->_keyCallBacks.hash;
+
+  return fHash ? fHash (key) : GSHashPointer (key);
+}
+
+/* 2^N divided by the golden ratio, for N the width of CFHashCode. */
+#define GSHASHTABLE_MULTIPLIER ((CFHashCode)(sizeof (CFHashCode) > 4 ? \
+  0x9E3779B97F4A7C15ULL : 0x9E3779B9UL))
+
+CF_INLINE CFIndex
+GSHashTableHomeIndex (GSHashTableRef table, CFHashCode hash)
+{
+  return (CFIndex) ((hash * GSHASHTABLE_MULTIPLIER) >> table->_shift);
+}
+
+CF_INLINE CFIndex
+GSHashTableProbeLength (GSHashTableRef table, CFIndex idx, CFHashCode hash)
+{
+  return (idx - GSHashTableHomeIndex (table, hash)) & (table->_capacity - 1);
+}
+
+/* A perfect hash table for n keys has about 1.5% spare buckets.  Without
+   them, placing the last few keys would take about n tries each. */
+#define GSHASHTABLE_PERFECT_SIZE(n) ((n) + ((n) >> 6) + 1)
+
+/* Keys are placed in groups of about four. */
+#define GSHASHTABLE_PERFECT_GROUPS(size) (((size) + 3) / 4)
+
+/* Smallest immutable table to build with a perfect hash. */
+#define GSHASHTABLE_PERFECT_MIN 64
+
+CF_INLINE UInt64
+GSHashTablePerfectMix (CFHashCode hash)
+{
+  UInt64 h = (UInt64)hash;
+
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/* Maps a 32-bit value onto [0, n) with a multiply instead of a division. */
+CF_INLINE CFIndex
+GSHashTablePerfectReduce (UInt32 x, CFIndex n)
+{
+  return (CFIndex) (((UInt64)x * (UInt64)n) >> 32);
+}
+
+/* A key is described by its group and two 32-bit values f1 and f2, all
+ * taken from one mix of its hash.  Displacement d sends it to the slot for
+ * f1 + d * f2, so trying another displacement is cheap.
+ */
+CF_INLINE CFIndex
+GSHashTablePerfectKey (CFHashCode hash, CFIndex size, UInt32 *f1, UInt32 *f2)
+{
+  UInt64 h = GSHashTablePerfectMix (hash);
+
+  *f1 = (UInt32)h;
+  *f2 = (UInt32)((h * 0x9E3779B97F4A7C15ULL) >> 32) | 1;
+  return GSHashTablePerfectReduce ((UInt32)(h >> 32),
+                                   GSHASHTABLE_PERFECT_GROUPS (size));
+}
+
+CF_INLINE CFIndex
+GSHashTablePerfectSlot (UInt32 f1, UInt32 f2, UInt32 d, CFIndex size)
+{
+  return GSHashTablePerfectReduce (f1 + d * f2, size);
+}
+
+/* The displacements are stored after the buckets. */
+CF_INLINE UInt16 *
+GSHashTablePerfectDisplacements (GSHashTableRef table)
+{
+  return (UInt16 *) (table->_buckets + table->_capacity);
+}
+
+CF_INLINE GSHashTableBucket *
+GSHashTablePerfectFindBucket (GSHashTableRef table, const void *key,
+                              CFHashCode hash, GSHashTableEqualCallBack fEqual)
+{
+  CFIndex size = table->_capacity;
+  CFIndex group;
+  UInt32 f1;
+  UInt32 f2;
+  UInt32 d;
+  GSHashTableBucket *bucket;
+
+  group = GSHashTablePerfectKey (hash, size, &f1, &f2);
+  d = GSHashTablePerfectDisplacements (table)[group];
+  bucket = &table->_buckets[GSHashTablePerfectSlot (f1, f2, d, size)];
+
+  return (bucket->count > 0 && bucket->hash == hash
+          && fEqual (key, bucket->key)) ? bucket : NULL;
+}
+
 static GSHashTableBucket *
-GSHashTableFindBucket (GSHashTableRef table, const void *key,
-                       _kGSHashTableOperation operation)
+GSHashTableFindBucketWithHash (GSHashTableRef table, const void *key,
+                               CFHashCode hash)
 {
   GSHashTableBucket *buckets;
-  CFIndex capacity;
-  CFIndex initialIdx, idx;
-  CFHashCode hash;
-  Boolean matched;
-  GSHashTableHashCallBack fHash = table->_keyCallBacks.hash;
+  CFIndex mask;
+  CFIndex idx;
+  CFIndex dist;
   GSHashTableEqualCallBack fEqual = table->_keyCallBacks.equal;
   
   if (!fEqual)
     fEqual = GSHashTableEqualPointers;
 
+  if (GSHashTableIsPerfect (table))
+    return GSHashTablePerfectFindBucket (table, key, hash, fEqual);
+
   buckets = table->_buckets;
-  capacity = table->_capacity;
-  hash = fHash ? fHash (key) : GSHashPointer (key);
-  initialIdx = idx = hash % capacity;
-  matched = GSHashTableBucketIsUnoccupied(buckets[idx], operation)
-            || (buckets[idx].key && fEqual (key, buckets[idx].key));
+  mask = table->_capacity - 1;
+  idx = GSHashTableHomeIndex (table, hash);
+  dist = 0;
+
+  /* The table is never full, so there is always an empty bucket to stop
+     at.  A bucket that is closer to its home than we are to ours means
+     the key would have been placed before it. */
+  while (buckets[idx].count > 0
+         && GSHashTableProbeLength (table, idx, buckets[idx].hash) >= dist)
+    {
+      if (buckets[idx].hash == hash && fEqual (key, buckets[idx].key))
+        return &buckets[idx];
+      idx = (idx + 1) & mask;
+      ++dist;
+    }
+  
+  return NULL;
+}
+
+CF_INLINE GSHashTableBucket *
+GSHashTableFindBucket (GSHashTableRef table, const void *key)
+{
+  return GSHashTableFindBucketWithHash (table, key,
+                                        GSHashTableHashKey (table, key));
+}
+
+/* Returns the empty bucket where a key with this hash, which must not
+ * already be in the table, belongs.  The keys from that bucket up to the
+ * next empty one are moved down one place to make room.
+ */
+static GSHashTableBucket *
+GSHashTableInsertBucket (GSHashTableRef table, CFHashCode hash)
+{
+  GSHashTableBucket *buckets;
+  CFIndex mask;
+  CFIndex idx;
+  CFIndex dist;
+
+  buckets = table->_buckets;
+  mask = table->_capacity - 1;
+  idx = GSHashTableHomeIndex (table, hash);
+  dist = 0;
+
+  while (buckets[idx].count > 0
+         && GSHashTableProbeLength (table, idx, buckets[idx].hash) >= dist)
+    {
+      idx = (idx + 1) & mask;
+      ++dist;
+    }
 
-  if (!matched)
+  if (buckets[idx].count > 0)
     {
-      CFHashCode hash2 = 1 + ((hash / capacity) % (capacity - 1));
+      CFIndex last = idx;
       
       do
+        last = (last + 1) & mask;
+      while (buckets[last].count > 0);
+
+      while (last != idx)
         {
-          hash += hash2;
-          idx = hash % capacity;
-          matched = GSHashTableBucketIsUnoccupied(buckets[idx], operation)
-                    || (buckets[idx].key && fEqual (key, buckets[idx].key));
+          CFIndex prev = (last - 1) & mask;
+          buckets[last] = buckets[prev];
+          last = prev;
         }
-      while (!matched && idx != initialIdx);
+      memset (&buckets[idx], 0, sizeof (GSHashTableBucket));
     }
-
-  // match should be NULL for _kGSHashTableRetrieve ONLY
-  assert(matched || operation == _kGSHashTableRetrieve);
   
-  return matched ? &buckets[idx] : NULL;
+  return &buckets[idx];
 }
 
+/* Fills the hole left by an emptied bucket by moving the keys after it
+ * back one place, stopping at an empty bucket or a key at its home.
+ */
+static void
+GSHashTableShiftBack (GSHashTableRef table, GSHashTableBucket * bucket)
+{
+  GSHashTableBucket *buckets;
+  CFIndex mask;
+  CFIndex idx;
+  CFIndex next;
 
+  buckets = table->_buckets;
+  mask = table->_capacity - 1;
+  idx = bucket - buckets;
+  next = (idx + 1) & mask;
 
-/* Go as close to INT_MAX as we can. */
-static CFIndex _kGSHashTableSizes[] = {
-  7, 13, 29, 59, 127, 257, 521, 1049, 2099, 4201,
-  8419, 16843, 33703, 67409, 134837, 269683, 539389,
-  1078787, 2157587, 4315183, 8630387, 17260781, 34521589,
-  69043189, 138086407, 276172823, 552345671, 1104691373
-};
+  while (buckets[next].count > 0
+         && GSHashTableProbeLength (table, next, buckets[next].hash) > 0)
+    {
+      buckets[idx] = buckets[next];
+      idx = next;
+      next = (next + 1) & mask;
+    }
+  memset (&buckets[idx], 0, sizeof (GSHashTableBucket));
+}
 
-static CFIndex _kGSHashTableSizesCount =
-  sizeof (_kGSHashTableSizes) / sizeof (CFIndex);
 
-/* Calculted 80% of values above. */
-static CFIndex _kGSHashTableFilled[] = {
-  5, 10, 23, 47, 101, 205, 416, 839, 2099, 3360,
-  6735, 13474, 26962, 53927, 107869, 215746, 431511,
-  863029, 1726069, 3452146, 6904309, 13808624, 27617271,
-  55234551, 110469125, 220938258, 441876536, 883753098
-};
+
+#define GSHASHTABLE_MIN_SIZE 8
+
+/* The number of buckets that may be used in a table of the given size. */
+#define GSHASHTABLE_FILLED(s) ((s) - ((s) >> 3))
 
 CF_INLINE CFIndex
 GSHashTableGetSize (CFIndex min)
 {
-  CFIndex idx = 0;
-  while (min > _kGSHashTableFilled[idx] && idx < _kGSHashTableSizesCount)
-    ++idx;
-  return _kGSHashTableSizes[idx];
+  CFIndex size = GSHASHTABLE_MIN_SIZE;
+  while (min > GSHASHTABLE_FILLED (size))
+    size <<= 1;
+  return size;
+}
+
+CF_INLINE void
+GSHashTableSetCapacity (GSHashTableRef table, CFIndex capacity)
+{
+  CFIndex shift = sizeof (CFHashCode) * 8;
+
+  table->_capacity = capacity;
+  while (capacity > 1)
+    {
+      capacity >>= 1;
+      --shift;
+    }
+  table->_shift = shift;
 }
 
 #define GSHASHTABLE_EXTRA (sizeof(struct GSHashTable) - sizeof(CFRuntimeBase))
 #define GET_ARRAY_SIZE(s) ((s) * sizeof(GSHashTableBucket))
 
+/* Largest group of keys given a displacement; bigger groups mean
+   the hash codes are poorly distributed, so we give up. */
+#define GSHASHTABLE_PERFECT_MAX_GROUP 64
+
+/* Finds a displacement for every group so that the entries, which must
+ * have distinct keys, land in distinct slots of a table with size
+ * buckets.  Returns false if there is none.
+ */
+static Boolean
+GSHashTablePerfectPlace (CFAllocatorRef alloc,
+                         const GSHashTableBucket * entries, CFIndex n,
+                         CFIndex size, UInt16 * displacements,
+                         CFIndex * slots)
+{
+  CFIndex groups = GSHASHTABLE_PERFECT_GROUPS (size);
+  CFIndex *groupOf;
+  UInt32 *f;
+  CFIndex *start;
+  CFIndex *members;
+  UInt8 *taken;
+  CFIndex maxCount;
+  CFIndex count;
+  CFIndex idx;
+  Boolean success = true;
+
+  groupOf = CFAllocatorAllocate (alloc, sizeof (CFIndex) * n, 0);
+  f = CFAllocatorAllocate (alloc, sizeof (UInt32) * 2 * n, 0);
+  start = CFAllocatorAllocate (alloc, sizeof (CFIndex) * (groups + 1), 0);
+  members = CFAllocatorAllocate (alloc, sizeof (CFIndex) * n, 0);
+  taken = CFAllocatorAllocate (alloc, (size + 7) / 8, 0);
+  memset (start, 0, sizeof (CFIndex) * (groups + 1));
+  memset (taken, 0, (size + 7) / 8);
+
+  /* Sort the entries by group. */
+  for (idx = 0; idx < n; ++idx)
+    {
+      groupOf[idx] = GSHashTablePerfectKey (entries[idx].hash, size,
+                                            &f[2 * idx], &f[2 * idx + 1]);
+      start[groupOf[idx] + 1] += 1;
+    }
+  maxCount = 0;
+  for (idx = 0; idx < groups; ++idx)
+    {
+      maxCount = GS_MAX (maxCount, start[idx + 1]);
+      start[idx + 1] += start[idx];
+    }
+  for (idx = 0; idx < n; ++idx)
+    members[start[groupOf[idx]]++] = idx;
+  for (idx = groups; idx > 0; --idx)
+    start[idx] = start[idx - 1];
+  start[0] = 0;
+  if (maxCount > GSHASHTABLE_PERFECT_MAX_GROUP)
+    success = false;
+
+  /* Place the largest groups first, while most slots are still free. */
+  memset (displacements, 0, sizeof (UInt16) * groups);
+  for (count = maxCount; success && count > 0; --count)
+    {
+      for (idx = 0; success && idx < groups; ++idx)
+        {
+          CFIndex *group = &members[start[idx]];
+          UInt32 f1[GSHASHTABLE_PERFECT_MAX_GROUP];
+          UInt32 f2[GSHASHTABLE_PERFECT_MAX_GROUP];
+          CFIndex slot[GSHASHTABLE_PERFECT_MAX_GROUP];
+          CFIndex j;
+          CFIndex k;
+          UInt32 d;
+
+          if (start[idx + 1] - start[idx] != count)
+            continue;
+
+          for (j = 0; j < count; ++j)
+            {
+              f1[j] = f[2 * group[j]];
+              f2[j] = f[2 * group[j] + 1];
+              /* Equal hash codes always collide. */
+              for (k = 0; k < j; ++k)
+                if (entries[group[j]].hash == entries[group[k]].hash)
+                  success = false;
+            }
+
+          for (d = 0; success; ++d)
+            {
+              if (d > 0xFFFF)
+                {
+                  success = false;
+                  break;
+                }
+              for (j = 0; j < count; ++j)
+                {
+                  slot[j] = GSHashTablePerfectSlot (f1[j], f2[j], d, size);
+                  if (taken[slot[j] >> 3] & (1 << (slot[j] & 7)))
+                    break;
+                  taken[slot[j] >> 3] |= (1 << (slot[j] & 7));
+                }
+              if (j == count)
+                {
+                  displacements[idx] = (UInt16)d;
+                  for (j = 0; j < count; ++j)
+                    slots[group[j]] = slot[j];
+                  break;
+                }
+              /* Undo the partial placement. */
+              for (k = 0; k < j; ++k)
+                taken[slot[k] >> 3] &= ~(1 << (slot[k] & 7));
+            }
+        }
+    }
+
+  CFAllocatorDeallocate (alloc, groupOf);
+  CFAllocatorDeallocate (alloc, f);
+  CFAllocatorDeallocate (alloc, start);
+  CFAllocatorDeallocate (alloc, members);
+  CFAllocatorDeallocate (alloc, taken);
+
+  return success;
+}
+
+/* Creates an immutable table holding the given entries with a perfect
+ * hash.  Returns NULL if no perfect hash could be found.
+ */
+static GSHashTableRef
+GSHashTableCreatePerfect (CFAllocatorRef alloc, CFTypeID typeID,
+                          const GSHashTableBucket * entries, CFIndex n,
+                          const GSHashTableKeyCallBacks * keyCallBacks,
+                          const GSHashTableValueCallBacks * valueCallBacks)
+{
+  CFIndex size = GSHASHTABLE_PERFECT_SIZE (n);
+  CFIndex groups = GSHASHTABLE_PERFECT_GROUPS (size);
+  UInt16 *displacements;
+  CFIndex *slots;
+  GSHashTableRef new = NULL;
+
+  if (size > 0x7FFFFFFF)
+    return NULL;
+
+  displacements = CFAllocatorAllocate (alloc, sizeof (UInt16) * groups, 0);
+  slots = CFAllocatorAllocate (alloc, sizeof (CFIndex) * n, 0);
+
+  if (GSHashTablePerfectPlace (alloc, entries, n, size, displacements, slots))
+    {
+      new = (GSHashTableRef) _CFRuntimeCreateInstance (alloc, typeID,
+        GSHASHTABLE_EXTRA + GET_ARRAY_SIZE (size) + sizeof (UInt16) * groups,
+        NULL);
+    }
+  if (new)
+    {
+      CFIndex idx;
+
+      new->_allocator = alloc ? alloc : CFAllocatorGetDefault ();
+      new->_buckets = (GSHashTableBucket *) & (new[1]);
+      new->_capacity = size;
+      memcpy (&new->_keyCallBacks, keyCallBacks,
+              sizeof (GSHashTableKeyCallBacks));
+      memcpy (&new->_valueCallBacks, valueCallBacks,
+              sizeof (GSHashTableValueCallBacks));
+      memcpy (GSHashTablePerfectDisplacements (new), displacements,
+              sizeof (UInt16) * groups);
+
+      for (idx = 0; idx < n; ++idx)
+        {
+          GSHashTableBucket *bucket = &new->_buckets[slots[idx]];
+
+          GSHashTableAddKeyValuePair (new, bucket, entries[idx].key,
+                                      entries[idx].value, entries[idx].hash);
+          bucket->count = entries[idx].count;
+        }
+      new->_count = n;
+      GSHashTableSetPerfect (new);
+    }
+
+  CFAllocatorDeallocate (alloc, displacements);
+  CFAllocatorDeallocate (alloc, slots);
+
+  return new;
+}
+
 GSHashTableRef
 GSHashTableCreate (CFAllocatorRef alloc, CFTypeID typeID,
                    const void **keys, const void **values, CFIndex numValues,
@@ -274,6 +627,33 @@ GSHashTableCreate (CFAllocatorRef alloc, CFTypeID typeID,
   CFIndex capacity;
   GSHashTableRef new;
 
+  if (keyCallBacks == NULL)
+    keyCallBacks = &_kGSNullHashTableKeyCallBacks;
+  if (valueCallBacks == NULL)
+    valueCallBacks = &_kGSNullHashTableValueCallBacks;
+
+  if (keys != NULL && numValues >= GSHASHTABLE_PERFECT_MIN)
+    {
+      GSHashTableBucket *entries;
+      GSHashTableHashCallBack fHash = keyCallBacks->hash;
+      CFIndex idx;
+
+      entries = CFAllocatorAllocate (alloc, GET_ARRAY_SIZE (numValues), 0);
+      for (idx = 0; idx < numValues; ++idx)
+        {
+          entries[idx].count = 1;
+          entries[idx].hash = fHash ? fHash (keys[idx])
+                                    : GSHashPointer (keys[idx]);
+          entries[idx].key = keys[idx];
+          entries[idx].value = values[idx];
+        }
+      new = GSHashTableCreatePerfect (alloc, typeID, entries, numValues,
+                                      keyCallBacks, valueCallBacks);
+      CFAllocatorDeallocate (alloc, entries);
+      if (new)
+        return new;
+    }
+
   capacity = GSHashTableGetSize (numValues);
   arraySize = GET_ARRAY_SIZE (capacity);
 
@@ -285,15 +665,10 @@ GSHashTableCreate (CFAllocatorRef alloc, CFTypeID typeID,
       CFIndex idx;
       GSHashTableBucket *bucket;
 
-      new->_allocator = alloc;
+      new->_allocator = alloc ? alloc : CFAllocatorGetDefault ();
       new->_buckets = (GSHashTableBucket *) & (new[1]);
 
-      new->_capacity = capacity;
-
-      if (keyCallBacks == NULL)
-        keyCallBacks = &_kGSNullHashTableKeyCallBacks;
-      if (valueCallBacks == NULL)
-        valueCallBacks = &_kGSNullHashTableValueCallBacks;
+      GSHashTableSetCapacity (new, capacity);
 
       memcpy (&new->_keyCallBacks, keyCallBacks,
               sizeof (GSHashTableKeyCallBacks));
@@ -304,9 +679,20 @@ GSHashTableCreate (CFAllocatorRef alloc, CFTypeID typeID,
         {
           for (idx = 0; idx < numValues; ++idx)
             {
-              bucket = GSHashTableFindBucket (new, keys[idx],
-                                              _kGSHashTableInsert);
-              GSHashTableAddKeyValuePair (new, bucket, keys[idx], values[idx]);
+              CFHashCode hash = GSHashTableHashKey (new, keys[idx]);
+
+              bucket = GSHashTableFindBucketWithHash (new, keys[idx], hash);
+              if (bucket)
+                {
+                  /* A repeated key is counted once more. */
+                  bucket->count += 1;
+                }
+              else
+                {
+                  bucket = GSHashTableInsertBucket (new, hash);
+                  GSHashTableAddKeyValuePair (new, bucket, keys[idx],
+                                              values[idx], hash);
+                }
               new->_count += 1;
             }
         }
@@ -315,6 +701,29 @@ GSHashTableCreate (CFAllocatorRef alloc, CFTypeID typeID,
   return new;
 }
 
+/* Adds every key and value in table to new, which must be empty and big
+ * enough to hold them.
+ */
+static void
+GSHashTableCopyBuckets (GSHashTableRef new, GSHashTableRef table)
+{
+  CFIndex idx;
+  GSHashTableBucket *bucket;
+  GSHashTableBucket *buckets = table->_buckets;
+
+  for (idx = 0; idx < table->_capacity; ++idx)
+    {
+      if (buckets[idx].count > 0)
+        {
+          bucket = GSHashTableInsertBucket (new, buckets[idx].hash);
+          GSHashTableAddKeyValuePair (new, bucket, buckets[idx].key,
+                                      buckets[idx].value, buckets[idx].hash);
+          bucket->count = buckets[idx].count;
+          new->_count += 1;
+        }
+    }
+}
+
 GSHashTableRef
 GSHashTableCreateCopy (CFAllocatorRef alloc, GSHashTableRef table)
 {
@@ -322,27 +731,32 @@ GSHashTableCreateCopy (CFAllocatorRef alloc, GSHashTableRef table)
   GSHashTableRef new;
 
   count = GSHashTableGetCount (table);
-  new = GSHashTableCreate (alloc, CFGetTypeID (table), NULL, NULL,
-                           count, &table->_keyCallBacks,
-                           &table->_valueCallBacks);
-  if (new)
+  if (GSHashTableIsPerfect (table) || count >= GSHASHTABLE_PERFECT_MIN)
     {
+      GSHashTableBucket *entries;
       CFIndex idx;
-      GSHashTableBucket *bucket;
-      GSHashTableBucket *buckets = table->_buckets;
+      CFIndex n = 0;
+
+      entries = CFAllocatorAllocate (alloc, GET_ARRAY_SIZE (count), 0);
       for (idx = 0; idx < table->_capacity; ++idx)
         {
-          if (buckets[idx].key)
-            {
-              bucket = GSHashTableFindBucket (new, buckets[idx].key,
-                                              _kGSHashTableInsert);
-              GSHashTableAddKeyValuePair (new, bucket, buckets[idx].key,
-                                          buckets[idx].value);
-              new->_count += 1;
-            }
+          if (table->_buckets[idx].count > 0)
+            entries[n++] = table->_buckets[idx];
         }
+      new = GSHashTableCreatePerfect (alloc, CFGetTypeID (table), entries, n,
+                                      &table->_keyCallBacks,
+                                      &table->_valueCallBacks);
+      CFAllocatorDeallocate (alloc, entries);
+      if (new)
+        return new;
     }
 
+  new = GSHashTableCreate (alloc, CFGetTypeID (table), NULL, NULL,
+                           count, &table->_keyCallBacks,
+                           &table->_valueCallBacks);
+  if (new)
+    GSHashTableCopyBuckets (new, table);
+
   return new;
 }
 
@@ -379,8 +793,7 @@ GSHashTableEqual (GSHashTableRef table1, GSHashTableRef table2)
         {
           if (current->count > 0)
             {
-              other = GSHashTableFindBucket (table2, current->key,
-                                             _kGSHashTableRetrieve);
+              other = GSHashTableFindBucket (table2, current->key);
               if (!other
                   || current->count != other->count
                   || !keyEqual (current->key, other->key)
@@ -405,10 +818,7 @@ GSHashTableHash (GSHashTableRef table)
 Boolean
 GSHashTableContainsKey (GSHashTableRef table, const void *key)
 {
-  GSHashTableBucket *bucket;
-  bucket = GSHashTableFindBucket (table, key, _kGSHashTableRetrieve);
-
-  return bucket ? (bucket->count > 0 ? true : false) : false;
+  return GSHashTableFindBucket (table, key) ? true : false;
 }
 
 Boolean
@@ -423,7 +833,7 @@ GSHashTableContainsValue (GSHashTableRef table, const void *value)
 
   for (idx = 0; idx < table->_capacity; ++idx)
     {
-      if (buckets[idx].key)
+      if (buckets[idx].count > 0)
         {
           if (equal (value, buckets[idx].value))
             return true;
@@ -442,7 +852,7 @@ CFIndex
 GSHashTableGetCountOfKey (GSHashTableRef table, const void *key)
 {
   GSHashTableBucket *bucket;
-  bucket = GSHashTableFindBucket (table, key, _kGSHashTableRetrieve);
+  bucket = GSHashTableFindBucket (table, key);
 
   return bucket ? bucket->count : 0;
 }
@@ -460,7 +870,7 @@ GSHashTableGetCountOfValue (GSHashTableRef table, const void *value)
 
   for (idx = 0; idx < table->_capacity; ++idx)
     {
-      if (buckets[idx].key)
+      if (buckets[idx].count > 0)
         {
           if (equal (value, buckets[idx].value))
             count += buckets[idx].count;
@@ -513,12 +923,76 @@ const void *
 GSHashTableGetValue (GSHashTableRef table, const void *key)
 {
   GSHashTableBucket *bucket;
-  bucket = GSHashTableFindBucket (table, key, _kGSHashTableRetrieve);
+  bucket = GSHashTableFindBucket (table, key);
   
   return bucket ? bucket->value : NULL;
 }
 
 
+/* Number of keys hashed and prefetched together by
+ * GSHashTableGetValuesForKeys().
+ */
+#define GSHASHTABLE_BATCH 16
+
+#if defined(__GNUC__)
+#define GSHashTablePrefetch(addr) __builtin_prefetch ((addr), 0)
+#else
+#define GSHashTablePrefetch(addr)
+#endif
+
+CFIndex
+GSHashTableGetValuesForKeys (GSHashTableRef table, const void **keys,
+                             CFIndex count, const void **values,
+                             Boolean *present)
+{
+  CFHashCode hashes[GSHASHTABLE_BATCH];
+  CFIndex found = 0;
+  CFIndex start;
+
+  /* Hash a batch of keys and start loading their home buckets before
+     probing any of them, so the cache misses overlap. */
+  for (start = 0; start < count; start += GSHASHTABLE_BATCH)
+    {
+      CFIndex n = GS_MIN (count - start, GSHASHTABLE_BATCH);
+      CFIndex idx;
+
+      for (idx = 0; idx < n; ++idx)
+        {
+          hashes[idx] = GSHashTableHashKey (table, keys[start + idx]);
+          if (GSHashTableIsPerfect (table))
+            {
+              UInt32 f1;
+              UInt32 f2;
+              CFIndex group;
+
+              group = GSHashTablePerfectKey (hashes[idx], table->_capacity,
+                                             &f1, &f2);
+              GSHashTablePrefetch (&GSHashTablePerfectDisplacements (table)
+                                   [group]);
+            }
+          else
+            GSHashTablePrefetch (&table->_buckets[GSHashTableHomeIndex (table,
+                                                         hashes[idx])]);
+        }
+      for (idx = 0; idx < n; ++idx)
+        {
+          GSHashTableBucket *bucket;
+
+          bucket = GSHashTableFindBucketWithHash (table, keys[start + idx],
+                                                  hashes[idx]);
+          if (values)
+            values[start + idx] = bucket ? bucket->value : NULL;
+          if (present)
+            present[start + idx] = bucket ? true : false;
+          if (bucket)
+            found += 1;
+        }
+    }
+
+  return found;
+}
+
+
 
 static void
 GSHashTableRehash (GSHashTableRef table, CFIndex newCapacity)
@@ -531,19 +1005,19 @@ GSHashTableRehash (GSHashTableRef table, CFIndex newCapacity)
   oldSize = table->_capacity;
   oldBuckets = table->_buckets;
 
-  table->_capacity = newCapacity;
+  GSHashTableSetCapacity (table, newCapacity);
   table->_buckets = CFAllocatorAllocate (table->_allocator,
                                          GET_ARRAY_SIZE (newCapacity), 0);
   memset (table->_buckets, 0, GET_ARRAY_SIZE (newCapacity));
 
   for (idx = 0; idx < oldSize; ++idx)
     {
-      if (oldBuckets[idx].key)
+      if (oldBuckets[idx].count > 0)
         {
-          bucket = GSHashTableFindBucket (table, oldBuckets[idx].key,
-                                          _kGSHashTableInsert);
-          GSHashTableAddKeyValuePair (table, bucket, oldBuckets[idx].key,
-                                      oldBuckets[idx].value);
+          /* The table owns these references already, so move the bucket
+             rather than retaining the key and value a second time. */
+          bucket = GSHashTableInsertBucket (table, oldBuckets[idx].hash);
+          *bucket = oldBuckets[idx];
         }
     }
 
@@ -561,9 +1035,13 @@ GSHashTableGrowIfNeeded (GSHashTableRef table)
 CF_INLINE void
 GSHashTableShrinkIfNeeded (GSHashTableRef table)
 {
-  /* Shrink if count is less than half of capacity) */
+  /* Shrink if count is less than a quarter of capacity. */
   if (table->_count < (table->_capacity >> 2))
-    GSHashTableRehash (table, GSHashTableGetSize (table->_count));
+    {
+      CFIndex newSize = GSHashTableGetSize (table->_count);
+      if (newSize < table->_capacity)
+        GSHashTableRehash (table, newSize);
+    }
 }
 
 GSHashTableRef
@@ -583,11 +1061,13 @@ GSHashTableCreateMutable (CFAllocatorRef allocator,
       capacity = GSHashTableGetSize (capacity);
       arraySize = GET_ARRAY_SIZE (capacity);
 
-      new->_allocator = allocator;
-      new->_buckets = CFAllocatorAllocate (allocator, arraySize, 0);
+      /* Resolve the default now: it is per thread, and the table may
+         grow on another thread. */
+      new->_allocator = allocator ? allocator : CFAllocatorGetDefault ();
+      new->_buckets = CFAllocatorAllocate (new->_allocator, arraySize, 0);
       memset (new->_buckets, 0, arraySize);
 
-      new->_capacity = capacity;
+      GSHashTableSetCapacity (new, capacity);
 
       if (keyCallBacks == NULL)
         keyCallBacks = &_kGSNullHashTableKeyCallBacks;
@@ -617,42 +1097,32 @@ GSHashTableCreateMutableCopy (CFAllocatorRef alloc, GSHashTableRef table,
                                   &table->_keyCallBacks,
                                   &table->_valueCallBacks);
   if (new)
-    {
-      CFIndex idx;
-      GSHashTableBucket *bucket;
-      GSHashTableBucket *buckets = table->_buckets;
-      for (idx = 0; idx < table->_capacity; ++idx)
-        {
-          if (buckets[idx].key)
-            {
-              bucket = GSHashTableFindBucket (new, buckets[idx].key,
-                                              _kGSHashTableInsert);
-              GSHashTableAddKeyValuePair (new, bucket, buckets[idx].key,
-                                          buckets[idx].value);
-              new->_count += 1;
-            }
-        }
-    }
+    GSHashTableCopyBuckets (new, table);
 
   return new;
 }
 
-void
-GSHashTableAddValue (GSHashTableRef table, const void *key, const void *value)
+/* Inserts a key known not to be in the table, growing it if needed. */
+CF_INLINE void
+GSHashTableInsertValue (GSHashTableRef table, const void *key,
+                        const void *value, CFHashCode hash)
 {
   GSHashTableBucket *bucket;
 
   GSHashTableGrowIfNeeded (table);
+  bucket = GSHashTableInsertBucket (table, hash);
+  GSHashTableAddKeyValuePair (table, bucket, key, value, hash);
+  table->_count += 1;
+}
 
-  bucket = GSHashTableFindBucket (table, key, _kGSHashTableRetrieve);
-  if (!bucket)
-    bucket = GSHashTableFindBucket (table, key, _kGSHashTableInsert);
+void
+GSHashTableAddValue (GSHashTableRef table, const void *key, const void *value)
+{
+  CFHashCode hash;
 
-  if (bucket->count <= 0)
-    {
-      GSHashTableAddKeyValuePair (table, bucket, key, value);
-      table->_count += 1;
-    }
+  hash = GSHashTableHashKey (table, key);
+  if (!GSHashTableFindBucketWithHash (table, key, hash))
+    GSHashTableInsertValue (table, key, value, hash);
 }
 
 void
@@ -660,22 +1130,18 @@ GSHashTableAddValueCounted (GSHashTableRef table, const void *key,
                             const void *value)
 {
   GSHashTableBucket *bucket;
+  CFHashCode hash;
 
-  GSHashTableGrowIfNeeded (table);
-
-  bucket = GSHashTableFindBucket (table, key, _kGSHashTableRetrieve);
-  if (!bucket)
-    bucket = GSHashTableFindBucket (table, key, _kGSHashTableInsert);
-
-  if (bucket->count <= 0)
+  hash = GSHashTableHashKey (table, key);
+  bucket = GSHashTableFindBucketWithHash (table, key, hash);
+  if (bucket)
     {
-      GSHashTableAddKeyValuePair (table, bucket, key, value);
-      table->_count += 1;
+      /* Already present: record one more reference. */
+      bucket->count += 1;
     }
   else
     {
-      /* Already present: record one more reference. */
-      bucket->count += 1;
+      GSHashTableInsertValue (table, key, value, hash);
     }
 }
 
@@ -685,8 +1151,8 @@ GSHashTableReplaceValue (GSHashTableRef table, const void *key,
 {
   GSHashTableBucket *bucket;
 
-  bucket = GSHashTableFindBucket (table, key, _kGSHashTableRetrieve);
-  if (bucket && bucket->count > 0)
+  bucket = GSHashTableFindBucket (table, key);
+  if (bucket)
     GSHashTableReplaceKeyValuePair (table, bucket, key, value);
 }
 
@@ -694,22 +1160,14 @@ void
 GSHashTableSetValue (GSHashTableRef table, const void *key, const void *value)
 {
   GSHashTableBucket *bucket;
+  CFHashCode hash;
 
-  GSHashTableGrowIfNeeded (table);
-
-  bucket = GSHashTableFindBucket (table, key, _kGSHashTableRetrieve);
-  if (!bucket)
-    bucket = GSHashTableFindBucket (table, key, _kGSHashTableInsert);
-
-  if (bucket->count > 0)
-    {
-      GSHashTableReplaceKeyValuePair (table, bucket, key, value);
-    }
+  hash = GSHashTableHashKey (table, key);
+  bucket = GSHashTableFindBucketWithHash (table, key, hash);
+  if (bucket)
+    GSHashTableReplaceKeyValuePair (table, bucket, key, value);
   else
-    {
-      GSHashTableAddKeyValuePair (table, bucket, key, value);
-      table->_count += 1;
-    }
+    GSHashTableInsertValue (table, key, value, hash);
 }
 
 void
@@ -721,7 +1179,7 @@ GSHashTableRemoveAll (GSHashTableRef table)
   for (idx = 0; idx < table->_capacity; ++idx)
     {
       if (buckets[idx].count > 0)
-        GSHashTableRemoveKeyValuePair (table, &buckets[idx], 0);
+        GSHashTableRemoveKeyValuePair (table, &buckets[idx]);
     }
   table->_count = 0;
 }
@@ -731,17 +1189,17 @@ GSHashTableRemoveValue (GSHashTableRef table, const void *key)
 {
   GSHashTableBucket *bucket;
 
-  bucket = GSHashTableFindBucket (table, key, _kGSHashTableRetrieve);
+  bucket = GSHashTableFindBucket (table, key);
   if (bucket)
     {
       if (bucket->count > 1)
         {
           bucket->count -= 1;
         }
-      else if (bucket->count == 1)
+      else
         {
-          GSHashTableRemoveKeyValuePair (table, bucket,
-                                         _kGSHashTableBucketCountDeleted);
+          GSHashTableRemoveKeyValuePair (table, bucket);
+          GSHashTableShiftBack (table, bucket);
           table->_count -= 1;
         }
 
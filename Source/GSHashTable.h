@@ -64,6 +64,7 @@ typedef struct GSHashTableBucket GSHashTableBucket;
 struct GSHashTableBucket
 {
   CFIndex count;
+  CFHashCode hash;              /* Full hash of key, valid while count > 0 */
   const void *key;
   const void *value;
 };
@@ -73,7 +74,8 @@ struct GSHashTable
 {
   CFRuntimeBase _parent;
   CFAllocatorRef _allocator;
-  CFIndex _capacity;
+  CFIndex _capacity;            /* Always a power of two */
+  CFIndex _shift;               /* Bits of hash dropped to find a bucket */
   CFIndex _count;
   CFIndex _total;               /* Used for CFBagGetCount() */
   GSHashTableKeyCallBacks _keyCallBacks;
@@ -125,6 +127,15 @@ GSHashTableGetKeysFromCursor (GSHashTableRef table, CFIndex *cursor,
 GS_PRIVATE const void *GSHashTableGetValue (GSHashTableRef table,
                                           const void *key);
 
+/* Looks up count keys at once.  Stores the value of each key, or NULL,
+ * in values and whether it was found in present; either may be NULL.
+ * Returns the number of keys found.
+ */
+GS_PRIVATE CFIndex
+GSHashTableGetValuesForKeys (GSHashTableRef table, const void **keys,
+                             CFIndex count, const void **values,
+                             Boolean *present);
+
 
 
 GS_PRIVATE GSHashTableRef
@@ -62,6 +62,19 @@
 #define GSMutexUnlock(x) LeaveCriticalSection(x)
 #define GSMutexDestroy(x) DeleteCriticalSection(x)
 
+#define GSCondition CONDITION_VARIABLE
+#define GSConditionInitialize(x) InitializeConditionVariable(x)
+#define GSConditionWait(x, m) SleepConditionVariableCS((x), (m), INFINITE)
+#define GSConditionBroadcast(x) WakeAllConditionVariable(x)
+#define GSConditionDestroy(x)
+
+#define GSThreadKey DWORD
+#define GSThreadKeyCreate(k, destructor) \
+  ((*(k) = FlsAlloc((PFLS_CALLBACK_FUNCTION)(destructor))) \
+   == FLS_OUT_OF_INDEXES)
+#define GSThreadKeyGetValue(k) FlsGetValue(k)
+#define GSThreadKeySetValue(k, v) FlsSetValue((k), (v))
+
 #if defined(_WIN64)
 #define GSAtomicIncrementCFIndex(ptr) \
   InterlockedIncrement64((LONGLONG volatile*)(ptr))
@@ -81,6 +94,10 @@
 
 #define GSAtomicCompareAndSwapPointer(ptr, oldv, newv) \
   InterlockedCompareExchangePointer((ptr), (newv), (oldv))
+#define GSAtomicLoadPointer(ptr) \
+  InterlockedCompareExchangePointer((PVOID volatile*)(ptr), NULL, NULL)
+#define GSAtomicStorePointer(ptr, v) \
+  InterlockedExchangePointer((PVOID volatile*)(ptr), (PVOID)(v))
 
 #else /* _WIN32 */
 
@@ -90,6 +107,17 @@
 #define GSMutexUnlock(x) pthread_mutex_unlock(x)
 #define GSMutexDestroy(x) pthread_mutex_destroy(x)
 
+#define GSCondition pthread_cond_t
+#define GSConditionInitialize(x) pthread_cond_init(x, NULL)
+#define GSConditionWait(x, m) pthread_cond_wait((x), (m))
+#define GSConditionBroadcast(x) pthread_cond_broadcast(x)
+#define GSConditionDestroy(x) pthread_cond_destroy(x)
+
+#define GSThreadKey pthread_key_t
+#define GSThreadKeyCreate(k, destructor) pthread_key_create((k), (destructor))
+#define GSThreadKeyGetValue(k) pthread_getspecific(k)
+#define GSThreadKeySetValue(k, v) pthread_setspecific((k), (v))
+
 #if defined(__llvm__) \
       || (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
 
@@ -100,6 +128,21 @@
 #define GSAtomicCompareAndSwapPointer(ptr, oldv, newv) \
   __sync_val_compare_and_swap((void**)(ptr), (void*)(oldv), (void*)(newv))
 
+/* Loads with acquire and stores with release semantics, for publishing
+   data to readers that take no lock. */
+#if defined(__ATOMIC_ACQUIRE)
+#define GSAtomicLoadPointer(ptr) \
+  __atomic_load_n((void**)(ptr), __ATOMIC_ACQUIRE)
+#define GSAtomicStorePointer(ptr, v) \
+  __atomic_store_n((void**)(ptr), (void*)(v), __ATOMIC_RELEASE)
+#else
+#define GSAtomicLoadPointer(ptr) \
+  ({ void *__v = *(void * volatile *)(ptr); __sync_synchronize(); __v; })
+#define GSAtomicStorePointer(ptr, v) \
+  do { __sync_synchronize(); *(void * volatile *)(ptr) = (void*)(v); } \
+  while (0)
+#endif
+
 #endif
 
 #endif /* _WIN32 */
@@ -166,29 +209,41 @@ GSHashPointer (const void *value)
 #endif
 }
 
-CF_INLINE CFHashCode
-GSHashBytes (const void *bytes, CFIndex length)
-{
-  CFHashCode ret = 0;
-  if (length > 0)
-    {
-      register CFIndex idx;
-      register const char *p = bytes;
-      
-      for (idx = 0 ; idx < length ; ++idx)
-        ret = (ret << 5) + ret + p[idx];
-      
-      ret &= 0x0fffffff;
-      if (ret == 0)
-        ret = 0x0fffffff;
-    }
-  else
-    {
-      ret = 0x0ffffffe;
-    }
-  
-  return ret;
-}
+/* A fast 64-bit hash for arbitrary bytes.  See GSFunctions.c. */
+GS_PRIVATE CFHashCode
+GSHashBytes (const void *bytes, CFIndex length);
+
+GS_PRIVATE void
+GSHashInitialize (void);
+
+/* These hash UTF-16 code units rather than bytes, so the result does not
+ * depend on the byte order or on how the characters are stored; the 8-bit
+ * variants widen each character on the fly and give the same result as
+ * hashing the equivalent UTF-16 characters.
+ *
+ * A string may be hashed in pieces: start with GSHashCharactersStart(),
+ * pass every piece but the last to an Update function, and the last one to
+ * a Finish function along with the total length.  All pieces but the last
+ * must be a multiple of GS_HASH_CHARACTERS_BLOCK characters long.
+ */
+#define GS_HASH_CHARACTERS_BLOCK 8
+
+GS_PRIVATE UInt64
+GSHashCharactersStart (void);
+
+GS_PRIVATE UInt64
+GSHashCharactersUpdate (UInt64 state, const UniChar *chars, CFIndex length);
+
+GS_PRIVATE UInt64
+GSHashCharacters8Update (UInt64 state, const UInt8 *chars, CFIndex length);
+
+GS_PRIVATE CFHashCode
+GSHashCharactersFinish (UInt64 state, const UniChar *chars, CFIndex length,
+                        CFIndex totalLength);
+
+GS_PRIVATE CFHashCode
+GSHashCharacters8Finish (UInt64 state, const UInt8 *chars, CFIndex length,
+                         CFIndex totalLength);
 
 
 
@@ -261,12 +316,27 @@ GSStringGetFileSystemEncoding (void)
 const char *
 CFLocaleGetCStringIdentifier (CFLocaleRef locale, char *buf, CFIndex maxlen);
 
+/* Creates a buffer, allocated from alloc, holding the collation keys of
+   count strings back to back.  The key for strings[i] starts at offsets[i]
+   and ends at offsets[i + 1], so offsets must have room for count + 1
+   values.  Returns NULL if memory could not be allocated.
+ */
+GS_PRIVATE UInt8 *
+GSStringCreateCollationKeys (CFAllocatorRef alloc, const void **strings,
+                             CFIndex count, CFStringCompareFlags options,
+                             CFLocaleRef locale, CFIndex *offsets);
+
 void
 GSRuntimeConstantInit (CFTypeRef cf, CFTypeID typeID);
 
 void
 GSRuntimeDeallocateInstance (CFTypeRef cf);
 
+/* Returns true for an arena allocator that CFAllocatorArenaRelease() has
+   been called on.  Objects in such an arena are not finalized. */
+GS_PRIVATE Boolean
+GSAllocatorIsDying (CFAllocatorRef allocator);
+
 #define GS_MAX(a,b) (a > b ? a : b)
 #define GS_MIN(a,b) (a < b ? a : b)
 
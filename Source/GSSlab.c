@@ -0,0 +1,415 @@
+/* GSSlab.c
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep CoreBase Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the
+   Free Software Foundation, 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "CoreFoundation/CFBase.h"
+#include "GSSlab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Chunks are aligned to their size, so the chunk holding a block is found
+   by masking its address. */
+#define GSSLAB_CHUNK_SHIFT 18
+#define GSSLAB_CHUNK_SIZE ((uintptr_t)1 << GSSLAB_CHUNK_SHIFT)
+#define GSSLAB_CHUNK_HEADER 64
+#define GSSLAB_CLASSES 16
+/* Number of blocks moved between a thread and the depot at once.  A
+   thread holds at most twice this many free blocks of each size. */
+#define GSSLAB_MAGAZINE 32
+/* Chunks are never returned, and the registry of chunks is sized for
+   about 1.5GB of them. */
+#define GSSLAB_REGISTRY_SIZE 8192
+#define GSSLAB_REGISTRY_LIMIT (GSSLAB_REGISTRY_SIZE * 3 / 4)
+
+static const UInt16 _kGSSlabClassSize[GSSLAB_CLASSES] =
+{
+  16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512
+};
+
+/* Indexed by (size + 15) / 16. */
+static const UInt8 _kGSSlabClassForSize[GSSLAB_MAX_SIZE / 16 + 1] =
+{
+  0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11,
+  12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15, 15
+};
+
+typedef struct GSSlabChunk GSSlabChunk;
+struct GSSlabChunk
+{
+  UInt32 sizeClass;
+  /* The blocks start at GSSLAB_CHUNK_HEADER. */
+};
+
+/* Free blocks are linked through their first word.  While a magazine
+   sits in the depot, the second word of its first block links it to the
+   next magazine. */
+typedef struct GSSlabDepot GSSlabDepot;
+struct GSSlabDepot
+{
+  GSMutex lock;
+  void  **magazines;
+  char   *next;                 /* Uncarved part of the current chunk */
+  char   *end;
+};
+
+typedef struct GSSlabCache GSSlabCache;
+struct GSSlabCache
+{
+  void  **head[GSSLAB_CLASSES];
+  CFIndex count[GSSLAB_CLASSES];
+};
+
+static GSSlabDepot _kGSSlabDepot[GSSLAB_CLASSES];
+
+static GSMutex _kGSSlabRegistryLock;
+static void *_kGSSlabRegistry[GSSLAB_REGISTRY_SIZE];
+static CFIndex _kGSSlabRegistryCount = 0;
+
+static GSThreadKey _kGSSlabCacheKey;
+static Boolean _kGSSlabCacheKeyValid = false;
+
+
+
+CF_INLINE CFIndex
+GSSlabRegistryHash (void *chunk)
+{
+  return (CFIndex)(GSHashInt64 ((UInt64)(uintptr_t)chunk
+    >> GSSLAB_CHUNK_SHIFT) & (GSSLAB_REGISTRY_SIZE - 1));
+}
+
+/* Entries are only ever added, so readers take no lock. */
+CF_INLINE Boolean
+GSSlabRegistryContains (void *chunk)
+{
+  CFIndex idx;
+  void *entry;
+
+  idx = GSSlabRegistryHash (chunk);
+  while ((entry = GSAtomicLoadPointer (&_kGSSlabRegistry[idx])) != NULL)
+    {
+      if (entry == chunk)
+        return true;
+      idx = (idx + 1) & (GSSLAB_REGISTRY_SIZE - 1);
+    }
+
+  return false;
+}
+
+static Boolean
+GSSlabRegistryAdd (void *chunk)
+{
+  CFIndex idx;
+  Boolean added = false;
+
+  GSMutexLock (&_kGSSlabRegistryLock);
+  if (_kGSSlabRegistryCount < GSSLAB_REGISTRY_LIMIT)
+    {
+      idx = GSSlabRegistryHash (chunk);
+      while (_kGSSlabRegistry[idx] != NULL)
+        idx = (idx + 1) & (GSSLAB_REGISTRY_SIZE - 1);
+      GSAtomicStorePointer (&_kGSSlabRegistry[idx], chunk);
+      _kGSSlabRegistryCount += 1;
+      added = true;
+    }
+  GSMutexUnlock (&_kGSSlabRegistryLock);
+
+  return added;
+}
+
+static GSSlabChunk *
+GSSlabChunkCreate (UInt32 sizeClass)
+{
+  GSSlabChunk *chunk;
+
+#if defined(_WIN32)
+  chunk = _aligned_malloc (GSSLAB_CHUNK_SIZE, GSSLAB_CHUNK_SIZE);
+#else
+  if (posix_memalign ((void **)&chunk, GSSLAB_CHUNK_SIZE,
+                      GSSLAB_CHUNK_SIZE) != 0)
+    chunk = NULL;
+#endif
+  if (chunk == NULL)
+    return NULL;
+
+  chunk->sizeClass = sizeClass;
+  if (!GSSlabRegistryAdd (chunk))
+    {
+#if defined(_WIN32)
+      _aligned_free (chunk);
+#else
+      free (chunk);
+#endif
+      return NULL;
+    }
+
+  return chunk;
+}
+
+
+
+/* Takes a magazine from the depot, or carves a new one out of the current
+   chunk.  Returns NULL if there is no memory left for this size. */
+static void **
+GSSlabDepotTake (UInt32 sizeClass)
+{
+  GSSlabDepot *depot = &_kGSSlabDepot[sizeClass];
+  CFIndex size = _kGSSlabClassSize[sizeClass];
+  void **magazine;
+  void **block;
+  CFIndex count;
+  CFIndex idx;
+
+  GSMutexLock (&depot->lock);
+  magazine = depot->magazines;
+  if (magazine)
+    {
+      depot->magazines = magazine[1];
+      GSMutexUnlock (&depot->lock);
+      return magazine;
+    }
+
+  if (depot->next == depot->end)
+    {
+      GSSlabChunk *chunk = GSSlabChunkCreate (sizeClass);
+
+      if (chunk == NULL)
+        {
+          GSMutexUnlock (&depot->lock);
+          return NULL;
+        }
+      depot->next = (char *)chunk + GSSLAB_CHUNK_HEADER;
+      depot->end = depot->next + (GSSLAB_CHUNK_SIZE - GSSLAB_CHUNK_HEADER)
+        / size * size;
+    }
+
+  count = (depot->end - depot->next) / size;
+  if (count > GSSLAB_MAGAZINE)
+    count = GSSLAB_MAGAZINE;
+  magazine = (void **)depot->next;
+  depot->next += count * size;
+  GSMutexUnlock (&depot->lock);
+
+  block = magazine;
+  for (idx = 1 ; idx < count ; ++idx)
+    {
+      *block = (char *)block + size;
+      block = *block;
+    }
+  *block = NULL;
+
+  return magazine;
+}
+
+static void
+GSSlabDepotPut (UInt32 sizeClass, void **magazine)
+{
+  GSSlabDepot *depot = &_kGSSlabDepot[sizeClass];
+
+  GSMutexLock (&depot->lock);
+  magazine[1] = depot->magazines;
+  depot->magazines = magazine;
+  GSMutexUnlock (&depot->lock);
+}
+
+/* Hands a list of free blocks back to the depot a magazine at a time. */
+static void
+GSSlabDepotPutList (UInt32 sizeClass, void **list)
+{
+  void **magazine;
+  void **block;
+  CFIndex count;
+
+  while (list)
+    {
+      magazine = list;
+      block = list;
+      for (count = 1 ; count < GSSLAB_MAGAZINE && *block ; ++count)
+        block = *block;
+      list = *block;
+      *block = NULL;
+      GSSlabDepotPut (sizeClass, magazine);
+    }
+}
+
+static void
+GSSlabCacheDestroy (void *data)
+{
+  GSSlabCache *cache = data;
+  UInt32 sizeClass;
+
+  for (sizeClass = 0 ; sizeClass < GSSLAB_CLASSES ; ++sizeClass)
+    GSSlabDepotPutList (sizeClass, cache->head[sizeClass]);
+  free (cache);
+}
+
+static GSSlabCache *
+GSSlabCacheGet (void)
+{
+  GSSlabCache *cache;
+
+  if (!_kGSSlabCacheKeyValid)
+    return NULL;
+
+  cache = GSThreadKeyGetValue (_kGSSlabCacheKey);
+  if (cache == NULL)
+    {
+      cache = calloc (1, sizeof(GSSlabCache));
+      if (cache != NULL)
+        GSThreadKeySetValue (_kGSSlabCacheKey, cache);
+    }
+
+  return cache;
+}
+
+void
+GSSlabInitialize (void)
+{
+  UInt32 sizeClass;
+
+  GSMutexInitialize (&_kGSSlabRegistryLock);
+  for (sizeClass = 0 ; sizeClass < GSSLAB_CLASSES ; ++sizeClass)
+    GSMutexInitialize (&_kGSSlabDepot[sizeClass].lock);
+  if (GSThreadKeyCreate (&_kGSSlabCacheKey, GSSlabCacheDestroy) == 0)
+    _kGSSlabCacheKeyValid = true;
+}
+
+
+
+void *
+GSSlabAllocate (CFIndex size, CFOptionFlags hint, void *info)
+{
+  GSSlabCache *cache;
+  UInt32 sizeClass;
+  void **block;
+
+  if (size < 0 || size > GSSLAB_MAX_SIZE)
+    return malloc (size);
+  sizeClass = _kGSSlabClassForSize[(size + 15) >> 4];
+
+  cache = GSSlabCacheGet ();
+  if (cache == NULL)
+    {
+      block = GSSlabDepotTake (sizeClass);
+      if (block == NULL)
+        return malloc (size);
+      if (*block)
+        GSSlabDepotPut (sizeClass, *block);
+      return block;
+    }
+
+  block = cache->head[sizeClass];
+  if (block == NULL)
+    {
+      block = GSSlabDepotTake (sizeClass);
+      if (block == NULL)
+        return malloc (size);
+      /* Magazines that were not full are counted as full; the count only
+         decides when to give blocks back. */
+      cache->count[sizeClass] = GSSLAB_MAGAZINE;
+    }
+  cache->head[sizeClass] = *block;
+  if (cache->count[sizeClass] > 0)
+    cache->count[sizeClass] -= 1;
+
+  return block;
+}
+
+void
+GSSlabDeallocate (void *ptr, void *info)
+{
+  GSSlabChunk *chunk;
+  GSSlabCache *cache;
+  UInt32 sizeClass;
+  void **block = ptr;
+  void **last;
+  CFIndex count;
+
+  chunk = (GSSlabChunk *)((uintptr_t)ptr & ~(GSSLAB_CHUNK_SIZE - 1));
+  if (!GSSlabRegistryContains (chunk))
+    {
+      free (ptr);
+      return;
+    }
+  sizeClass = chunk->sizeClass;
+
+  cache = GSSlabCacheGet ();
+  if (cache == NULL)
+    {
+      *block = NULL;
+      GSSlabDepotPut (sizeClass, block);
+      return;
+    }
+
+  *block = cache->head[sizeClass];
+  cache->head[sizeClass] = block;
+  cache->count[sizeClass] += 1;
+
+  /* Keep the blocks freed last, which are likely still in the cache, and
+     give the older ones back. */
+  if (cache->count[sizeClass] >= 2 * GSSLAB_MAGAZINE)
+    {
+      last = block;
+      for (count = 1 ; count < GSSLAB_MAGAZINE && *last ; ++count)
+        last = *last;
+      block = *last;
+      *last = NULL;
+      cache->count[sizeClass] = GSSLAB_MAGAZINE;
+      if (block)
+        GSSlabDepotPutList (sizeClass, block);
+    }
+}
+
+void *
+GSSlabReallocate (void *ptr, CFIndex newsize, CFOptionFlags hint, void *info)
+{
+  GSSlabChunk *chunk;
+  CFIndex size;
+  void *new;
+
+  if (ptr == NULL)
+    return GSSlabAllocate (newsize, hint, info);
+
+  chunk = (GSSlabChunk *)((uintptr_t)ptr & ~(GSSLAB_CHUNK_SIZE - 1));
+  if (!GSSlabRegistryContains (chunk))
+    return realloc (ptr, newsize);
+
+  size = _kGSSlabClassSize[chunk->sizeClass];
+  if (newsize <= size)
+    return ptr;
+  new = GSSlabAllocate (newsize, hint, info);
+  if (new)
+    {
+      memcpy (new, ptr, size);
+      GSSlabDeallocate (ptr, info);
+    }
+
+  return new;
+}
+
+CFIndex
+GSSlabPreferredSize (CFIndex size, CFOptionFlags hint, void *info)
+{
+  if (size < 0 || size > GSSLAB_MAX_SIZE)
+    return size;
+  return _kGSSlabClassSize[_kGSSlabClassForSize[(size + 15) >> 4]];
+}
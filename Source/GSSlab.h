@@ -0,0 +1,57 @@
+/* GSSlab.h
+
+   Copyright (C) 2026 Free Software Foundation, Inc.
+
+   This file is part of the GNUstep CoreBase Library.
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the
+   Free Software Foundation, 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __GSSLAB_H__
+#define __GSSLAB_H__
+
+#include "config.h"
+
+#include "CoreFoundation/CFBase.h"
+#include "GSPrivate.h"
+
+/* A size-class allocator for small blocks.  Blocks of up to
+ * GSSLAB_MAX_SIZE bytes are rounded up to one of a few sizes and carved
+ * out of chunks that each hold one size.  Every thread keeps a short list
+ * of free blocks of each size and trades them with a shared depot a
+ * magazine at a time, so most allocations take no lock.  Larger blocks
+ * come from malloc.  These functions have the signatures of the
+ * CFAllocatorContext callbacks.
+ */
+#define GSSLAB_MAX_SIZE 512
+
+GS_PRIVATE void
+GSSlabInitialize (void);
+
+GS_PRIVATE void *
+GSSlabAllocate (CFIndex size, CFOptionFlags hint, void *info);
+
+GS_PRIVATE void *
+GSSlabReallocate (void *ptr, CFIndex newsize, CFOptionFlags hint, void *info);
+
+GS_PRIVATE void
+GSSlabDeallocate (void *ptr, void *info);
+
+GS_PRIVATE CFIndex
+GSSlabPreferredSize (CFIndex size, CFOptionFlags hint, void *info);
+
+#endif /* __GSSLAB_H__ */
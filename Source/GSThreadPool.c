@@ -0,0 +1,213 @@
+/* GSThreadPool.c
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "GSThreadPool.h"
+
+#include <stdlib.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#define GSTHREADPOOL_MAX_THREADS 16
+
+static GSMutex _kGSThreadPoolJobLock;   /* Held while a job runs */
+static GSMutex _kGSThreadPoolLock;      /* Protects the variables below */
+static GSCondition _kGSThreadPoolWork;
+static GSCondition _kGSThreadPoolDone;
+static CFIndex _kGSThreadPoolThreads = 1;
+static CFIndex _kGSThreadPoolWorkers = -1;      /* -1 until started */
+static CFIndex _kGSThreadPoolGeneration = 0;
+static CFIndex _kGSThreadPoolFinished = 0;
+static GSThreadPoolFunction _kGSThreadPoolFunc;
+static void *_kGSThreadPoolContext;
+static CFIndex _kGSThreadPoolCount;
+static CFIndex _kGSThreadPoolNext;      /* Next index to hand out */
+
+/* Calls the job's function for indexes that no other thread has taken. */
+static void
+GSThreadPoolWork (GSThreadPoolFunction func, void *context, CFIndex count)
+{
+  CFIndex idx;
+
+  while ((idx = GSAtomicIncrementCFIndex (&_kGSThreadPoolNext) - 1) < count)
+    func (context, idx);
+}
+
+#if defined(_WIN32)
+static DWORD WINAPI
+#else
+static void *
+#endif
+GSThreadPoolWorker (void *arg)
+{
+  CFIndex seen = 0;
+
+  GSMutexLock (&_kGSThreadPoolLock);
+  while (true)
+    {
+      GSThreadPoolFunction func;
+      void *context;
+      CFIndex count;
+
+      while (_kGSThreadPoolGeneration == seen)
+        GSConditionWait (&_kGSThreadPoolWork, &_kGSThreadPoolLock);
+      seen = _kGSThreadPoolGeneration;
+      func = _kGSThreadPoolFunc;
+      context = _kGSThreadPoolContext;
+      count = _kGSThreadPoolCount;
+      GSMutexUnlock (&_kGSThreadPoolLock);
+
+      GSThreadPoolWork (func, context, count);
+
+      /* The caller waits for every worker, so none can still be reading
+         this job's index when the next job resets it. */
+      GSMutexLock (&_kGSThreadPoolLock);
+      if (++_kGSThreadPoolFinished == _kGSThreadPoolWorkers)
+        GSConditionBroadcast (&_kGSThreadPoolDone);
+    }
+
+  return 0;
+}
+
+/* Must be called with _kGSThreadPoolLock held. */
+static void
+GSThreadPoolStart (void)
+{
+  CFIndex idx;
+
+  _kGSThreadPoolWorkers = 0;
+  for (idx = 1; idx < _kGSThreadPoolThreads; ++idx)
+    {
+#if defined(_WIN32)
+      HANDLE thread;
+
+      thread = CreateThread (NULL, 0, GSThreadPoolWorker, NULL, 0, NULL);
+      if (thread == NULL)
+        break;
+      CloseHandle (thread);
+#else
+      pthread_t thread;
+
+      if (pthread_create (&thread, NULL, GSThreadPoolWorker, NULL) != 0)
+        break;
+      pthread_detach (thread);
+#endif
+      ++_kGSThreadPoolWorkers;
+    }
+}
+
+#if !defined(_WIN32)
+/* Only the thread that called fork() exists in the child, so the pool
+   goes back to the state it had before it was started. */
+static void
+GSThreadPoolAfterFork (void)
+{
+  GSMutexInitialize (&_kGSThreadPoolJobLock);
+  GSMutexInitialize (&_kGSThreadPoolLock);
+  GSConditionInitialize (&_kGSThreadPoolWork);
+  GSConditionInitialize (&_kGSThreadPoolDone);
+  _kGSThreadPoolWorkers = -1;
+  _kGSThreadPoolGeneration = 0;
+  _kGSThreadPoolFinished = 0;
+}
+#endif
+
+void
+GSThreadPoolInitialize (void)
+{
+  const char *threads;
+  CFIndex count = 1;
+
+  GSMutexInitialize (&_kGSThreadPoolJobLock);
+  GSMutexInitialize (&_kGSThreadPoolLock);
+  GSConditionInitialize (&_kGSThreadPoolWork);
+  GSConditionInitialize (&_kGSThreadPoolDone);
+#if !defined(_WIN32)
+  pthread_atfork (NULL, NULL, GSThreadPoolAfterFork);
+#endif
+
+  threads = getenv ("GNUSTEP_COREBASE_THREADS");
+  if (threads != NULL)
+    {
+      count = strtol (threads, NULL, 10);
+    }
+  else
+    {
+#if defined(_WIN32)
+      SYSTEM_INFO info;
+
+      GetSystemInfo (&info);
+      count = info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+      count = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+    }
+
+  if (count < 1)
+    count = 1;
+  else if (count > GSTHREADPOOL_MAX_THREADS)
+    count = GSTHREADPOOL_MAX_THREADS;
+  _kGSThreadPoolThreads = count;
+}
+
+CFIndex
+GSThreadPoolGetThreadCount (void)
+{
+  return _kGSThreadPoolThreads;
+}
+
+void
+GSThreadPoolApply (CFIndex count, GSThreadPoolFunction func, void *context)
+{
+  CFIndex idx;
+
+  if (count < 2 || _kGSThreadPoolThreads < 2)
+    {
+      for (idx = 0; idx < count; ++idx)
+        func (context, idx);
+      return;
+    }
+
+  GSMutexLock (&_kGSThreadPoolJobLock);
+
+  GSMutexLock (&_kGSThreadPoolLock);
+  if (_kGSThreadPoolWorkers < 0)
+    GSThreadPoolStart ();
+  _kGSThreadPoolFunc = func;
+  _kGSThreadPoolContext = context;
+  _kGSThreadPoolCount = count;
+  _kGSThreadPoolNext = 0;
+  _kGSThreadPoolFinished = 0;
+  _kGSThreadPoolGeneration += 1;
+  GSConditionBroadcast (&_kGSThreadPoolWork);
+  GSMutexUnlock (&_kGSThreadPoolLock);
+
+  GSThreadPoolWork (func, context, count);
+
+  GSMutexLock (&_kGSThreadPoolLock);
+  while (_kGSThreadPoolFinished < _kGSThreadPoolWorkers)
+    GSConditionWait (&_kGSThreadPoolDone, &_kGSThreadPoolLock);
+  GSMutexUnlock (&_kGSThreadPoolLock);
+
+  GSMutexUnlock (&_kGSThreadPoolJobLock);
+}
@@ -0,0 +1,55 @@
+/* GSThreadPool.h
+   
+   Copyright (C) 2026 Free Software Foundation, Inc.
+   
+   This file is part of the GNUstep CoreBase Library.
+   
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Lesser General Public
+   License as published by the Free Software Foundation; either
+   version 2.1 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with this library; see the file COPYING.LIB.
+   If not, see <http://www.gnu.org/licenses/> or write to the 
+   Free Software Foundation, 51 Franklin Street, Fifth Floor, 
+   Boston, MA 02110-1301, USA.
+*/
+
+#ifndef __GSTHREADPOOL__
+#define __GSTHREADPOOL__ 1
+
+#include "CoreFoundation/CFBase.h"
+#include "GSPrivate.h"
+
+/* A small pool of worker threads for splitting work over several cores.
+ * The number of threads, including the one that hands out the work,
+ * defaults to the number of processors (at most 16) and can be set with
+ * the GNUSTEP_COREBASE_THREADS environment variable.  The workers are
+ * started the first time they are needed and live as long as the process.
+ * A child process made with fork() starts its own workers when it needs
+ * them.
+ */
+
+typedef void (*GSThreadPoolFunction) (void *context, CFIndex idx);
+
+GS_PRIVATE void GSThreadPoolInitialize (void);
+
+/* Returns the number of threads that share the work of
+   GSThreadPoolApply(), including the calling thread. */
+GS_PRIVATE CFIndex GSThreadPoolGetThreadCount (void);
+
+/* Calls func for every idx from 0 to count - 1, spread over the pool's
+ * threads and the calling thread, and returns once all calls have
+ * returned.  func must be safe to call from several threads at once.
+ * Only one job runs at a time; other callers wait for it to finish.
+ */
+GS_PRIVATE void
+GSThreadPoolApply (CFIndex count, GSThreadPoolFunction func, void *context);
+
+#endif /* __GSTHREADPOOL__ */
@@ -0,0 +1,154 @@
+#include "CoreFoundation/CFArray.h"
+#include "CoreFoundation/CFBase.h"
+#include "CoreFoundation/CFString.h"
+#include "CoreFoundation/CFTree.h"
+#include "../CFTesting.h"
+
+#include <string.h>
+
+static CFIndex treeReleases = 0;
+static CFIndex infoRetains = 0;
+static CFIndex infoReleases = 0;
+static CFIndex allocations = 0;
+static CFIndex deallocations = 0;
+
+static void
+releaseTreeInfo (const void *info)
+{
+  treeReleases += 1;
+}
+
+static const void *
+retainInfo (const void *info)
+{
+  infoRetains += 1;
+  return info;
+}
+
+static void
+releaseInfo (const void *info)
+{
+  infoReleases += 1;
+}
+
+static void *
+mallocAllocate (CFIndex size, CFOptionFlags hint, void *info)
+{
+  allocations += 1;
+  return CFAllocatorAllocate (kCFAllocatorMalloc, size, hint);
+}
+
+static void *
+mallocReallocate (void *ptr, CFIndex size, CFOptionFlags hint, void *info)
+{
+  return CFAllocatorReallocate (kCFAllocatorMalloc, ptr, size, hint);
+}
+
+static void
+mallocDeallocate (void *ptr, void *info)
+{
+  deallocations += 1;
+  CFAllocatorDeallocate (kCFAllocatorMalloc, ptr);
+}
+
+int main (void)
+{
+  CFTreeContext treeContext = { 0, NULL, NULL, releaseTreeInfo, NULL };
+  CFAllocatorContext context = { 0, NULL, retainInfo, releaseInfo, NULL,
+    mallocAllocate, mallocReallocate, mallocDeallocate, NULL };
+  CFAllocatorRef arena;
+  CFAllocatorRef custom;
+  CFMutableArrayRef array;
+  CFStringRef str;
+  CFTreeRef tree;
+  UInt8 *ptrs[1000];
+  UInt8 *ptr;
+  CFIndex count;
+  CFIndex idx;
+  Boolean ok;
+
+  arena = CFAllocatorCreateArena (NULL, 256);
+  PASS_CF(arena != NULL, "Arena allocator created");
+
+  ok = true;
+  for (idx = 0 ; idx < 1000 ; ++idx)
+    {
+      ptrs[idx] = CFAllocatorAllocate (arena, idx % 100 + 1, 0);
+      if (((uintptr_t)ptrs[idx] & 15) != 0)
+        ok = false;
+      memset (ptrs[idx], (int)(idx & 0xFF), idx % 100 + 1);
+    }
+  for (idx = 0 ; idx < 1000 ; ++idx)
+    if (ptrs[idx][idx % 100] != (UInt8)(idx & 0xFF))
+      ok = false;
+  PASS_CF(ok, "Arena blocks are aligned and do not overlap");
+
+  ptr = CFAllocatorAllocate (arena, 10, 0);
+  memcpy (ptr, "0123456789", 10);
+  ptr = CFAllocatorReallocate (arena, ptr, 100, 0);
+  ok = ptr != NULL && memcmp (ptr, "0123456789", 10) == 0;
+  CFAllocatorAllocate (arena, 10, 0);
+  ptr = CFAllocatorReallocate (arena, ptr, 5000, 0);
+  ok = ok && ptr != NULL && memcmp (ptr, "0123456789", 10) == 0;
+  PASS_CF(ok, "Reallocating in an arena keeps the contents");
+
+  array = CFArrayCreateMutable (arena, 0, &kCFTypeArrayCallBacks);
+  for (idx = 0 ; idx < 1000 ; ++idx)
+    {
+      str = CFStringCreateWithFormat (arena, NULL, CFSTR("item %ld"),
+        (long)idx);
+      CFArrayAppendValue (array, str);
+      CFRelease (str);
+    }
+  PASS_CF(CFArrayGetCount (array) == 1000
+    && CFEqual (CFArrayGetValueAtIndex (array, 999), CFSTR("item 999")),
+    "Objects can be built in an arena");
+
+  CFAllocatorArenaReset (arena);
+  str = CFStringCreateWithCString (arena, "after reset",
+    kCFStringEncodingASCII);
+  PASS_CF(CFEqual (str, CFSTR("after reset")), "Arena is usable after reset");
+
+  tree = CFTreeCreate (arena, &treeContext);
+  CFRelease (tree);
+  PASS_CF(treeReleases == 1, "Objects in a live arena are finalized");
+
+  /* Another reference keeps the arena alive after it is released. */
+  tree = CFTreeCreate (arena, &treeContext);
+  CFRetain (arena);
+  CFAllocatorArenaRelease (arena);
+  CFRelease (tree);
+  PASS_CF(treeReleases == 1, "Objects in a dying arena are not finalized");
+  CFRelease (arena);
+
+  custom = CFAllocatorCreate (NULL, &context);
+  PASS_CF(infoRetains == 1, "CFAllocatorCreate() retains the context info");
+
+  /* An oversized block followed by a smaller one. */
+  arena = CFAllocatorCreateArena (custom, 256);
+  CFAllocatorAllocate (arena, 100000, 0);
+  CFAllocatorAllocate (arena, 300, 0);
+  CFAllocatorArenaReset (arena);
+  count = allocations;
+  CFAllocatorAllocate (arena, 50000, 0);
+  PASS_CF(allocations == count, "Resetting an arena keeps its largest block");
+
+  /* Releasing the last reference is the last use of the arena. */
+  array = CFArrayCreateMutable (arena, 0, &kCFTypeArrayCallBacks);
+  for (idx = 0 ; idx < 1000 ; ++idx)
+    {
+      str = CFStringCreateWithFormat (arena, NULL, CFSTR("item %ld"),
+        (long)idx);
+      CFArrayAppendValue (array, str);
+      CFRelease (str);
+    }
+  tree = CFTreeCreate (arena, &treeContext);
+  CFAllocatorArenaRelease (arena);
+  PASS_CF(allocations == deallocations && treeReleases == 1,
+    "Releasing an arena frees all of its memory without finalizing");
+
+  CFRelease (custom);
+  PASS_CF(infoReleases == 1, "Deallocating an allocator releases its info");
+
+  return 0;
+}
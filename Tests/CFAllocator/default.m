@@ -0,0 +1,190 @@
+#include "CoreFoundation/CFBase.h"
+#include "CoreFoundation/CFCharacterSet.h"
+#include "CoreFoundation/CFDictionary.h"
+#include "CoreFoundation/CFString.h"
+#include "CoreFoundation/CFTimeZone.h"
+#include "../CFTesting.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static CFIndex outstanding = 0;
+
+/* Overwrites memory as it is freed, so that anything still using it
+   fails. */
+static void *
+scribbleAllocate (CFIndex size, CFOptionFlags hint, void *info)
+{
+  CFIndex *block = malloc (size + 16);
+
+  if (block == NULL)
+    return NULL;
+  *block = size;
+  outstanding += 1;
+  return (char *)block + 16;
+}
+
+static void
+scribbleDeallocate (void *ptr, void *info)
+{
+  char *block = (char *)ptr - 16;
+
+  memset (ptr, 0xAB, *(CFIndex *)block);
+  free (block);
+  outstanding -= 1;
+}
+
+/* Makes an arena the default, then releases it. */
+static CFAllocatorRef
+beginArena (CFAllocatorRef allocator)
+{
+  CFAllocatorRef arena;
+
+  arena = CFAllocatorCreateArena (allocator, 0);
+  CFAllocatorSetDefault (arena);
+  return arena;
+}
+
+static void
+endArena (CFAllocatorRef arena)
+{
+  CFAllocatorSetDefault (kCFAllocatorSystemDefault);
+  CFAllocatorArenaRelease (arena);
+}
+
+static CFAllocatorRef seen;
+
+static void *
+getDefault (void *arg)
+{
+  seen = CFAllocatorGetDefault ();
+  return NULL;
+}
+
+/* Sets an arena as the thread's default and checks that objects created
+   with the default allocator come from it. */
+static void *
+useArena (void *arg)
+{
+  CFAllocatorRef arena;
+  CFStringRef str;
+  Boolean *ok = arg;
+
+  arena = CFAllocatorCreateArena (NULL, 0);
+  CFAllocatorSetDefault (arena);
+  str = CFStringCreateWithCString (NULL, "arena", kCFStringEncodingASCII);
+  *ok = CFAllocatorGetDefault () == arena && CFGetAllocator (str) == arena;
+  CFRelease (str);
+  CFRelease (arena);
+  return NULL;
+}
+
+/* Grows a table made on another thread, with a different default. */
+static void *
+fillDictionary (void *arg)
+{
+  CFMutableDictionaryRef dict = arg;
+  uintptr_t idx;
+
+  CFAllocatorSetDefault (kCFAllocatorSystemDefault);
+  for (idx = 1 ; idx <= 1000 ; ++idx)
+    CFDictionarySetValue (dict, (const void *)idx, (const void *)idx);
+  return NULL;
+}
+
+static CFAllocatorRef
+defaultInNewThread (void)
+{
+  pthread_t thread;
+
+  seen = NULL;
+  pthread_create (&thread, NULL, getDefault, NULL);
+  pthread_join (thread, NULL);
+  return seen;
+}
+
+int main (void)
+{
+  CFAllocatorContext context = { 0, NULL, NULL, NULL, NULL,
+    scribbleAllocate, NULL, scribbleDeallocate, NULL };
+  CFAllocatorRef scribble;
+  CFAllocatorRef arena;
+  CFMutableDictionaryRef dict;
+  CFCharacterSetRef set;
+  CFTimeZoneRef tz;
+  pthread_t thread;
+  Boolean ok = false;
+
+  PASS_CF(CFAllocatorGetDefault () == kCFAllocatorSystemDefault,
+    "The default allocator starts as the system default");
+
+  arena = CFAllocatorCreateArena (NULL, 0);
+  CFAllocatorSetDefault (arena);
+  PASS_CF(CFAllocatorGetDefault () == arena,
+    "CFAllocatorSetDefault() changes the thread's default");
+  PASS_CF(defaultInNewThread () == kCFAllocatorSystemDefault,
+    "Other threads keep the process default");
+
+  pthread_create (&thread, NULL, useArena, &ok);
+  pthread_join (thread, NULL);
+  PASS_CF(ok, "A thread can make an arena its default");
+  PASS_CF(CFAllocatorGetDefault () == arena,
+    "Another thread's default does not change this thread's");
+
+  CFAllocatorSetProcessDefault (kCFAllocatorSlab);
+  PASS_CF(defaultInNewThread () == kCFAllocatorSlab,
+    "New threads use the process default");
+  PASS_CF(CFAllocatorGetDefault () == arena,
+    "The process default does not override the thread's own default");
+
+  CFAllocatorSetDefault (kCFAllocatorSlab);
+  dict = CFDictionaryCreateMutable (NULL, 0, NULL, NULL);
+  pthread_create (&thread, NULL, fillDictionary, dict);
+  pthread_join (thread, NULL);
+  PASS_CF(CFDictionaryGetCount (dict) == 1000
+    && CFGetAllocator (dict) == kCFAllocatorSlab,
+    "A table grown on another thread keeps the allocator it was made with");
+  CFAllocatorSetDefault (kCFAllocatorSystemDefault);
+  CFRelease (dict);
+  CFRelease (arena);
+
+  /* Process-wide caches filled while an arena is the default must not
+     use memory from the arena. */
+  scribble = CFAllocatorCreate (kCFAllocatorSystemDefault, &context);
+  arena = beginArena (scribble);
+  CFStringGetLength (CFSTR("cached while an arena is the default"));
+  endArena (arena);
+  PASS_CF(outstanding == 0
+    && CFStringGetLength (CFSTR("cached while an arena is the default")) == 36,
+    "A CFSTR outlives the arena that was the default");
+
+  arena = beginArena (scribble);
+  CFCharacterSetGetPredefined (kCFCharacterSetNewline);
+  endArena (arena);
+  set = CFCharacterSetGetPredefined (kCFCharacterSetNewline);
+  PASS_CF(outstanding == 0 && CFCharacterSetIsCharacterMember (set, '\n'),
+    "A predefined character set outlives the arena that was the default");
+
+  arena = beginArena (scribble);
+  tz = CFTimeZoneCreateWithTimeIntervalFromGMT (NULL, 3600.0);
+  CFRelease (tz);
+  endArena (arena);
+  tz = CFTimeZoneCreateWithTimeIntervalFromGMT (NULL, 3600.0);
+  PASS_CF(outstanding == 0 && CFTimeZoneGetSecondsFromGMT (tz, 0.0) == 3600.0,
+    "A cached time zone outlives the arena that was the default");
+  CFRelease (tz);
+
+  arena = CFAllocatorCreateArena (scribble, 0);
+  tz = CFTimeZoneCreateWithTimeIntervalFromGMT (arena, 7200.0);
+  CFRelease (tz);
+  CFAllocatorArenaRelease (arena);
+  tz = CFTimeZoneCreateWithTimeIntervalFromGMT (NULL, 7200.0);
+  PASS_CF(outstanding == 0 && CFTimeZoneGetSecondsFromGMT (tz, 0.0) == 7200.0,
+    "A cached time zone outlives the arena it was created with");
+  CFRelease (tz);
+  CFRelease (scribble);
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "CoreFoundation/CFBase.h"
+#include "CoreFoundation/CFData.h"
+#include "CoreFoundation/CFNumber.h"
+#include "CoreFoundation/CFString.h"
+#include "../CFTesting.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#define THREADS 4
+#define BLOCKS 10000
+
+static void *blocks[THREADS][BLOCKS];
+
+static void *
+allocateBlocks (void *arg)
+{
+  void **list = arg;
+  CFIndex idx;
+
+  for (idx = 0 ; idx < BLOCKS ; ++idx)
+    {
+      list[idx] = CFAllocatorAllocate (kCFAllocatorSlab, 8 + idx % 600, 0);
+      memset (list[idx], (int)(idx & 0xFF), 8);
+    }
+  return NULL;
+}
+
+/* Frees the blocks another thread allocated. */
+static void *
+deallocateBlocks (void *arg)
+{
+  void **list = arg;
+  CFIndex idx;
+
+  for (idx = 0 ; idx < BLOCKS ; ++idx)
+    CFAllocatorDeallocate (kCFAllocatorSlab, list[idx]);
+  return NULL;
+}
+
+int main (void)
+{
+  pthread_t threads[THREADS];
+  UInt8 *ptrs[64];
+  UInt8 *ptr;
+  CFNumberRef num;
+  CFStringRef str;
+  CFDataRef data;
+  CFIndex size;
+  CFIndex idx;
+  CFIndex t;
+  Boolean ok;
+
+  ok = true;
+  for (size = 0 ; size <= 600 ; ++size)
+    {
+      if (CFAllocatorGetPreferredSizeForSize (kCFAllocatorSlab, size, 0)
+          < size)
+        ok = false;
+      ptr = CFAllocatorAllocate (kCFAllocatorSlab, size, 0);
+      if (ptr == NULL || ((uintptr_t)ptr & 15) != 0)
+        ok = false;
+      memset (ptr, 0xAB, size);
+      CFAllocatorDeallocate (kCFAllocatorSlab, ptr);
+    }
+  PASS_CF(ok, "Blocks of every size are allocated and aligned");
+
+  for (idx = 0 ; idx < 64 ; ++idx)
+    {
+      ptrs[idx] = CFAllocatorAllocate (kCFAllocatorSlab, 24, 0);
+      memset (ptrs[idx], (int)idx, 24);
+    }
+  ok = true;
+  for (idx = 0 ; idx < 64 ; ++idx)
+    {
+      for (t = 0 ; t < 24 ; ++t)
+        if (ptrs[idx][t] != idx)
+          ok = false;
+      CFAllocatorDeallocate (kCFAllocatorSlab, ptrs[idx]);
+    }
+  PASS_CF(ok, "Live blocks do not overlap");
+
+  ptr = CFAllocatorAllocate (kCFAllocatorSlab, 20, 0);
+  for (idx = 0 ; idx < 20 ; ++idx)
+    ptr[idx] = (UInt8)idx;
+  ptr = CFAllocatorReallocate (kCFAllocatorSlab, ptr, 300, 0);
+  ok = ptr != NULL;
+  for (idx = 0 ; ok && idx < 20 ; ++idx)
+    ok = ptr[idx] == idx;
+  ptr = CFAllocatorReallocate (kCFAllocatorSlab, ptr, 5000, 0);
+  for (idx = 0 ; ok && idx < 20 ; ++idx)
+    ok = ptr[idx] == idx;
+  PASS_CF(ok, "Reallocating keeps the contents");
+  CFAllocatorDeallocate (kCFAllocatorSlab, ptr);
+
+  idx = 42;
+  num = CFNumberCreate (kCFAllocatorSlab, kCFNumberCFIndexType, &idx);
+  str = CFStringCreateWithCString (kCFAllocatorSlab, "slab",
+    kCFStringEncodingASCII);
+  data = CFDataCreate (kCFAllocatorSlab, (const UInt8 *)"slab", 4);
+  PASS_CF(CFGetAllocator (num) == kCFAllocatorSlab,
+    "Objects remember the slab allocator");
+  PASS_CF(CFEqual (str, CFSTR("slab")) && CFDataGetLength (data) == 4,
+    "Objects from the slab allocator work");
+  CFRelease (num);
+  CFRelease (str);
+  CFRelease (data);
+
+  for (t = 0 ; t < THREADS ; ++t)
+    pthread_create (&threads[t], NULL, allocateBlocks, blocks[t]);
+  for (t = 0 ; t < THREADS ; ++t)
+    pthread_join (threads[t], NULL);
+  ok = true;
+  for (t = 0 ; t < THREADS ; ++t)
+    for (idx = 0 ; idx < BLOCKS ; ++idx)
+      if (((UInt8 *)blocks[t][idx])[7] != (UInt8)(idx & 0xFF))
+        ok = false;
+  PASS_CF(ok, "Threads allocate distinct blocks");
+  for (t = 0 ; t < THREADS ; ++t)
+    pthread_create (&threads[t], NULL, deallocateBlocks,
+                    blocks[(t + 1) % THREADS]);
+  for (t = 0 ; t < THREADS ; ++t)
+    pthread_join (threads[t], NULL);
+
+  for (t = 0 ; t < THREADS ; ++t)
+    pthread_create (&threads[t], NULL, allocateBlocks, blocks[t]);
+  for (t = 0 ; t < THREADS ; ++t)
+    pthread_join (threads[t], NULL);
+  ok = true;
+  for (t = 0 ; t < THREADS ; ++t)
+    for (idx = 0 ; idx < BLOCKS ; ++idx)
+      if (((UInt8 *)blocks[t][idx])[7] != (UInt8)(idx & 0xFF))
+        ok = false;
+  PASS_CF(ok, "Blocks freed by another thread are reused safely");
+  for (t = 0 ; t < THREADS ; ++t)
+    deallocateBlocks (blocks[t]);
+
+  return 0;
+}
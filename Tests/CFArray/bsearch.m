@@ -0,0 +1,71 @@
+#include "CoreFoundation/CFArray.h"
+#include "../CFTesting.h"
+
+#define COUNT 1000
+
+static CFComparisonResult
+comp (const void *val1, const void *val2, void *context)
+{
+  return val1 == val2 ? kCFCompareEqualTo : (val1 < val2 ? kCFCompareLessThan :
+    kCFCompareGreaterThan);
+}
+
+/* The first index in range whose value is not less than value. */
+static CFIndex
+lowerBound (CFArrayRef array, CFRange range, CFIndex value)
+{
+  CFIndex idx;
+
+  for (idx = range.location ; idx < range.location + range.length ; ++idx)
+    if ((CFIndex)CFArrayGetValueAtIndex (array, idx) >= value)
+      break;
+  return idx;
+}
+
+int main (void)
+{
+  CFMutableArrayRef array;
+  CFArrayRef indexed;
+  CFRange ranges[] = { { 0, COUNT }, { 0, 0 }, { 10, 1 }, { 123, 456 },
+    { COUNT - 1, 1 } };
+  CFIndex i;
+  CFIndex r;
+  Boolean plainMatches;
+  Boolean indexedMatches;
+
+  /* Every value appears three times: 0, 0, 0, 2, 2, 2, 4, ... */
+  array = CFArrayCreateMutable (NULL, COUNT, NULL);
+  for (i = 0 ; i < COUNT ; ++i)
+    CFArrayAppendValue (array, (const void *)(2 * (i / 3)));
+  indexed = CFArrayCreateCopyWithSearchIndex (NULL, array, comp, NULL);
+  PASS_CF(CFArrayGetCount (indexed) == COUNT
+    && CFArrayGetValueAtIndex (indexed, COUNT - 1)
+    == CFArrayGetValueAtIndex (array, COUNT - 1),
+    "Indexed copy holds the same values.");
+
+  plainMatches = true;
+  indexedMatches = true;
+  for (r = 0 ; r < (CFIndex)(sizeof(ranges) / sizeof(CFRange)) ; ++r)
+    {
+      for (i = 0 ; i <= 2 * (COUNT / 3) + 2 ; ++i)
+        {
+          CFIndex expected = lowerBound (array, ranges[r], i);
+
+          if (CFArrayBSearchValues (array, ranges[r], (const void *)i, comp,
+              NULL) != expected)
+            plainMatches = false;
+          if (CFArrayBSearchValues (indexed, ranges[r], (const void *)i, comp,
+              NULL) != expected)
+            indexedMatches = false;
+        }
+    }
+  PASS_CF(plainMatches, "CFArrayBSearchValues() returns the first value "
+    "not less than the one searched for.");
+  PASS_CF(indexedMatches, "Searching an indexed copy gives the same "
+    "results.");
+
+  CFRelease (indexed);
+  CFRelease (array);
+
+  return 0;
+}
@@ -0,0 +1,47 @@
+#include "CoreFoundation/CFArray.h"
+#include "../CFTesting.h"
+
+#define COUNT 100000
+
+static Boolean
+holdsSequence (CFArrayRef array, CFIndex count)
+{
+  CFIndex i;
+
+  if (CFArrayGetCount (array) != count)
+    return false;
+  for (i = 0; i < count; i++)
+    if ((CFIndex) CFArrayGetValueAtIndex (array, i) != i + 1)
+      return false;
+  return true;
+}
+
+int main (void)
+{
+  CFMutableArrayRef ma;
+  CFIndex i;
+
+  ma = CFArrayCreateMutable (NULL, 0, NULL);
+  for (i = 0; i < COUNT; i++)
+    CFArrayAppendValue (ma, (const void *)(i + 1));
+  PASS_CF(holdsSequence (ma, COUNT), "Appending %d values keeps them in order.",
+    COUNT);
+
+  CFArrayReplaceValues (ma, CFRangeMake (10, COUNT - 10), NULL, 0);
+  CFArrayShrinkToFit (ma);
+  PASS_CF(holdsSequence (ma, 10), "Shrinking keeps the remaining values.");
+
+  CFArrayAppendValue (ma, (const void *)11);
+  PASS_CF(holdsSequence (ma, 11), "A shrunk array grows again.");
+  CFRelease (ma);
+
+  ma = CFArrayCreateMutable (NULL, 0, NULL);
+  CFArrayReserveCapacity (ma, COUNT);
+  CFArrayReserveCapacity (ma, 1);
+  for (i = 0; i < COUNT; i++)
+    CFArrayInsertValueAtIndex (ma, i, (const void *)(i + 1));
+  PASS_CF(holdsSequence (ma, COUNT), "Reserved array holds %d values.", COUNT);
+  CFRelease (ma);
+
+  return 0;
+}
@@ -0,0 +1,58 @@
+#include "CoreFoundation/CFArray.h"
+#include "../CFTesting.h"
+
+#define COUNT 1000
+
+int main (void)
+{
+  CFMutableArrayRef ma;
+  CFIndex i;
+  Boolean ordered;
+
+  /* Use the array as a queue: the values must come out in the order they
+     went in, even after the front has wrapped past the storage many
+     times over. */
+  ma = CFArrayCreateMutable (NULL, 0, NULL);
+  for (i = 0; i < COUNT; i++)
+    CFArrayAppendValue (ma, (const void *)(i + 1));
+  ordered = true;
+  for (i = 0; i < 20 * COUNT; i++)
+    {
+      if ((CFIndex) CFArrayGetValueAtIndex (ma, 0) != i + 1)
+        ordered = false;
+      CFArrayRemoveValueAtIndex (ma, 0);
+      CFArrayAppendValue (ma, (const void *)(i + COUNT + 1));
+    }
+  PASS_CF(ordered && CFArrayGetCount (ma) == COUNT,
+    "Array used as a queue keeps its values in order.");
+  CFRelease (ma);
+
+  /* Insert at the front, remove from the back. */
+  ma = CFArrayCreateMutable (NULL, 0, NULL);
+  for (i = 0; i < COUNT; i++)
+    CFArrayInsertValueAtIndex (ma, 0, (const void *)(i + 1));
+  ordered = true;
+  for (i = 0; i < COUNT; i++)
+    if ((CFIndex) CFArrayGetValueAtIndex (ma, i) != COUNT - i)
+      ordered = false;
+  PASS_CF(ordered, "Inserting at the front keeps values in order.");
+
+  for (i = 0; i < COUNT / 2; i++)
+    CFArrayRemoveValueAtIndex (ma, CFArrayGetCount (ma) - 1);
+  CFArrayInsertValueAtIndex (ma, 10, (const void *)-1);
+  CFArrayRemoveValueAtIndex (ma, 5);
+  ordered = CFArrayGetCount (ma) == COUNT / 2;
+  for (i = 0; i < COUNT / 2; i++)
+    {
+      CFIndex expect = i < 5 ? COUNT - i : (i < 9 ? COUNT - i - 1
+        : (i == 9 ? -1 : COUNT - i));
+      if ((CFIndex) CFArrayGetValueAtIndex (ma, i) != expect)
+        ordered = false;
+    }
+  PASS_CF(ordered, "Inserting and removing near the front moves values "
+    "correctly.");
+
+  CFRelease (ma);
+
+  return 0;
+}
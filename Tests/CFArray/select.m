@@ -0,0 +1,66 @@
+#include "CoreFoundation/CFArray.h"
+#include "../CFTesting.h"
+#include <stdlib.h>
+
+#define COUNT 1000
+
+static CFComparisonResult
+comp (const void *val1, const void *val2, void *context)
+{
+  return val1 == val2 ? kCFCompareEqualTo : (val1 < val2 ? kCFCompareLessThan :
+    kCFCompareGreaterThan);
+}
+
+int main (void)
+{
+  CFMutableArrayRef array;
+  const void *top[10];
+  CFIndex i;
+  CFIndex n;
+  Boolean ordered;
+
+  /* The values are a shuffle of 0 ... COUNT - 1. */
+  array = CFArrayCreateMutable (NULL, COUNT, NULL);
+  for (i = 0 ; i < COUNT ; ++i)
+    CFArrayAppendValue (array, (const void *)i);
+  srand (1);
+  for (i = COUNT - 1 ; i > 0 ; --i)
+    CFArrayExchangeValuesAtIndices (array, i, rand () % (i + 1));
+
+  n = CFArrayGetTopValues (array, CFRangeMake (0, COUNT), 10, comp, NULL,
+                           top);
+  ordered = n == 10;
+  for (i = 0 ; i < n ; ++i)
+    if (top[i] != (const void *)i)
+      ordered = false;
+  PASS_CF(ordered, "CFArrayGetTopValues() returns the smallest values "
+    "in order.");
+
+  ordered = true;
+  n = CFArrayGetTopValues (array, CFRangeMake (5, 3), 10, comp, NULL, top);
+  for (i = 1 ; i < n ; ++i)
+    if (comp (top[i - 1], top[i], NULL) != kCFCompareLessThan)
+      ordered = false;
+  PASS_CF(n == 3 && ordered, "Asking for more values than the range "
+    "holds returns the whole range.");
+
+  CFArraySelectValue (array, CFRangeMake (0, COUNT), 500, comp, NULL);
+  ordered = CFArrayGetValueAtIndex (array, 500) == (const void *)500;
+  for (i = 0 ; i < COUNT ; ++i)
+    {
+      CFIndex v = (CFIndex)CFArrayGetValueAtIndex (array, i);
+
+      if ((i < 500 && v >= 500) || (i > 500 && v <= 500))
+        ordered = false;
+    }
+  PASS_CF(ordered, "CFArraySelectValue() partitions around the value.");
+
+  CFArraySelectValue (array, CFRangeMake (501, COUNT - 501), COUNT - 1, comp,
+                      NULL);
+  PASS_CF(CFArrayGetValueAtIndex (array, COUNT - 1)
+    == (const void *)(COUNT - 1), "Selecting within a range works.");
+
+  CFRelease (array);
+
+  return 0;
+}
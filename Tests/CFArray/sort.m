@@ -0,0 +1,84 @@
+#include "CoreFoundation/CFArray.h"
+#include "../CFTesting.h"
+#include <stdlib.h>
+
+#define COUNT 5000
+
+static CFIndex comparisons;
+
+static CFComparisonResult
+comp (const void *val1, const void *val2, void *context)
+{
+  ++comparisons;
+  return val1 == val2 ? kCFCompareEqualTo : (val1 < val2 ? kCFCompareLessThan :
+    kCFCompareGreaterThan);
+}
+
+static Boolean
+sortedCopyOf (CFArrayRef sorted, const void **values, CFIndex count)
+{
+  CFIndex histogram[COUNT + 1] = { 0 };
+  CFIndex i;
+
+  for (i = 0 ; i < count ; ++i)
+    histogram[(CFIndex)values[i]] += 1;
+  for (i = 0 ; i < count ; ++i)
+    {
+      CFIndex v = (CFIndex)CFArrayGetValueAtIndex (sorted, i);
+
+      if (i > 0 && (CFIndex)CFArrayGetValueAtIndex (sorted, i - 1) > v)
+        return false;
+      histogram[v] -= 1;
+    }
+  for (i = 0 ; i <= COUNT ; ++i)
+    if (histogram[i] != 0)
+      return false;
+  return true;
+}
+
+int main (void)
+{
+  const char *names[] = { "random", "sorted", "reverse", "equal",
+    "few distinct", "organ pipe", "sawtooth" };
+  const void *values[COUNT];
+  CFIndex pattern;
+  CFIndex i;
+
+  srand (1);
+  for (pattern = 0 ; pattern < 7 ; ++pattern)
+    {
+      CFMutableArrayRef array;
+
+      for (i = 0 ; i < COUNT ; ++i)
+        {
+          CFIndex v;
+
+          switch (pattern)
+            {
+              case 0:  v = rand () % COUNT + 1; break;
+              case 1:  v = i + 1; break;
+              case 2:  v = COUNT - i; break;
+              case 3:  v = 7; break;
+              case 4:  v = rand () % 4 + 1; break;
+              case 5:  v = i < COUNT / 2 ? i + 1 : COUNT - i; break;
+              default: v = i % 100 + 1; break;
+            }
+          values[i] = (const void *)v;
+        }
+
+      array = CFArrayCreateMutable (NULL, COUNT, NULL);
+      for (i = 0 ; i < COUNT ; ++i)
+        CFArrayAppendValue (array, values[i]);
+      comparisons = 0;
+      CFArraySortValues (array, CFRangeMake (0, COUNT), comp, NULL);
+      PASS_CF(sortedCopyOf (array, values, COUNT),
+        "Sorting %s input gives a sorted permutation.", names[pattern]);
+      /* 13 > log2(5000); a quadratic sort needs millions. */
+      PASS_CF(comparisons < 3 * 13 * COUNT,
+        "Sorting %s input takes O(n log n) comparisons (%ld).",
+        names[pattern], (long)comparisons);
+      CFRelease (array);
+    }
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "CoreFoundation/CFArray.h"
+#include "../CFTesting.h"
+#include <stdlib.h>
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+/* More than the default threshold, so several threads sort if the
+   machine has several processors. */
+#define COUNT 200000
+
+static CFComparisonResult
+comp (const void *val1, const void *val2, void *context)
+{
+  return val1 == val2 ? kCFCompareEqualTo : (val1 < val2 ? kCFCompareLessThan :
+    kCFCompareGreaterThan);
+}
+
+/* Fills array with COUNT values in reverse order, sorts them and returns
+   whether they came out in order. */
+static Boolean
+sortReversed (CFMutableArrayRef array)
+{
+  CFIndex i;
+
+  CFArrayRemoveAllValues (array);
+  for (i = 0 ; i < COUNT ; ++i)
+    CFArrayAppendValue (array, (const void *)(COUNT - i));
+  CFArraySortValuesConcurrently (array, CFRangeMake (0, COUNT), comp, NULL);
+  for (i = 0 ; i < COUNT ; ++i)
+    if ((CFIndex)CFArrayGetValueAtIndex (array, i) != i + 1)
+      return false;
+  return true;
+}
+
+int main (void)
+{
+  CFMutableArrayRef array;
+  CFIndex histogram[1000] = { 0 };
+  CFIndex i;
+  Boolean ordered;
+  Boolean complete;
+
+  srand (1);
+  array = CFArrayCreateMutable (NULL, COUNT, NULL);
+  for (i = 0 ; i < COUNT ; ++i)
+    {
+      CFIndex v = rand () % 1000;
+
+      histogram[v] += 1;
+      CFArrayAppendValue (array, (const void *)v);
+    }
+
+  CFArraySortValuesConcurrently (array, CFRangeMake (0, COUNT), comp, NULL);
+
+  ordered = true;
+  for (i = 0 ; i < COUNT ; ++i)
+    {
+      CFIndex v = (CFIndex)CFArrayGetValueAtIndex (array, i);
+
+      if (i > 0 && (CFIndex)CFArrayGetValueAtIndex (array, i - 1) > v)
+        ordered = false;
+      histogram[v] -= 1;
+    }
+  complete = true;
+  for (i = 0 ; i < 1000 ; ++i)
+    if (histogram[i] != 0)
+      complete = false;
+  PASS_CF(ordered, "Concurrent sort orders the values.");
+  PASS_CF(complete, "Concurrent sort keeps every value.");
+
+  CFArraySortValuesConcurrently (array, CFRangeMake (10, 100), comp, NULL);
+  PASS_CF(CFArrayGetCount (array) == COUNT,
+    "Sorting a small range works.");
+
+#if !defined(_WIN32)
+  {
+    pid_t pid;
+    int status = 0;
+
+    /* The child has none of the parent's worker threads. */
+    pid = fork ();
+    if (pid == 0)
+      {
+        alarm (30);
+        _exit (sortReversed (array) ? 0 : 1);
+      }
+    waitpid (pid, &status, 0);
+    PASS_CF(pid > 0 && WIFEXITED (status) && WEXITSTATUS (status) == 0,
+      "Concurrent sort works in a child process.");
+  }
+#endif
+  CFRelease (array);
+
+  return 0;
+}
@@ -0,0 +1,72 @@
+#include "CoreFoundation/CFArray.h"
+#include "../CFTesting.h"
+#include <stdlib.h>
+
+#define COUNT 5000
+
+/* Values are (key << 16) | sequence number; only the key is compared. */
+static CFComparisonResult
+compareKeys (const void *val1, const void *val2, void *context)
+{
+  CFIndex k1 = (CFIndex)val1 >> 16;
+  CFIndex k2 = (CFIndex)val2 >> 16;
+
+  return k1 == k2 ? kCFCompareEqualTo : (k1 < k2 ? kCFCompareLessThan :
+    kCFCompareGreaterThan);
+}
+
+static Boolean
+isStablySorted (CFArrayRef array, CFIndex count)
+{
+  CFIndex i;
+
+  if (CFArrayGetCount (array) != count)
+    return false;
+  for (i = 1 ; i < count ; ++i)
+    {
+      CFIndex v1 = (CFIndex)CFArrayGetValueAtIndex (array, i - 1);
+      CFIndex v2 = (CFIndex)CFArrayGetValueAtIndex (array, i);
+
+      if ((v1 >> 16) > (v2 >> 16)
+          || ((v1 >> 16) == (v2 >> 16) && (v1 & 0xFFFF) >= (v2 & 0xFFFF)))
+        return false;
+    }
+  return true;
+}
+
+int main (void)
+{
+  const char *names[] = { "random", "ascending runs", "descending",
+    "equal" };
+  CFIndex pattern;
+  CFIndex i;
+
+  srand (1);
+  for (pattern = 0 ; pattern < 4 ; ++pattern)
+    {
+      CFMutableArrayRef array;
+
+      array = CFArrayCreateMutable (NULL, COUNT, NULL);
+      for (i = 0 ; i < COUNT ; ++i)
+        {
+          CFIndex key;
+
+          switch (pattern)
+            {
+              case 0:  key = rand () % 50; break;
+              case 1:  key = (i % 700) / 3; break;
+              case 2:  key = (COUNT - i) / 4; break;
+              default: key = 3; break;
+            }
+          CFArrayAppendValue (array, (const void *)((key << 16) | i));
+        }
+      CFArraySortValuesStable (array, CFRangeMake (0, COUNT), compareKeys,
+        NULL);
+      PASS_CF(isStablySorted (array, COUNT),
+        "Stable sort of %s keys keeps equal values in order.",
+        names[pattern]);
+      CFRelease (array);
+    }
+
+  return 0;
+}
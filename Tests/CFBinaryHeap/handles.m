@@ -0,0 +1,68 @@
+#include <CoreFoundation/CFBinaryHeap.h>
+#include "../CFTesting.h"
+#include <stdlib.h>
+
+#define COUNT 100
+
+/* Checks that the values come out of a copy of the heap in order. */
+static Boolean
+isOrdered (CFBinaryHeapRef heap)
+{
+  const void *values[COUNT];
+  CFIndex count;
+  CFIndex idx;
+
+  count = CFBinaryHeapGetCount (heap);
+  CFBinaryHeapGetValues (heap, values);
+  for (idx = 1 ; idx < count ; ++idx)
+    if (values[idx - 1] > values[idx])
+      return false;
+  return true;
+}
+
+int main (void)
+{
+  CFBinaryHeapRef heap;
+  CFIndex handles[COUNT];
+  CFIndex idx;
+  Boolean found;
+
+  heap = CFBinaryHeapCreateWithArity (NULL, 0, 4, NULL, NULL);
+  PASS_CF(heap != NULL, "Heap with four children per node was created.");
+
+  srand (1);
+  for (idx = 0 ; idx < COUNT ; ++idx)
+    handles[idx] = CFBinaryHeapAddValueAndGetHandle (heap,
+      (const void *)(1000 + rand () % 1000));
+  PASS_CF(CFBinaryHeapGetCount (heap) == COUNT && isOrdered (heap),
+    "Values added with handles come out in order.");
+
+  CFBinaryHeapReplaceValueForHandle (heap, handles[51], (const void *)1);
+  PASS_CF(CFBinaryHeapGetMinimum (heap) == (const void *)1,
+    "Lowering a value by handle makes it the minimum.");
+  PASS_CF(CFBinaryHeapGetValueForHandle (heap, handles[51])
+    == (const void *)1, "The handle refers to the new value.");
+
+  CFBinaryHeapReplaceValueForHandle (heap, handles[51], (const void *)5000);
+  PASS_CF(CFBinaryHeapGetMinimum (heap) != (const void *)1 && isOrdered (heap),
+    "Raising a value by handle moves it down.");
+
+  for (idx = 0 ; idx < COUNT ; idx += 2)
+    CFBinaryHeapRemoveValueForHandle (heap, handles[idx]);
+  found = true;
+  for (idx = 1 ; idx < COUNT ; idx += 2)
+    if (CFBinaryHeapGetValueForHandle (heap, handles[idx]) == NULL)
+      found = false;
+  PASS_CF(CFBinaryHeapGetCount (heap) == COUNT / 2 && found
+    && isOrdered (heap), "Values can be removed by handle.");
+  PASS_CF(CFBinaryHeapGetValueForHandle (heap, handles[0]) == NULL,
+    "A removed value's handle is not in use.");
+
+  PASS_CF(CFBinaryHeapContainsValue (heap, (const void *)5000)
+    && !CFBinaryHeapContainsValue (heap, (const void *)1),
+    "CFBinaryHeapContainsValue() finds values in a four-way heap.");
+
+  CFRelease (heap);
+
+  return 0;
+}
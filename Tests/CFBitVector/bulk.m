@@ -0,0 +1,122 @@
+#include "CoreFoundation/CFBitVector.h"
+#include "../CFTesting.h"
+
+#define BITS 1000
+
+static Boolean
+bitAt (CFIndex idx, CFIndex stride)
+{
+  return (idx % stride) == 0;
+}
+
+static CFMutableBitVectorRef
+createPattern (CFIndex stride)
+{
+  CFMutableBitVectorRef bv;
+  CFIndex idx;
+
+  bv = CFBitVectorCreateMutable (NULL, BITS);
+  CFBitVectorSetCount (bv, BITS);
+  for (idx = 0 ; idx < BITS ; ++idx)
+    CFBitVectorSetBitAtIndex (bv, idx, bitAt (idx, stride));
+  return bv;
+}
+
+int main (void)
+{
+  CFRange range = CFRangeMake (3, 990);
+  CFMutableBitVectorRef a;
+  CFMutableBitVectorRef b;
+  CFIndex idx;
+  CFIndex expected;
+  Boolean match;
+
+  a = createPattern (3);
+  expected = 0;
+  for (idx = range.location ; idx < range.location + range.length ; ++idx)
+    if (bitAt (idx, 3))
+      ++expected;
+  PASS_CF(CFBitVectorGetCountOfBit (a, range, 1) == expected,
+    "GetCountOfBit counts ones over an unaligned multi-word range.");
+  PASS_CF(CFBitVectorGetCountOfBit (a, range, 0) == range.length - expected,
+    "GetCountOfBit counts zeros over an unaligned multi-word range.");
+  CFRelease (a);
+
+  a = CFBitVectorCreateMutable (NULL, BITS);
+  CFBitVectorSetCount (a, BITS);
+  CFBitVectorSetBitAtIndex (a, 2, 1);
+  CFBitVectorSetBitAtIndex (a, 777, 1);
+  CFBitVectorSetBitAtIndex (a, 995, 1);
+  PASS_CF(CFBitVectorGetFirstIndexOfBit (a, range, 1) == 777,
+    "GetFirstIndexOfBit skips whole zero words.");
+  PASS_CF(CFBitVectorGetLastIndexOfBit (a, range, 1) == 777,
+    "GetLastIndexOfBit skips whole zero words.");
+  CFBitVectorFlipBits (a, CFRangeMake (0, BITS));
+  PASS_CF(CFBitVectorGetFirstIndexOfBit (a, range, 0) == 777,
+    "GetFirstIndexOfBit finds a zero after whole one words.");
+  CFRelease (a);
+
+  a = createPattern (2);
+  b = createPattern (3);
+  CFBitVectorAndBits (a, range, b);
+  match = true;
+  for (idx = 0 ; idx < BITS ; ++idx)
+    {
+      Boolean inRange = idx >= range.location
+        && idx < range.location + range.length;
+      Boolean bit = inRange ? (bitAt (idx, 2) && bitAt (idx, 3))
+        : bitAt (idx, 2);
+      if (CFBitVectorGetBitAtIndex (a, idx) != bit)
+        match = false;
+    }
+  PASS_CF(match, "AndBits combines only the requested range.");
+  CFRelease (a);
+
+  a = createPattern (2);
+  CFBitVectorOrBits (a, range, b);
+  match = true;
+  for (idx = 0 ; idx < BITS ; ++idx)
+    {
+      Boolean inRange = idx >= range.location
+        && idx < range.location + range.length;
+      Boolean bit = inRange ? (bitAt (idx, 2) || bitAt (idx, 3))
+        : bitAt (idx, 2);
+      if (CFBitVectorGetBitAtIndex (a, idx) != bit)
+        match = false;
+    }
+  PASS_CF(match, "OrBits combines only the requested range.");
+  CFRelease (a);
+
+  a = createPattern (2);
+  CFBitVectorXorBits (a, range, b);
+  match = true;
+  for (idx = 0 ; idx < BITS ; ++idx)
+    {
+      Boolean inRange = idx >= range.location
+        && idx < range.location + range.length;
+      Boolean bit = inRange ? (bitAt (idx, 2) != bitAt (idx, 3))
+        : bitAt (idx, 2);
+      if (CFBitVectorGetBitAtIndex (a, idx) != bit)
+        match = false;
+    }
+  PASS_CF(match, "XorBits combines only the requested range.");
+  CFRelease (a);
+
+  a = createPattern (2);
+  CFBitVectorAndNotBits (a, range, b);
+  match = true;
+  for (idx = 0 ; idx < BITS ; ++idx)
+    {
+      Boolean inRange = idx >= range.location
+        && idx < range.location + range.length;
+      Boolean bit = inRange ? (bitAt (idx, 2) && !bitAt (idx, 3))
+        : bitAt (idx, 2);
+      if (CFBitVectorGetBitAtIndex (a, idx) != bit)
+        match = false;
+    }
+  PASS_CF(match, "AndNotBits clears the other vector's bits in the range.");
+  CFRelease (a);
+  CFRelease (b);
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include "CoreFoundation/CFBitVector.h"
+#include "../CFTesting.h"
+
+#define CHUNK 65536
+#define BITS (8 * CHUNK)
+
+int main (void)
+{
+  CFMutableBitVectorRef bv;
+  CFMutableBitVectorRef other;
+  CFMutableBitVectorRef flat;
+  CFBitVectorRef copy;
+  CFRange all = CFRangeMake (0, BITS);
+  CFIndex idx;
+
+  bv = CFBitVectorCreateMutableWithOptions (NULL, 0, kCFBitVectorCompressed);
+  CFBitVectorSetCount (bv, BITS);
+  PASS_CF(CFBitVectorGetCount (bv) == BITS, "Count set to 8 chunks.");
+  PASS_CF(CFBitVectorGetCountOfBit (bv, all, 1) == 0,
+    "A new compressed bit vector has no bits set.");
+
+  /* A few bits spread over chunks 1 and 5. */
+  CFBitVectorSetBitAtIndex (bv, CHUNK + 10, 1);
+  CFBitVectorSetBitAtIndex (bv, CHUNK + 3, 1);
+  CFBitVectorSetBitAtIndex (bv, 5 * CHUNK + 7, 1);
+  PASS_CF(CFBitVectorGetBitAtIndex (bv, CHUNK + 10) == 1
+       && CFBitVectorGetBitAtIndex (bv, CHUNK + 11) == 0,
+    "Bits set in a sparse chunk are read back.");
+  PASS_CF(CFBitVectorGetCountOfBit (bv, all, 1) == 3,
+    "GetCountOfBit counts bits in several chunks.");
+  PASS_CF(CFBitVectorGetCountOfBit (bv, CFRangeMake (CHUNK + 4, CHUNK), 1) == 1,
+    "GetCountOfBit honours a range starting inside a chunk.");
+  PASS_CF(CFBitVectorGetFirstIndexOfBit (bv, CFRangeMake (CHUNK + 4, 4 * CHUNK),
+    1) == CHUNK + 10, "GetFirstIndexOfBit finds a bit inside a chunk.");
+  PASS_CF(CFBitVectorGetFirstIndexOfBit (bv, CFRangeMake (CHUNK + 11, 5 * CHUNK),
+    1) == 5 * CHUNK + 7, "GetFirstIndexOfBit skips missing chunks.");
+  PASS_CF(CFBitVectorGetLastIndexOfBit (bv, CFRangeMake (0, 5 * CHUNK), 1)
+    == CHUNK + 10, "GetLastIndexOfBit skips missing chunks.");
+  PASS_CF(CFBitVectorGetFirstIndexOfBit (bv, CFRangeMake (CHUNK + 3, 10), 0)
+    == CHUNK + 4, "GetFirstIndexOfBit finds a clear bit.");
+
+  /* Whole chunks of ones and a dense chunk. */
+  CFBitVectorSetBits (bv, CFRangeMake (2 * CHUNK - 5, CHUNK + 10), 1);
+  for (idx = 0 ; idx < CHUNK ; idx += 3)
+    CFBitVectorSetBitAtIndex (bv, 6 * CHUNK + idx, 1);
+  PASS_CF(CFBitVectorGetCountOfBit (bv, all, 1)
+    == 3 + CHUNK + 10 + (CHUNK + 2) / 3,
+    "GetCountOfBit counts runs and dense chunks.");
+  PASS_CF(CFBitVectorGetFirstIndexOfBit (bv, CFRangeMake (2 * CHUNK, CHUNK), 0)
+    == kCFNotFound, "A full chunk has no clear bits.");
+  PASS_CF(CFBitVectorGetLastIndexOfBit (bv, all, 1)
+    == 6 * CHUNK + ((CHUNK - 1) / 3) * 3, "GetLastIndexOfBit finds the last "
+    "bit of a dense chunk.");
+
+  CFBitVectorSetBitAtIndex (bv, 2 * CHUNK + 100, 0);
+  PASS_CF(CFBitVectorGetFirstIndexOfBit (bv, CFRangeMake (2 * CHUNK, CHUNK), 0)
+    == 2 * CHUNK + 100, "Clearing a bit splits a run.");
+  CFBitVectorFlipBits (bv, CFRangeMake (2 * CHUNK, CHUNK));
+  PASS_CF(CFBitVectorGetCountOfBit (bv, CFRangeMake (2 * CHUNK, CHUNK), 1) == 1,
+    "FlipBits flips a whole chunk.");
+
+  copy = CFBitVectorCreateCopy (NULL, bv);
+  PASS_CF(CFEqual (copy, bv), "A copy of a compressed bit vector is equal.");
+
+  /* The same bits in a flat bit vector. */
+  flat = CFBitVectorCreateMutable (NULL, BITS);
+  CFBitVectorSetCount (flat, BITS);
+  for (idx = 0 ; idx < BITS ; ++idx)
+    if (CFBitVectorGetBitAtIndex (bv, idx))
+      CFBitVectorSetBitAtIndex (flat, idx, 1);
+  PASS_CF(CFEqual (flat, bv) && CFEqual (bv, flat),
+    "Flat and compressed bit vectors with the same bits are equal.");
+
+  /* Set operations between two compressed bit vectors. */
+  other = CFBitVectorCreateMutableWithOptions (NULL, 0, kCFBitVectorCompressed);
+  CFBitVectorSetCount (other, BITS);
+  CFBitVectorSetBits (other, CFRangeMake (CHUNK, 6 * CHUNK), 1);
+  CFBitVectorAndBits (bv, all, other);
+  PASS_CF(CFBitVectorGetCountOfBit (bv, all, 1)
+    == CFBitVectorGetCountOfBit (flat, CFRangeMake (CHUNK, 6 * CHUNK), 1),
+    "AndBits keeps only the bits set in both.");
+  CFBitVectorXorBits (bv, CFRangeMake (CHUNK / 2, CHUNK), other);
+  PASS_CF(CFBitVectorGetBitAtIndex (bv, CHUNK / 2) == 0
+       && CFBitVectorGetBitAtIndex (bv, CHUNK + 10) == 0
+       && CFBitVectorGetBitAtIndex (bv, CHUNK + 11) == 1
+       && CFBitVectorGetBitAtIndex (bv, 3 * CHUNK / 2) == 0,
+    "XorBits changes only the bits in range.");
+  CFBitVectorOrBits (bv, all, other);
+  PASS_CF(CFBitVectorGetCountOfBit (bv, all, 1) == 6 * CHUNK,
+    "OrBits sets the bits set in either.");
+  CFBitVectorAndNotBits (bv, all, other);
+  PASS_CF(CFBitVectorGetCountOfBit (bv, all, 1) == 0,
+    "AndNotBits clears the bits set in the other bit vector.");
+
+  /* A flat bit vector combined with a compressed one and the reverse. */
+  CFBitVectorOrBits (bv, all, flat);
+  PASS_CF(CFEqual (bv, flat), "OrBits takes bits from a flat bit vector.");
+  CFBitVectorAndNotBits (flat, all, copy);
+  PASS_CF(CFBitVectorGetCountOfBit (flat, all, 1) == 0,
+    "AndNotBits takes bits from a compressed bit vector.");
+
+  CFBitVectorSetCount (bv, CHUNK);
+  CFBitVectorSetCount (bv, BITS);
+  PASS_CF(CFBitVectorGetCountOfBit (bv, all, 1)
+    == CFBitVectorGetCountOfBit (copy, CFRangeMake (0, CHUNK), 1),
+    "Shrinking the count drops the bits past the end.");
+
+  CFRelease (copy);
+  CFRelease (flat);
+  CFRelease (other);
+  CFRelease (bv);
+
+  return 0;
+}
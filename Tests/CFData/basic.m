@@ -19,6 +19,13 @@ int main (void)
   
   data2 = CFDataCreateWithBytesNoCopy (NULL, copy, length, kCFAllocatorDefault);
   PASS_CFEQ(data, data2, "Copy of data is equal to original.");
+  PASS_CF(CFHash (data) == CFHash (data2),
+    "Copy of data has the same hash as the original.");
+  
+  CFRelease (data2);
+  data2 = CFDataCreate (NULL, bytes, sizeof(bytes) - 1);
+  PASS_CF(CFHash (data) != CFHash (data2),
+    "Data with different contents hash differently.");
   
   CFRelease (data);
   CFRelease (data2);
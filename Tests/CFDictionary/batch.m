@@ -0,0 +1,44 @@
+#include "CoreFoundation/CFDictionary.h"
+#include "CoreFoundation/CFString.h"
+#include "../CFTesting.h"
+
+int main (void)
+{
+  CFMutableDictionaryRef dict;
+  const void *keys[100];
+  const void *values[100];
+  CFIndex found;
+  CFIndex i;
+  Boolean match;
+
+  dict = CFDictionaryCreateMutable (NULL, 0, &kCFTypeDictionaryKeyCallBacks,
+    &kCFTypeDictionaryValueCallBacks);
+  for (i = 0 ; i < 100 ; ++i)
+    {
+      keys[i] = CFStringCreateWithFormat (NULL, NULL, CFSTR("key-%d"), (int)i);
+      if (i % 2 == 0)
+        CFDictionarySetValue (dict, keys[i], keys[i]);
+    }
+
+  found = CFDictionaryGetValuesForKeys (dict, keys, 100, values);
+  PASS_CF(found == 50, "CFDictionaryGetValuesForKeys finds present keys");
+
+  match = true;
+  for (i = 0 ; i < 100 ; ++i)
+    {
+      if (values[i] != (i % 2 == 0 ? CFDictionaryGetValue (dict, keys[i])
+          : NULL))
+        match = false;
+    }
+  PASS_CF(match, "CFDictionaryGetValuesForKeys returns the same values as "
+    "CFDictionaryGetValue");
+
+  found = CFDictionaryGetValuesForKeys (dict, keys, 0, values);
+  PASS_CF(found == 0, "Looking up no keys finds nothing");
+
+  for (i = 0 ; i < 100 ; ++i)
+    CFRelease (keys[i]);
+  CFRelease (dict);
+
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include "CoreFoundation/CFDictionary.h"
+#include "../CFTesting.h"
+
+static CFIndex hashCalls = 0;
+static CFIndex equalCalls = 0;
+static CFIndex retainCalls = 0;
+static CFIndex releaseCalls = 0;
+
+static const void *
+keyRetain (CFAllocatorRef allocator, const void *value)
+{
+  retainCalls += 1;
+  return value;
+}
+
+static void
+keyRelease (CFAllocatorRef allocator, const void *value)
+{
+  releaseCalls += 1;
+}
+
+static Boolean
+keyEqual (const void *value1, const void *value2)
+{
+  equalCalls += 1;
+  return value1 == value2;
+}
+
+static CFHashCode
+keyHash (const void *value)
+{
+  hashCalls += 1;
+  return (CFHashCode)value;
+}
+
+int main (void)
+{
+  CFDictionaryKeyCallBacks keyCallBacks =
+    { 0, keyRetain, keyRelease, NULL, keyEqual, keyHash };
+  CFMutableDictionaryRef dict;
+  CFDictionaryRef copy;
+  CFIndex count = 1000;
+  CFIndex i;
+  Boolean found;
+
+  dict = CFDictionaryCreateMutable (NULL, 0, &keyCallBacks, NULL);
+  for (i = 1 ; i <= count ; ++i)
+    CFDictionarySetValue (dict, (const void *)i, (const void *)i);
+  PASS_CF(CFDictionaryGetCount (dict) == count,
+    "All keys were added to the dictionary");
+  PASS_CF(hashCalls == count,
+    "Growing the dictionary does not hash keys again (%ld calls)",
+    (long)hashCalls);
+  PASS_CF(retainCalls == count,
+    "Growing the dictionary does not retain keys again (%ld calls)",
+    (long)retainCalls);
+  PASS_CF(equalCalls == 0,
+    "Adding keys with distinct hashes does not compare keys (%ld calls)",
+    (long)equalCalls);
+
+  found = true;
+  for (i = 1 ; i <= count ; ++i)
+    {
+      if (CFDictionaryGetValue (dict, (const void *)i) != (const void *)i)
+        found = false;
+    }
+  PASS_CF(found, "All keys are found after growing");
+  PASS_CF(equalCalls == count,
+    "Each lookup compares only the matching key (%ld calls)",
+    (long)equalCalls);
+
+  hashCalls = 0;
+  copy = CFDictionaryCreateCopy (NULL, dict);
+  PASS_CF(hashCalls == 0, "Copying a dictionary reuses stored hashes");
+  PASS_CF(CFDictionaryGetValue (copy, (const void *)count)
+    == (const void *)count, "A copied dictionary finds its keys");
+  CFRelease (copy);
+
+  releaseCalls = 0;
+  CFRelease (dict);
+  PASS_CF(releaseCalls == count,
+    "Releasing the dictionary releases each key once (%ld calls)",
+    (long)releaseCalls);
+
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include "CoreFoundation/CFDictionary.h"
+#include "CoreFoundation/CFString.h"
+#include "../CFTesting.h"
+
+#define COUNT 1000
+
+struct order
+{
+  const void *keys[COUNT];
+  CFIndex count;
+};
+
+static void
+recordKey (const void *key, const void *value, void *context)
+{
+  struct order *order = (struct order *)context;
+
+  if (order->count < COUNT)
+    order->keys[order->count] = key;
+  order->count += 1;
+}
+
+static CFHashCode
+constantHash (const void *value)
+{
+  return 42;
+}
+
+static Boolean
+pointerEqual (const void *value1, const void *value2)
+{
+  return value1 == value2;
+}
+
+int main (void)
+{
+  CFDictionaryKeyCallBacks constantCallBacks =
+    { 0, NULL, NULL, NULL, pointerEqual, constantHash };
+  const void *keys[COUNT + 1];
+  const void *values[COUNT + 1];
+  CFDictionaryRef dict;
+  CFDictionaryRef copy;
+  CFMutableDictionaryRef mutable;
+  struct order order1;
+  struct order order2;
+  CFStringRef missing;
+  CFIndex i;
+  Boolean match;
+
+  for (i = 0 ; i < COUNT ; ++i)
+    {
+      keys[i] = CFStringCreateWithFormat (NULL, NULL, CFSTR("key-%d"), (int)i);
+      values[i] = (const void *)(i + 1);
+    }
+
+  dict = CFDictionaryCreate (NULL, keys, values, COUNT,
+    &kCFTypeDictionaryKeyCallBacks, NULL);
+  PASS_CF(CFDictionaryGetCount (dict) == COUNT,
+    "A large immutable dictionary has the right count");
+
+  match = true;
+  for (i = 0 ; i < COUNT ; ++i)
+    {
+      if (CFDictionaryGetValue (dict, keys[i]) != values[i])
+        match = false;
+    }
+  PASS_CF(match, "Every key of a large immutable dictionary is found");
+
+  missing = CFSTR("key-missing");
+  PASS_CF(CFDictionaryGetValue (dict, missing) == NULL,
+    "A missing key is not found");
+  PASS_CF(!CFDictionaryContainsKey (dict, CFSTR("key-1000")),
+    "A similar missing key is not found");
+
+  mutable = CFDictionaryCreateMutable (NULL, 0,
+    &kCFTypeDictionaryKeyCallBacks, NULL);
+  for (i = 0 ; i < COUNT ; ++i)
+    CFDictionarySetValue (mutable, keys[i], values[i]);
+  PASS_CFEQ(dict, mutable, "It is equal to a mutable dictionary with the "
+    "same contents");
+
+  copy = CFDictionaryCreateCopy (NULL, mutable);
+  PASS_CFEQ(copy, dict, "An immutable copy of a mutable dictionary is equal");
+  CFRelease (copy);
+
+  order1.count = 0;
+  CFDictionaryApplyFunction (dict, recordKey, &order1);
+  copy = CFDictionaryCreateCopy (NULL, dict);
+  order2.count = 0;
+  CFDictionaryApplyFunction (copy, recordKey, &order2);
+  match = order1.count == COUNT && order2.count == COUNT;
+  for (i = 0 ; match && i < COUNT ; ++i)
+    {
+      if (order1.keys[i] != order2.keys[i])
+        match = false;
+    }
+  PASS_CF(match, "A copy is enumerated in the same order as the original");
+  CFRelease (copy);
+  CFRelease (dict);
+
+  /* A repeated key cannot be given its own bucket. */
+  keys[COUNT] = keys[0];
+  values[COUNT] = values[0];
+  dict = CFDictionaryCreate (NULL, keys, values, COUNT + 1,
+    &kCFTypeDictionaryKeyCallBacks, NULL);
+  PASS_CF(CFDictionaryGetValue (dict, keys[COUNT - 1]) == values[COUNT - 1],
+    "A dictionary created with a repeated key finds its keys");
+  CFRelease (dict);
+
+  /* Nor can keys with the same hash code. */
+  dict = CFDictionaryCreate (NULL, values, keys, 100, &constantCallBacks, NULL);
+  match = true;
+  for (i = 0 ; i < 100 ; ++i)
+    {
+      if (CFDictionaryGetValue (dict, values[i]) != keys[i])
+        match = false;
+    }
+  PASS_CF(match, "A dictionary whose keys share a hash code finds its keys");
+  CFRelease (dict);
+
+  CFRelease (mutable);
+  for (i = 0 ; i < COUNT ; ++i)
+    CFRelease (keys[i]);
+
+  return 0;
+}
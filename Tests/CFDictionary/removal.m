@@ -0,0 +1,87 @@
+#include "CoreFoundation/CFDictionary.h"
+#include "../CFTesting.h"
+
+/* Only a few distinct hash codes, so keys form long probe sequences. */
+static CFHashCode
+collidingHash (const void *value)
+{
+  return ((CFHashCode)value) & 0x0F;
+}
+
+static Boolean
+pointerEqual (const void *value1, const void *value2)
+{
+  return value1 == value2;
+}
+
+static Boolean
+checkContents (CFDictionaryRef dict, CFIndex count, CFIndex removedStep)
+{
+  CFIndex i;
+
+  for (i = 1 ; i <= count ; ++i)
+    {
+      const void *value = CFDictionaryGetValue (dict, (const void *)i);
+      Boolean removed = removedStep > 0 && (i % removedStep) == 0;
+
+      if (removed ? value != NULL : value != (const void *)(i * 2))
+        return false;
+    }
+  return true;
+}
+
+static void
+fill (CFMutableDictionaryRef dict, CFIndex count)
+{
+  CFIndex i;
+
+  for (i = 1 ; i <= count ; ++i)
+    CFDictionarySetValue (dict, (const void *)i, (const void *)(i * 2));
+}
+
+static void
+removeEvery (CFMutableDictionaryRef dict, CFIndex count, CFIndex step)
+{
+  CFIndex i;
+
+  for (i = step ; i <= count ; i += step)
+    CFDictionaryRemoveValue (dict, (const void *)i);
+}
+
+int main (void)
+{
+  CFDictionaryKeyCallBacks collidingCallBacks =
+    { 0, NULL, NULL, NULL, pointerEqual, collidingHash };
+  CFMutableDictionaryRef dict;
+  CFIndex count;
+
+  count = 20000;
+  dict = CFDictionaryCreateMutable (NULL, 0, NULL, NULL);
+  fill (dict, count);
+  PASS_CF(checkContents (dict, count, 0), "All pointer keys are found");
+  removeEvery (dict, count, 3);
+  PASS_CF(CFDictionaryGetCount (dict) == count - count / 3,
+    "Removing every third key updates the count");
+  PASS_CF(checkContents (dict, count, 3),
+    "Remaining keys are found after removals");
+  removeEvery (dict, count, 1);
+  PASS_CF(CFDictionaryGetCount (dict) == 0, "Removing all keys empties it");
+  fill (dict, count);
+  PASS_CF(checkContents (dict, count, 0),
+    "Keys are found after the dictionary shrinks and grows again");
+  CFRelease (dict);
+
+  count = 2000;
+  dict = CFDictionaryCreateMutable (NULL, 0, &collidingCallBacks, NULL);
+  fill (dict, count);
+  PASS_CF(checkContents (dict, count, 0), "All colliding keys are found");
+  removeEvery (dict, count, 2);
+  PASS_CF(checkContents (dict, count, 2),
+    "Colliding keys are found after removing every other one");
+  removeEvery (dict, count, 1);
+  PASS_CF(CFDictionaryGetCount (dict) == 0,
+    "Removing all colliding keys empties it");
+  CFRelease (dict);
+
+  return 0;
+}
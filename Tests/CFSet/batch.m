@@ -0,0 +1,37 @@
+#include "CoreFoundation/CFSet.h"
+#include "../CFTesting.h"
+
+int main (void)
+{
+  CFMutableSetRef set;
+  const void *values[40];
+  Boolean contained[40];
+  CFIndex found;
+  CFIndex i;
+  Boolean match;
+
+  set = CFSetCreateMutable (NULL, 0, NULL);
+  for (i = 0 ; i < 40 ; ++i)
+    {
+      values[i] = (const void *)(i + 1);
+      if (i % 3 == 0)
+        CFSetAddValue (set, values[i]);
+    }
+
+  found = CFSetContainsValues (set, values, 40, contained);
+  PASS_CF(found == 14, "CFSetContainsValues counts present values");
+
+  match = true;
+  for (i = 0 ; i < 40 ; ++i)
+    {
+      if (contained[i] != CFSetContainsValue (set, values[i]))
+        match = false;
+    }
+  PASS_CF(match, "CFSetContainsValues agrees with CFSetContainsValue");
+  PASS_CF(CFSetContainsValues (set, values, 40, NULL) == 14,
+    "CFSetContainsValues accepts a NULL result array");
+
+  CFRelease (set);
+
+  return 0;
+}
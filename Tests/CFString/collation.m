@@ -0,0 +1,113 @@
+#include "CoreFoundation/CFString.h"
+#include "CoreFoundation/CFArray.h"
+#include "CoreFoundation/CFData.h"
+#include "CoreFoundation/CFLocale.h"
+#include "../CFTesting.h"
+
+#include <string.h>
+
+static CFComparisonResult
+keyCompare (CFDataRef k1, CFDataRef k2)
+{
+  CFIndex l1 = CFDataGetLength (k1);
+  CFIndex l2 = CFDataGetLength (k2);
+  int res;
+
+  res = memcmp (CFDataGetBytePtr (k1), CFDataGetBytePtr (k2),
+                l1 < l2 ? l1 : l2);
+  if (res == 0)
+    res = l1 < l2 ? -1 : (l1 > l2 ? 1 : 0);
+  return res < 0 ? kCFCompareLessThan :
+    (res > 0 ? kCFCompareGreaterThan : kCFCompareEqualTo);
+}
+
+static CFComparisonResult
+compareNonliteral (const void *v1, const void *v2, void *context)
+{
+  return CFStringCompare (v1, v2, kCFCompareNonliteral);
+}
+
+int main (void)
+{
+  CFStringRef strings[] = { CFSTR("pear"), CFSTR("Apple"), CFSTR("apple"),
+    CFSTR("banana"), CFSTR("cherry"), CFSTR("Banana"), CFSTR("a"),
+    CFSTR("apples"), CFSTR("zebra"), CFSTR("Zebra"), CFSTR(""), CFSTR("10"),
+    CFSTR("9"), CFSTR("a-b"), CFSTR("ab"), CFSTR("pear") };
+  CFIndex count = sizeof(strings) / sizeof(CFStringRef);
+  CFMutableArrayRef array1;
+  CFMutableArrayRef array2;
+  CFDataRef key1;
+  CFDataRef key2;
+  CFIndex i;
+  CFIndex j;
+  Boolean match;
+
+  match = true;
+  for (i = 0 ; i < count ; ++i)
+    {
+      for (j = 0 ; j < count ; ++j)
+        {
+          key1 = CFStringCreateCollationKey (NULL, strings[i],
+            kCFCompareNonliteral, NULL);
+          key2 = CFStringCreateCollationKey (NULL, strings[j],
+            kCFCompareNonliteral, NULL);
+          if (keyCompare (key1, key2) != CFStringCompare (strings[i],
+              strings[j], kCFCompareNonliteral))
+            match = false;
+          CFRelease (key1);
+          CFRelease (key2);
+        }
+    }
+  PASS_CF(match, "Collation keys order like CFStringCompare()");
+
+  match = true;
+  for (i = 0 ; i < count ; ++i)
+    {
+      for (j = 0 ; j < count ; ++j)
+        {
+          key1 = CFStringCreateCollationKey (NULL, strings[i], 0, NULL);
+          key2 = CFStringCreateCollationKey (NULL, strings[j], 0, NULL);
+          if (keyCompare (key1, key2) != CFStringCompare (strings[i],
+              strings[j], 0))
+            match = false;
+          CFRelease (key1);
+          CFRelease (key2);
+        }
+    }
+  PASS_CF(match, "Literal collation keys order like CFStringCompare()");
+
+  array1 = CFArrayCreateMutable (NULL, count, &kCFTypeArrayCallBacks);
+  array2 = CFArrayCreateMutable (NULL, count, &kCFTypeArrayCallBacks);
+  for (i = 0 ; i < count ; ++i)
+    {
+      CFArrayAppendValue (array1, strings[i]);
+      CFArrayAppendValue (array2, strings[i]);
+    }
+  CFArraySortValues (array1, CFRangeMake (0, count), compareNonliteral, NULL);
+  CFArraySortValuesUsingCollation (array2, CFRangeMake (0, count),
+    kCFCompareNonliteral, NULL);
+
+  match = true;
+  for (i = 0 ; i < count ; ++i)
+    {
+      if (CFStringCompare (CFArrayGetValueAtIndex (array1, i),
+          CFArrayGetValueAtIndex (array2, i), 0) != kCFCompareEqualTo)
+        match = false;
+    }
+  PASS_CF(match, "Sorting with collation keys matches CFArraySortValues()");
+
+  CFArraySortValuesUsingCollation (array2, CFRangeMake (0, count), 0, NULL);
+  match = true;
+  for (i = 1 ; i < count ; ++i)
+    {
+      if (CFStringCompare (CFArrayGetValueAtIndex (array2, i - 1),
+          CFArrayGetValueAtIndex (array2, i), 0) == kCFCompareGreaterThan)
+        match = false;
+    }
+  PASS_CF(match, "Literal sort with collation keys is ordered");
+
+  CFRelease (array1);
+  CFRelease (array2);
+
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include "CoreFoundation/CFString.h"
+#include "CoreFoundation/CFLocale.h"
+#include "../CFTesting.h"
+
+static const char *localeIdentifiers[] =
+  { "en_US", "de_DE", "fr_FR", "es_ES", "it_IT", "sv_SE", "da_DK", "nl_NL",
+    "pt_BR", "fi_FI", "nb_NO", "pl_PL" };
+#define LOCALE_COUNT (sizeof(localeIdentifiers) / sizeof(const char *))
+
+int main (void)
+{
+  UniChar uAbc[] = { 'a', 'b', 'c' };
+  UniChar uAbd[] = { 'a', 'b', 'd' };
+  UniChar uLong[] = { 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 0x00E9 };
+  UInt8 decomposed[] = { 'e', 0xCC, 0x81 };
+  UInt8 precomposed[] = { 0xC3, 0xA9 };
+  CFStringRef abc;
+  CFStringRef abd;
+  CFStringRef lng;
+  CFStringRef str1;
+  CFStringRef str2;
+
+  abc = CFStringCreateWithCharacters (NULL, uAbc, 3);
+  abd = CFStringCreateWithCharacters (NULL, uAbd, 3);
+  lng = CFStringCreateWithCharacters (NULL, uLong, 10);
+
+  PASS_CF(CFStringCompare (CFSTR("abc"), CFSTR("abd"), 0) == kCFCompareLessThan,
+    "ASCII 'abc' is less than ASCII 'abd'");
+  PASS_CF(CFStringCompare (CFSTR("abd"), CFSTR("abc"), 0)
+    == kCFCompareGreaterThan, "ASCII 'abd' is greater than ASCII 'abc'");
+  PASS_CF(CFStringCompare (CFSTR("ab"), CFSTR("abc"), 0) == kCFCompareLessThan,
+    "A prefix is less than the longer string");
+  PASS_CF(CFStringCompare (CFSTR("B"), CFSTR("a"), 0) == kCFCompareLessThan,
+    "Literal comparison orders by code unit");
+
+  PASS_CF(CFStringCompare (abc, abd, 0) == kCFCompareLessThan,
+    "UTF-16 'abc' is less than UTF-16 'abd'");
+  PASS_CF(CFStringCompare (abc, CFSTR("abc"), 0) == kCFCompareEqualTo,
+    "UTF-16 'abc' is equal to ASCII 'abc'");
+  PASS_CF(CFStringCompare (CFSTR("abd"), abc, 0) == kCFCompareGreaterThan,
+    "ASCII 'abd' is greater than UTF-16 'abc'");
+  PASS_CF(CFStringCompare (lng, CFSTR("abcdefghiz"), 0)
+    == kCFCompareGreaterThan, "Non-ASCII character compares after ASCII");
+  PASS_CF(CFStringCompareWithOptions (lng, CFSTR("def"), CFRangeMake (3, 3), 0)
+    == kCFCompareEqualTo, "Comparing a range of a UTF-16 string works");
+  PASS_CF(CFStringCompareWithOptions (CFSTR("xxabc"), abc, CFRangeMake (2, 3),
+    0) == kCFCompareEqualTo, "Comparing a range of an ASCII string works");
+
+  PASS_CF(CFEqual (abc, CFSTR("abc")),
+    "ASCII and UTF-16 strings with the same contents are equal");
+  PASS_CF(!CFEqual (abc, CFSTR("ab")), "Strings of different length differ");
+
+  str1 = CFStringCreateWithBytes (NULL, decomposed, sizeof(decomposed),
+    kCFStringEncodingUTF8, false);
+  str2 = CFStringCreateWithBytes (NULL, precomposed, sizeof(precomposed),
+    kCFStringEncodingUTF8, false);
+  PASS_CF(!CFEqual (str1, str2),
+    "Canonically equivalent strings are not literally equal");
+  PASS_CF(CFStringCompare (str1, str2, kCFCompareNonliteral)
+    == kCFCompareEqualTo, "Canonically equivalent strings compare equal "
+    "with kCFCompareNonliteral");
+  PASS_CF(CFStringCompare (CFSTR("a"), CFSTR("b"), kCFCompareNonliteral)
+    == kCFCompareLessThan, "Collated 'a' is less than 'b'");
+
+  /* Cycle through more locales than the per-thread collator cache holds so
+     that collators are evicted and reopened. */
+  {
+    CFIndex pass;
+    CFIndex idx;
+    Boolean ordered = true;
+
+    for (pass = 0 ; pass < 2 ; ++pass)
+      {
+        for (idx = 0 ; idx < LOCALE_COUNT ; ++idx)
+          {
+            CFStringRef ident;
+            CFLocaleRef locale;
+
+            ident = CFStringCreateWithCString (NULL, localeIdentifiers[idx],
+              kCFStringEncodingASCII);
+            locale = CFLocaleCreate (NULL, ident);
+            if (CFStringCompareWithOptionsAndLocale (CFSTR("a"), CFSTR("b"),
+                CFRangeMake (0, 1), kCFCompareLocalized, locale)
+                != kCFCompareLessThan)
+              ordered = false;
+            CFRelease (locale);
+            CFRelease (ident);
+          }
+      }
+    PASS_CF(ordered, "Localized comparison is stable across collator reuse");
+  }
+
+  CFRelease (str1);
+  CFRelease (str2);
+  CFRelease (abc);
+  CFRelease (abd);
+  CFRelease (lng);
+
+  return 0;
+}
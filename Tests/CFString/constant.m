@@ -0,0 +1,58 @@
+#include "CoreFoundation/CFString.h"
+#include "../CFTesting.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define THREADS 4
+#define STRINGS 512
+
+static char buffers[STRINGS][8];
+static CFStringRef results[THREADS][STRINGS];
+
+static void *
+makeStrings (void *arg)
+{
+  CFStringRef *res = arg;
+  CFIndex idx;
+
+  for (idx = 0 ; idx < STRINGS ; ++idx)
+    res[idx] = __CFStringMakeConstantString (buffers[idx]);
+  return NULL;
+}
+
+int main (void)
+{
+  pthread_t threads[THREADS];
+  CFIndex idx;
+  CFIndex t;
+  Boolean same;
+  Boolean contents;
+
+  for (idx = 0 ; idx < STRINGS ; ++idx)
+    snprintf (buffers[idx], sizeof(buffers[idx]), "s%d", (int)idx);
+
+  for (t = 0 ; t < THREADS ; ++t)
+    pthread_create (&threads[t], NULL, makeStrings, results[t]);
+  for (t = 0 ; t < THREADS ; ++t)
+    pthread_join (threads[t], NULL);
+
+  same = true;
+  contents = true;
+  for (idx = 0 ; idx < STRINGS ; ++idx)
+    {
+      for (t = 1 ; t < THREADS ; ++t)
+        if (results[t][idx] != results[0][idx])
+          same = false;
+      if (CFStringCompare (results[0][idx],
+          __CFStringMakeConstantString (buffers[idx]), 0) != kCFCompareEqualTo
+          || CFStringGetLength (results[0][idx]) != strlen (buffers[idx]))
+        contents = false;
+    }
+  PASS_CF(same, "Threads creating the same constant strings share them");
+  PASS_CF(contents, "Constant strings keep their contents");
+  PASS_CF(CFSTR("abc") == CFSTR("abc"), "CFSTR() returns a unique string");
+
+  return 0;
+}
@@ -6,11 +6,23 @@ int main (void)
   UniChar uStr[] = { 's', 't', 'r', 0 };
   CFStringRef str1 = CFSTR ("str");
   CFStringRef str2 = CFStringCreateWithCharacters (NULL, uStr, 3);
+  CFMutableStringRef mStr;
 
   PASS_CF(CFHash (str1) == CFHash (str2),
     "Identical ASCII and UTF-16 string hashes match");
 
+  mStr = CFStringCreateMutable (NULL, 0);
+  CFStringAppend (mStr, CFSTR("st"));
+  PASS_CF(CFHash (mStr) != CFHash (str1),
+    "Hashes of different strings differ");
+  CFStringAppend (mStr, CFSTR("r"));
+  PASS_CF(CFHash (mStr) == CFHash (str1),
+    "Mutable string hash is updated after it is modified");
+
+  CFStringDelete (mStr, CFRangeMake (0, 3));
+  PASS_CF(CFHash (mStr) == CFHash (CFSTR("")), "Empty string hashes match");
+
+  CFRelease(mStr);
   CFRelease(str2);
   return 0;
 }
-
@@ -0,0 +1,105 @@
+#include "CoreFoundation/CFTree.h"
+#include "../CFTesting.h"
+
+#define WIDTH 100
+#define DEPTH 100000
+
+static CFIndex released = 0;
+
+static void
+releaseInfo (const void *info)
+{
+  released += 1;
+}
+
+static void
+countTree (const void *value, void *context)
+{
+  *(CFIndex *)context += 1;
+}
+
+static CFIndex foreignReleased = 0;
+
+static void
+releaseForeign (const void *info)
+{
+  foreignReleased += 1;
+}
+
+int main (void)
+{
+  CFTreeContext context = { 0, NULL, NULL, releaseInfo, NULL };
+  CFTreeContext foreignContext = { 0, NULL, NULL, releaseForeign, NULL };
+  CFTreeRef tree;
+  CFTreeRef node;
+  CFTreeRef child;
+  CFTreeRef foreign;
+  CFIndex idx;
+  CFIndex count;
+
+  tree = CFTreeCreateWithArena (NULL, NULL);
+  PASS_CF(tree != NULL, "Arena tree created");
+  for (idx = 0 ; idx < WIDTH ; ++idx)
+    {
+      child = CFTreeCreateInArena (tree, NULL);
+      CFTreeAppendChild (tree, child);
+      CFRelease (child);
+    }
+  PASS_CF(CFTreeGetChildCount (tree) == WIDTH, "Arena children appended");
+  child = CFTreeGetChildAtIndex (tree, WIDTH / 2);
+  PASS_CF(CFTreeGetParent (child) == tree, "Arena child has the right parent");
+  node = CFTreeCreateInArena (child, NULL);
+  CFTreeAppendChild (child, node);
+  CFRelease (node);
+  PASS_CF(CFTreeFindRoot (node) == tree, "Grandchild finds the arena root");
+  CFTreeRemove (CFTreeGetChildAtIndex (tree, 3));
+  PASS_CF(CFTreeGetChildCount (tree) == WIDTH - 1,
+    "Arena child can be removed");
+  CFRelease (tree);
+
+  /* A deep tree made of nodes with a release callback. */
+  tree = CFTreeCreateWithArena (NULL, &context);
+  node = tree;
+  for (idx = 0 ; idx < DEPTH ; ++idx)
+    {
+      child = CFTreeCreateInArena (tree, &context);
+      CFTreeAppendChild (node, child);
+      CFRelease (child);
+      node = child;
+    }
+  count = 0;
+  CFTreeApplyFunctionToDescendants (tree, countTree, &count);
+  PASS_CF(count == DEPTH, "Deep arena tree has all its nodes");
+  CFRelease (tree);
+  PASS_CF(released == DEPTH + 1,
+    "Releasing the arena root releases the info of every node");
+
+  /* Trees from outside the arena are released normally. */
+  tree = CFTreeCreateWithArena (NULL, NULL);
+  node = CFTreeCreateInArena (tree, NULL);
+  CFTreeAppendChild (tree, node);
+  CFRelease (node);
+  foreign = CFTreeCreate (NULL, &foreignContext);
+  child = CFTreeCreate (NULL, &foreignContext);
+  CFTreeAppendChild (foreign, child);
+  CFRelease (child);
+  CFTreeAppendChild (node, foreign);
+  CFTreeAppendChild (tree, CFTreeCreateInArena (tree, NULL));
+  CFRelease (CFTreeGetChildAtIndex (tree, 1));
+  CFRelease (tree);
+  PASS_CF(foreignReleased == 0 && CFTreeGetParent (foreign) == NULL,
+    "A retained foreign tree survives the arena");
+  CFRelease (foreign);
+  PASS_CF(foreignReleased == 2, "Foreign trees are released with the arena");
+
+  /* Without an arena CFTreeCreateInArena() is CFTreeCreate(). */
+  tree = CFTreeCreate (NULL, NULL);
+  child = CFTreeCreateInArena (tree, NULL);
+  CFTreeAppendChild (tree, child);
+  CFRelease (child);
+  PASS_CF(CFTreeGetChildCount (tree) == 1,
+    "CFTreeCreateInArena works without an arena");
+  CFRelease (tree);
+
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include "CoreFoundation/CFTree.h"
+#include "../CFTesting.h"
+
+#define WIDTH 1000
+#define DEPTH 100000
+
+static void
+countTree (const void *value, void *context)
+{
+  *(CFIndex *)context += 1;
+}
+
+static void
+recordTree (const void *value, void *context)
+{
+  CFTreeRef **next = (CFTreeRef **)context;
+
+  **next = (CFTreeRef)value;
+  *next += 1;
+}
+
+int main (void)
+{
+  CFTreeRef tree;
+  CFTreeRef node;
+  CFTreeRef child;
+  CFTreeRef children[WIDTH];
+  CFTreeRef order[6];
+  CFTreeRef *next;
+  CFIndex idx;
+  CFIndex count;
+  Boolean match;
+
+  tree = CFTreeCreate (NULL, NULL);
+  for (idx = 0 ; idx < WIDTH ; ++idx)
+    {
+      children[idx] = CFTreeCreate (NULL, NULL);
+      CFTreeAppendChild (tree, children[idx]);
+      CFRelease (children[idx]);
+    }
+  PASS_CF(CFTreeGetChildCount (tree) == WIDTH, "Child count is kept.");
+
+  match = true;
+  for (idx = 0 ; idx < WIDTH ; ++idx)
+    if (CFTreeGetChildAtIndex (tree, idx) != children[idx])
+      match = false;
+  PASS_CF(match, "GetChildAtIndex returns each child.");
+  PASS_CF(CFTreeGetChildAtIndex (tree, WIDTH) == NULL
+       && CFTreeGetChildAtIndex (tree, -1) == NULL,
+    "GetChildAtIndex returns NULL out of range.");
+
+  child = CFTreeCreate (NULL, NULL);
+  CFTreeAppendChild (tree, child);
+  CFRelease (child);
+  PASS_CF(CFTreeGetChildAtIndex (tree, WIDTH) == child
+       && CFTreeGetChildAtIndex (tree, 500) == children[500],
+    "An appended child is found by index.");
+
+  CFTreeRemove (children[10]);
+  PASS_CF(CFTreeGetChildCount (tree) == WIDTH
+       && CFTreeGetChildAtIndex (tree, 10) == children[11],
+    "Removing a child updates the count and the indexes.");
+
+  child = CFTreeCreate (NULL, NULL);
+  CFTreePrependChild (tree, child);
+  CFRelease (child);
+  PASS_CF(CFTreeGetChildCount (tree) == WIDTH + 1
+       && CFTreeGetChildAtIndex (tree, 12) == children[12],
+    "Prepending a child shifts the indexes.");
+
+  child = CFTreeCreate (NULL, NULL);
+  CFTreeInsertSibling (children[20], child);
+  CFRelease (child);
+  PASS_CF(CFTreeGetChildCount (tree) == WIDTH + 2
+       && CFTreeGetChildAtIndex (tree, 21) == child,
+    "Inserting a sibling updates the count and the indexes.");
+
+  CFTreeRemoveAllChildren (tree);
+  PASS_CF(CFTreeGetChildCount (tree) == 0
+       && CFTreeGetChildAtIndex (tree, 0) == NULL,
+    "RemoveAllChildren resets the count.");
+
+  /* tree -> (a -> (b, c), d -> (e)) */
+  for (idx = 0 ; idx < 5 ; ++idx)
+    children[idx] = CFTreeCreate (NULL, NULL);
+  CFTreeAppendChild (tree, children[0]);
+  CFTreeAppendChild (children[0], children[1]);
+  CFTreeAppendChild (children[0], children[2]);
+  CFTreeAppendChild (tree, children[3]);
+  CFTreeAppendChild (children[3], children[4]);
+  next = order;
+  CFTreeApplyFunctionToDescendants (tree, recordTree, &next);
+  PASS_CF(next - order == 5 && order[0] == children[0]
+       && order[1] == children[1] && order[2] == children[2]
+       && order[3] == children[3] && order[4] == children[4],
+    "ApplyFunctionToDescendants visits the tree in preorder.");
+  next = order;
+  CFTreeApplyFunctionToDescendants (children[0], recordTree, &next);
+  PASS_CF(next - order == 2 && order[0] == children[1],
+    "ApplyFunctionToDescendants stays within a subtree.");
+  for (idx = 0 ; idx < 5 ; ++idx)
+    CFRelease (children[idx]);
+  CFRelease (tree);
+
+  /* A tree too deep to walk or release recursively. */
+  tree = CFTreeCreate (NULL, NULL);
+  node = tree;
+  for (idx = 0 ; idx < DEPTH ; ++idx)
+    {
+      child = CFTreeCreate (NULL, NULL);
+      CFTreeAppendChild (node, child);
+      CFRelease (child);
+      node = child;
+    }
+  count = 0;
+  CFTreeApplyFunctionToDescendants (tree, countTree, &count);
+  PASS_CF(count == DEPTH, "ApplyFunctionToDescendants walks a deep tree.");
+  CFRelease (tree);
+  PASS_CF(true, "A deep tree is released.");
+
+  return 0;
+}
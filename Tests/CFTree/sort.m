@@ -0,0 +1,63 @@
+#include "CoreFoundation/CFTree.h"
+#include "../CFTesting.h"
+
+#define CHILDREN 100
+
+static CFComparisonResult
+compareInfo (const void *v1, const void *v2, void *context)
+{
+  CFTreeContext c1;
+  CFTreeContext c2;
+
+  CFTreeGetContext ((CFTreeRef)v1, &c1);
+  CFTreeGetContext ((CFTreeRef)v2, &c2);
+  if (c1.info < c2.info)
+    return kCFCompareLessThan;
+  return c1.info > c2.info ? kCFCompareGreaterThan : kCFCompareEqualTo;
+}
+
+int main (void)
+{
+  CFTreeContext ctxt = { 0, NULL, NULL, NULL, NULL };
+  CFTreeRef tree;
+  CFTreeRef child;
+  CFTreeRef last;
+  CFIndex i;
+  Boolean ordered;
+
+  tree = CFTreeCreate (NULL, &ctxt);
+  for (i = 0 ; i < CHILDREN ; ++i)
+    {
+      ctxt.info = (void *)((i * 37) % CHILDREN + 1);
+      child = CFTreeCreate (NULL, &ctxt);
+      CFTreeAppendChild (tree, child);
+      CFRelease (child);
+    }
+
+  CFTreeSortChildren (tree, compareInfo, NULL);
+  PASS_CF(CFTreeGetChildCount (tree) == CHILDREN,
+    "Sorting keeps all %d children.", CHILDREN);
+
+  ordered = true;
+  last = NULL;
+  for (i = 0, child = CFTreeGetFirstChild (tree) ; child != NULL ;
+       ++i, child = CFTreeGetNextSibling (child))
+    {
+      CFTreeGetContext (child, &ctxt);
+      if ((CFIndex)ctxt.info != i + 1 || CFTreeGetParent (child) != tree)
+        ordered = false;
+      last = child;
+    }
+  PASS_CF(ordered, "Children are sorted.");
+
+  ctxt.info = (void *)(CHILDREN + 1);
+  child = CFTreeCreate (NULL, &ctxt);
+  CFTreeAppendChild (tree, child);
+  CFRelease (child);
+  PASS_CF(CFTreeGetNextSibling (last) == child,
+    "Appending after sorting links to the last sorted child.");
+
+  CFRelease (tree);
+
+  return 0;
+}